@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    AnalyserView.cpp
+    Created: 18 Oct 2026 3:21:37pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "AnalyserView.h"
+#include <cmath>
+
+//==============================================================================
+AnalyserView::AnalyserView(AudioTap& tap,
+                           FrameScheduler& _frameScheduler) :
+                            analyser(tap),
+                            frameScheduler(_frameScheduler)
+{
+    setInterceptsMouseClicks(false, false);
+    frameScheduler.addClient(this);
+}
+
+AnalyserView::~AnalyserView()
+{
+    frameScheduler.removeClient(this);
+    analyser.setActive(false);
+}
+
+void AnalyserView::setColourPalette(juce::Colour &_controllerBackground,
+                                    juce::Colour &_controllerBody,
+                                    juce::Colour &_controllerIndicator,
+                                    juce::Colour &_infoTextColour,
+                                    juce::Colour &_warningTextColour)
+{
+    controllerBackground = _controllerBackground;
+    controllerBody = _controllerBody;
+    controllerIndicator = _controllerIndicator;
+    infoTextColour = _infoTextColour;
+    warningTextColour = _warningTextColour;
+}
+
+void AnalyserView::paint (juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black);
+    g.setColour(controllerBody);
+    g.drawRect(spectrumArea);
+    g.drawRect(scopeArea);
+    drawSpectrum(g);
+    drawScope(g);
+    g.setColour(infoTextColour);
+    g.setFont(10.0f);
+    g.drawText(getName(), spectrumArea.reduced(4), juce::Justification::topLeft, true);
+}
+
+void AnalyserView::resized()
+{
+    // goniometer is square on the right, spectrum fills the rest
+    auto area = getLocalBounds();
+    scopeArea = area.removeFromRight(area.getHeight());
+    area.removeFromRight(4);
+    spectrumArea = area;
+}
+
+void AnalyserView::visibilityChanged()
+{
+    // the analyser and the tap feeding it only run while the view can be seen
+    analyser.setActive(isVisible());
+    if (isVisible())
+    {
+        lastAnalysisMs = juce::Time::getMillisecondCounterHiRes();
+        frameScheduler.wake();
+    }
+}
+
+bool AnalyserView::frameCallback(double frameTimeMs)
+{
+    if (!isVisible())
+        return false;
+    if (analyser.getLatest(spectrum, scope, generation))
+    {
+        lastAnalysisMs = frameTimeMs;
+        repaint();
+    }
+    // keep polling for a moment after the audio stops so the spectrum can fall back
+    return frameTimeMs - lastAnalysisMs < 500;
+}
+
+void AnalyserView::drawSpectrum(juce::Graphics& g)
+{
+    if (spectrum.empty() || spectrumArea.getWidth() < 2)
+        return;
+    double binWidth = analyser.getSampleRate() / SpectrumAnalyser::fftSize;
+    float logRange = std::log(maxFrequency / minFrequency);
+    juce::Path spectrumPath;
+    for (int x = 0; x < spectrumArea.getWidth(); ++x)
+    {
+        // logarithmic frequency scale
+        float frequency = minFrequency * std::exp(logRange * x / (spectrumArea.getWidth() - 1));
+        int bin = juce::jlimit(0, (int)spectrum.size() - 1, (int)(frequency / binWidth));
+        float level = juce::jmap(juce::jlimit(minDecibels, maxDecibels, spectrum[bin]), minDecibels, maxDecibels, 0.0f, 1.0f);
+        float px = (float)(spectrumArea.getX() + x);
+        float py = spectrumArea.getBottom() - level * spectrumArea.getHeight();
+        if (x == 0)
+            spectrumPath.startNewSubPath(px, py);
+        else
+            spectrumPath.lineTo(px, py);
+    }
+    g.setColour(controllerIndicator);
+    g.strokePath(spectrumPath, juce::PathStrokeType(1.0f));
+}
+
+void AnalyserView::drawScope(juce::Graphics& g)
+{
+    auto centre = scopeArea.getCentre().toFloat();
+    float radius = scopeArea.getWidth() * 0.5f;
+    g.setColour(controllerBody.withAlpha(0.5f));
+    g.drawLine(centre.x, (float)scopeArea.getY(), centre.x, (float)scopeArea.getBottom(), 1.0f);
+    g.drawLine((float)scopeArea.getX(), centre.y, (float)scopeArea.getRight(), centre.y, 1.0f);
+    g.setColour(controllerIndicator);
+    for (auto point : scope)
+    {
+        float px = centre.x + juce::jlimit(-1.0f, 1.0f, point.x) * radius;
+        float py = centre.y - juce::jlimit(-1.0f, 1.0f, point.y) * radius;
+        g.fillRect(px, py, 1.0f, 1.0f);
+    }
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    AnalyserView.h
+    Created: 18 Oct 2026 3:21:37pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "AudioTap.h"
+#include "SpectrumAnalyser.h"
+#include "FrameScheduler.h"
+
+//==============================================================================
+/*
+ Draws a spectrum analyser and a goniometer for an AudioTap
+ The analyser behind it only runs while the view is visible
+*/
+class AnalyserView  : public juce::Component,
+                      public FrameScheduler::Client
+{
+public:
+    AnalyserView(AudioTap& tap,
+                 FrameScheduler& _frameScheduler);
+    ~AnalyserView() override;
+
+    // implement Component virtual methods
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    void visibilityChanged() override;
+    
+    /**
+     AnalyserView::frameCallback()
+     Input                  double frame time in ms
+     Output                 bool
+     Collects the latest analysis and repaints if there is any
+     Returns true while new analysis is still arriving
+     */
+    bool frameCallback(double frameTimeMs) override;
+    
+    /**
+     AnalyserView::setColourPalette()
+     input                  juce::Colour variables
+     output                 none
+     sets the colours used in this component's paint() method
+     to the passed juce::Colour variables so the entire app colour scheme can be set in one place
+     */
+    void setColourPalette(juce::Colour& _controllerBackground,
+                          juce::Colour& _controllerBody,
+                          juce::Colour& _controllerIndicator,
+                          juce::Colour& _infoTextColour,
+                          juce::Colour& _warningTextColour);
+
+private:
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** worker that produces the analysis */
+    SpectrumAnalyser analyser;
+    /** app frame tick */
+    FrameScheduler& frameScheduler;
+    /** colour palette */
+    juce::Colour controllerBackground, controllerBody, controllerIndicator, infoTextColour, warningTextColour;
+    /** latest analysis copied from the analyser */
+    std::vector<float> spectrum;
+    std::vector<juce::Point<float>> scope;
+    juce::uint32 generation = 0;
+    /** frame time new analysis last arrived, used to go idle when the audio stops */
+    double lastAnalysisMs = 0;
+    /** layout */
+    juce::Rectangle<int> spectrumArea, scopeArea;
+    /** range of the spectrum display */
+    static constexpr float minFrequency = 20.0f, maxFrequency = 20000.0f;
+    static constexpr float minDecibels = -90.0f, maxDecibels = 0.0f;
+    
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     AnalyserView::drawSpectrum()
+     Input                  juce::Graphics
+     Output                 none
+     Draws the spectrum on a logarithmic frequency scale into spectrumArea
+     */
+    void drawSpectrum(juce::Graphics& g);
+    
+    /**
+     AnalyserView::drawScope()
+     Input                  juce::Graphics
+     Output                 none
+     Draws the goniometer into scopeArea
+     */
+    void drawScope(juce::Graphics& g);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalyserView)
+};
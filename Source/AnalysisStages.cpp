@@ -0,0 +1,388 @@
+/*
+  ==============================================================================
+
+    AnalysisStages.cpp
+    Created: 3 Nov 2026 2:47:53pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "AnalysisStages.h"
+#include "ThumbnailDiskCache.h"
+#include <cmath>
+#include <algorithm>
+
+constexpr double BeatGridStage::hopSeconds;
+constexpr double BeatGridStage::tempoRange;
+constexpr double BeatGridStage::tempoStep;
+constexpr double MixPointStage::hopSeconds;
+constexpr float MixPointStage::silenceDb;
+constexpr float MixPointStage::bodyRangeDb;
+constexpr int MixPointStage::beatsPerBar;
+constexpr int MixPointStage::barsPerPhrase;
+constexpr int LoudnessStage::meterBlockSize;
+
+/* ============================ */
+/* ====== ThumbnailStage ====== */
+/* ============================ */
+
+ThumbnailStage::ThumbnailStage(juce::AudioFormatManager& formatManager, juce::AudioThumbnailCache& cacheToUse, const juce::File& _folder) :
+                                    folder(_folder),
+                                    thumbnail(1000, formatManager, cacheToUse)
+{
+}
+
+ThumbnailStage::~ThumbnailStage()
+{
+}
+
+void ThumbnailStage::prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples)
+{
+    hash = ThumbnailDiskCache::getHash(juce::URL(juce::String(track.url)));
+    thumbnail.reset(numChannels, sampleRate, lengthInSamples);
+}
+
+void ThumbnailStage::process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples)
+{
+    thumbnail.addBlock(position, block, 0, numSamples);
+}
+
+void ThumbnailStage::finish(TrackAnalyser::Analysis&)
+{
+    if (!ThumbnailDiskCache::saveThumbnail(folder, hash, thumbnail))
+        std::cout << "ThumbnailStage::finish: could not write to " << folder.getFullPathName() << std::endl;
+    thumbnail.clear();
+}
+
+/* ======================== */
+/* ====== TempoStage ====== */
+/* ======================== */
+
+TempoStage::TempoStage()
+{
+}
+
+TempoStage::~TempoStage()
+{
+}
+
+void TempoStage::prepare(const TrackAnalyser::Track&, double sampleRate, int, juce::int64)
+{
+    // initialised as DJAudioPlayer::loadURL() does
+    calculator = BPMCalculator();
+    calculator.sampleRate = (float)sampleRate;
+    calculator.beatCounter = 0;
+}
+
+void TempoStage::process(const juce::AudioBuffer<float>& block, juce::int64, int numSamples)
+{
+    // fed as DJAudioPlayer::getNextAudioBlock() feeds it
+    const float* left = block.getReadPointer(0);
+    const float* right = block.getReadPointer(block.getNumChannels() > 1 ? 1 : 0);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if ((int)calculator.blockBuffer.size() >= calculator.samplesPerBlock)
+            calculator.getBlockEnergy();
+        calculator.blockBuffer.push({ left[i], right[i] });
+    }
+}
+
+void TempoStage::finish(TrackAnalyser::Analysis& analysis)
+{
+    if (calculator._bpm > 0)
+        analysis.bpm = calculator._bpm;
+}
+
+/* =========================== */
+/* ====== BeatGridStage ====== */
+/* =========================== */
+
+BeatGridStage::BeatGridStage()
+{
+}
+
+BeatGridStage::~BeatGridStage()
+{
+}
+
+void BeatGridStage::prepare(const TrackAnalyser::Track&, double _sampleRate, int, juce::int64 lengthInSamples)
+{
+    sampleRate = _sampleRate;
+    hopSamples = juce::jmax(1, juce::roundToInt(sampleRate * hopSeconds));
+    onsets.clear();
+    onsets.reserve((size_t)(lengthInSamples / hopSamples) + 1);
+    hopEnergy = 0;
+    lastHopEnergy = 0;
+    hopPosition = 0;
+}
+
+void BeatGridStage::process(const juce::AudioBuffer<float>& block, juce::int64, int numSamples)
+{
+    const float* left = block.getReadPointer(0);
+    const float* right = block.getReadPointer(block.getNumChannels() > 1 ? 1 : 0);
+    // about -50dB, so the rise out of a silence isn't taken for the loudest beat in the track
+    const float floor = (float)hopSamples * 1.0e-5f;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float sample = 0.5f * (left[i] + right[i]);
+        hopEnergy += sample * sample;
+        if (++hopPosition == hopSamples)
+        {
+            onsets.push_back(juce::jmax(0.0f, std::log10((hopEnergy + floor) / (lastHopEnergy + floor))));
+            lastHopEnergy = hopEnergy;
+            hopEnergy = 0;
+            hopPosition = 0;
+        }
+    }
+}
+
+void BeatGridStage::finish(TrackAnalyser::Analysis& analysis)
+{
+    if (std::isnan(analysis.bpm) || analysis.bpm <= 0 || onsets.empty())
+        return;
+    const double hopLength = (double)hopSamples / sampleRate;
+    double bestScore = 0, bestBpm = 0;
+    int bestPhase = 0;
+    for (double bpm = analysis.bpm * (1.0 - tempoRange); bpm <= analysis.bpm * (1.0 + tempoRange); bpm += tempoStep)
+    {
+        // beats are period hops apart, and each grid's mean onset over its beats is its score
+        const double period = 60.0 / bpm / hopLength;
+        for (int phase = 0; phase < (int)period; ++phase)
+        {
+            double score = 0;
+            int numBeats = 0;
+            for (double beat = phase + 0.5; beat < (double)onsets.size(); beat += period)
+            {
+                score += onsets[(size_t)beat];
+                ++numBeats;
+            }
+            score /= juce::jmax(1, numBeats);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestBpm = bpm;
+                bestPhase = phase;
+            }
+        }
+    }
+    // a track without onsets, such as a drone, has no grid
+    if (bestScore <= 0)
+        return;
+    analysis.bpm = (float)bestBpm;
+    analysis.firstBeat = (float)(bestPhase * hopLength);
+}
+
+/* =========================== */
+/* ====== MixPointStage ====== */
+/* =========================== */
+
+MixPointStage::MixPointStage()
+{
+}
+
+MixPointStage::~MixPointStage()
+{
+}
+
+void MixPointStage::prepare(const TrackAnalyser::Track&, double _sampleRate, int, juce::int64 _lengthInSamples)
+{
+    sampleRate = _sampleRate;
+    lengthInSamples = _lengthInSamples;
+    hopSamples = juce::jmax(1, juce::roundToInt(sampleRate * hopSeconds));
+    hopLevels.clear();
+    hopLevels.reserve((size_t)(lengthInSamples / hopSamples) + 1);
+    hopEnergy = 0;
+    hopPosition = 0;
+}
+
+void MixPointStage::process(const juce::AudioBuffer<float>& block, juce::int64, int numSamples)
+{
+    const float* left = block.getReadPointer(0);
+    const float* right = block.getReadPointer(block.getNumChannels() > 1 ? 1 : 0);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float sample = 0.5f * (left[i] + right[i]);
+        hopEnergy += sample * sample;
+        if (++hopPosition == hopSamples)
+        {
+            hopLevels.push_back(hopEnergy / (float)hopSamples);
+            hopEnergy = 0;
+            hopPosition = 0;
+        }
+    }
+}
+
+void MixPointStage::finish(TrackAnalyser::Analysis& analysis)
+{
+    if (hopPosition > 0)
+        hopLevels.push_back(hopEnergy / (float)hopPosition);
+    const float silence = std::pow(10.0f, silenceDb / 10.0f);
+    size_t first = 0, last = hopLevels.size();
+    while (first < hopLevels.size() && hopLevels[first] <= silence)
+        ++first;
+    while (last > first && hopLevels[last - 1] <= silence)
+        --last;
+    if (first == last)
+        return;
+    const double hopLength = (double)hopSamples / sampleRate;
+    TrackStore::MixPoints points;
+    points.soundStart = (float)(first * hopLength);
+    points.soundEnd = (float)juce::jmin(last * hopLength, (double)lengthInSamples / sampleRate);
+    points.introEnd = points.soundStart;
+    points.outroStart = points.soundEnd;
+    if (!std::isnan(analysis.bpm) && !std::isnan(analysis.firstBeat))
+    {
+        // the grid only says where beats fall, the bars start on whichever beat of four has the strongest
+        // rise in level across the track, where the kick, a crash or a bass change lands on the downbeat
+        const double beatLength = 60.0 / analysis.bpm;
+        const double barLength = beatsPerBar * beatLength;
+        const double phraseLength = barLength * barsPerPhrase;
+        int downbeatOffset = 0;
+        double bestRise = -1;
+        for (int offset = 0; offset < beatsPerBar; ++offset)
+        {
+            double rise = 0;
+            int numBars = 0;
+            for (double beat = analysis.firstBeat + offset * beatLength; beat < points.soundEnd; beat += barLength)
+            {
+                const size_t hop = (size_t)(beat / hopLength);
+                if (hop == 0 || hop + 1 >= hopLevels.size())
+                    continue;
+                // the onset can land in the hop after the one the beat starts in
+                rise += juce::jmax(0.0f, juce::jmax(hopLevels[hop], hopLevels[hop + 1]) - hopLevels[hop - 1]);
+                ++numBars;
+            }
+            rise /= juce::jmax(1, numBars);
+            if (rise > bestRise)
+            {
+                bestRise = rise;
+                downbeatOffset = offset;
+            }
+        }
+        // bars and phrases are counted from the first downbeat within the sound, as a track starts on a phrase,
+        // and only bars wholly within the sound are weighed
+        double downbeat = analysis.firstBeat + downbeatOffset * beatLength;
+        downbeat += std::ceil((points.soundStart - downbeat) / barLength) * barLength;
+        std::vector<float> barLevels;
+        for (int bar = 0; downbeat + (bar + 1) * barLength <= points.soundEnd; ++bar)
+        {
+            const size_t start = (size_t)((downbeat + bar * barLength) / hopLength);
+            const size_t end = juce::jmin(hopLevels.size(), (size_t)((downbeat + (bar + 1) * barLength) / hopLength));
+            double energy = 0;
+            for (size_t hop = start; hop < end; ++hop)
+                energy += hopLevels[hop];
+            barLevels.push_back((float)(10.0 * std::log10(energy / (double)juce::jmax((size_t)1, end - start) + 1.0e-10)));
+        }
+        // too short to have a phrase either side of its body
+        if ((int)barLevels.size() >= 2 * barsPerPhrase)
+        {
+            std::vector<float> sorted(barLevels);
+            std::nth_element(sorted.begin(), sorted.begin() + (long)sorted.size() / 2, sorted.end());
+            const float bodyLevel = sorted[sorted.size() / 2] - bodyRangeDb;
+            int bodyStart = 0, bodyEnd = (int)barLevels.size();
+            while (barLevels[(size_t)bodyStart] < bodyLevel)
+                ++bodyStart;
+            while (barLevels[(size_t)bodyEnd - 1] < bodyLevel)
+                --bodyEnd;
+            const double introEnd = downbeat + std::round(bodyStart / (double)barsPerPhrase) * phraseLength;
+            const double outroStart = downbeat + std::round(bodyEnd / (double)barsPerPhrase) * phraseLength;
+            points.introEnd = juce::jlimit(points.soundStart, points.soundEnd, (float)introEnd);
+            points.outroStart = juce::jlimit(points.introEnd, points.soundEnd, (float)outroStart);
+        }
+    }
+    analysis.mixPoints = points;
+}
+
+/* ====================== */
+/* ====== KeyStage ====== */
+/* ====================== */
+
+KeyStage::KeyStage()
+{
+}
+
+KeyStage::~KeyStage()
+{
+}
+
+void KeyStage::prepare(const TrackAnalyser::Track&, double sampleRate, int, juce::int64)
+{
+    detector = std::make_unique<KeyDetector>(sampleRate);
+}
+
+void KeyStage::process(const juce::AudioBuffer<float>& block, juce::int64, int numSamples)
+{
+    detector->process(block.getArrayOfReadPointers(), block.getNumChannels(), numSamples);
+}
+
+void KeyStage::finish(TrackAnalyser::Analysis& analysis)
+{
+    analysis.key = detector->getKey();
+}
+
+/* =========================== */
+/* ====== LoudnessStage ====== */
+/* =========================== */
+
+LoudnessStage::LoudnessStage()
+{
+}
+
+LoudnessStage::~LoudnessStage()
+{
+}
+
+void LoudnessStage::prepare(const TrackAnalyser::Track&, double sampleRate, int, juce::int64)
+{
+    // also resets the meter
+    meter.prepareToPlay(meterBlockSize, sampleRate);
+}
+
+void LoudnessStage::process(const juce::AudioBuffer<float>& block, juce::int64, int numSamples)
+{
+    meter.process(block, 0, numSamples);
+}
+
+void LoudnessStage::finish(TrackAnalyser::Analysis& analysis)
+{
+    const float lufs = meter.getIntegratedLufs();
+    if (lufs > LoudnessMeter::silenceLufs)
+    {
+        analysis.loudness = lufs;
+        const LoudnessMeter::Readings readings = meter.getReadings();
+        analysis.truePeak = juce::Decibels::gainToDecibels(juce::jmax(readings.truePeak[0], readings.truePeak[1]));
+    }
+}
+
+/* ============================== */
+/* ====== FingerprintStage ====== */
+/* ============================== */
+
+FingerprintStage::FingerprintStage()
+{
+}
+
+FingerprintStage::~FingerprintStage()
+{
+}
+
+void FingerprintStage::prepare(const TrackAnalyser::Track&, double sampleRate, int, juce::int64)
+{
+    fingerprinter = std::make_unique<Fingerprinter>(sampleRate);
+}
+
+void FingerprintStage::process(const juce::AudioBuffer<float>& block, juce::int64, int numSamples)
+{
+    fingerprinter->process(block.getArrayOfReadPointers(), block.getNumChannels(), numSamples);
+}
+
+bool FingerprintStage::isDone() const
+{
+    return fingerprinter->isComplete();
+}
+
+void FingerprintStage::finish(TrackAnalyser::Analysis& analysis)
+{
+    analysis.fingerprint = fingerprinter->getFingerprint();
+}
@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    AnalysisStages.h
+    Created: 3 Nov 2026 2:47:53pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include "TrackAnalyser.h"
+#include "BPMCalculator.h"
+#include "Fingerprinter.h"
+#include "KeyDetector.h"
+#include "LoudnessMeter.h"
+
+//==============================================================================
+/*
+ Draws the waveform thumbnail a deck shows, and saves it where a
+ ThumbnailDiskCache on the same folder will find it
+ The thumbnail is filled by hand, so the cache it is made with is never used,
+ and one cache is shared by every worker's stage
+*/
+class ThumbnailStage  : public TrackAnalyser::Stage
+{
+public:
+    ThumbnailStage(juce::AudioFormatManager& formatManager, juce::AudioThumbnailCache& cacheToUse, const juce::File& _folder);
+    ~ThumbnailStage() override;
+
+    void prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) override;
+    void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) override;
+    void finish(TrackAnalyser::Analysis& analysis) override;
+
+private:
+    juce::File folder;
+    /** cache hash of the track's url */
+    juce::int64 hash = 0;
+    /** same resolution as WaveformDisplay's */
+    juce::AudioThumbnail thumbnail;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThumbnailStage)
+};
+
+//==============================================================================
+/*
+ Estimates tempo with the same BPMCalculator the decks use, over the whole track
+*/
+class TempoStage  : public TrackAnalyser::Stage
+{
+public:
+    TempoStage();
+    ~TempoStage() override;
+
+    void prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) override;
+    void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) override;
+    void finish(TrackAnalyser::Analysis& analysis) override;
+
+private:
+    BPMCalculator calculator;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TempoStage)
+};
+
+//==============================================================================
+/*
+ Lays a beat grid over the track, added after a TempoStage
+ Keeps an onset envelope, the rise in energy every 10ms, then tries tempos
+ close to the TempoStage's estimate and every phase of each, keeping the grid
+ whose beats land on the most onset. So the tempo is refined as well, which
+ keeps a grid on the beat to the end of the track
+*/
+class BeatGridStage  : public TrackAnalyser::Stage
+{
+public:
+    BeatGridStage();
+    ~BeatGridStage() override;
+
+    void prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) override;
+    void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) override;
+    void finish(TrackAnalyser::Analysis& analysis) override;
+
+private:
+    /** onset strength of each hop */
+    std::vector<float> onsets;
+    double sampleRate = 0;
+    int hopSamples = 0;
+    /** energy so far of the hop being summed, and of the hop before it */
+    float hopEnergy = 0, lastHopEnergy = 0;
+    int hopPosition = 0;
+
+    static constexpr double hopSeconds = 0.01;
+    /** furthest from the TempoStage's estimate a tempo is tried, as a fraction of it, and the steps between tries in bpm */
+    static constexpr double tempoRange = 0.03;
+    static constexpr double tempoStep = 0.05;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BeatGridStage)
+};
+
+//==============================================================================
+/*
+ Finds where the track's sound starts and ends, past any silence, and its intro
+ and outro, added after a BeatGridStage
+ Keeps the level of every 50ms, then takes the level of each bar of the beat grid,
+ with bars starting on the beat of four whose onsets rise the most. The body of the track runs from its first to its last bar within a few dB of its
+ typical bar, and the intro and outro are what lies either side, each end rounded
+ to the nearest phrase so a transition starts and lands on one. A track without a
+ grid has neither, only its sound
+*/
+class MixPointStage  : public TrackAnalyser::Stage
+{
+public:
+    MixPointStage();
+    ~MixPointStage() override;
+
+    void prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) override;
+    void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) override;
+    void finish(TrackAnalyser::Analysis& analysis) override;
+
+private:
+    /** mean square of each hop */
+    std::vector<float> hopLevels;
+    double sampleRate = 0;
+    juce::int64 lengthInSamples = 0;
+    int hopSamples = 0;
+    /** energy so far of the hop being summed */
+    float hopEnergy = 0;
+    int hopPosition = 0;
+
+    static constexpr double hopSeconds = 0.05;
+    /** a hop quieter than this is silence, about where a fade out is lost under the other deck */
+    static constexpr float silenceDb = -55.0f;
+    /** how far below the track's typical bar a bar can be and still belong to its body */
+    static constexpr float bodyRangeDb = 4.0f;
+    static constexpr int beatsPerBar = 4;
+    static constexpr int barsPerPhrase = 8;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MixPointStage)
+};
+
+//==============================================================================
+/*
+ Finds the key of the whole track with a KeyDetector
+*/
+class KeyStage  : public TrackAnalyser::Stage
+{
+public:
+    KeyStage();
+    ~KeyStage() override;
+
+    void prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) override;
+    void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) override;
+    void finish(TrackAnalyser::Analysis& analysis) override;
+
+private:
+    std::unique_ptr<KeyDetector> detector;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KeyStage)
+};
+
+//==============================================================================
+/*
+ Measures the integrated loudness of the whole track with the LoudnessMeter the decks use
+*/
+class LoudnessStage  : public TrackAnalyser::Stage
+{
+public:
+    LoudnessStage();
+    ~LoudnessStage() override;
+
+    void prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) override;
+    void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) override;
+    void finish(TrackAnalyser::Analysis& analysis) override;
+
+private:
+    LoudnessMeter meter;
+    /** the meter splits larger blocks into pieces of this size */
+    static constexpr int meterBlockSize = 4096;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessStage)
+};
+
+//==============================================================================
+/*
+ Takes the track's Fingerprinter fingerprint, which only needs its first 30 seconds of sound
+*/
+class FingerprintStage  : public TrackAnalyser::Stage
+{
+public:
+    FingerprintStage();
+    ~FingerprintStage() override;
+
+    void prepare(const TrackAnalyser::Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) override;
+    void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) override;
+    bool isDone() const override;
+    void finish(TrackAnalyser::Analysis& analysis) override;
+
+private:
+    std::unique_ptr<Fingerprinter> fingerprinter;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FingerprintStage)
+};
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    AudioTap.cpp
+    Created: 18 Oct 2026 2:14:08pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "AudioTap.h"
+
+AudioTap::AudioTap(int _capacity) :
+                    fifo(_capacity),
+                    ring(2, _capacity)
+{
+    ring.clear();
+}
+
+AudioTap::~AudioTap()
+{
+}
+
+void AudioTap::push(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (!enabled.load(std::memory_order_relaxed) || buffer.getNumChannels() == 0)
+        return;
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    int rightChannel = buffer.getNumChannels() > 1 ? 1 : 0;
+    if (size1 > 0)
+    {
+        ring.copyFrom(0, start1, buffer, 0, startSample, size1);
+        ring.copyFrom(1, start1, buffer, rightChannel, startSample, size1);
+    }
+    if (size2 > 0)
+    {
+        ring.copyFrom(0, start2, buffer, 0, startSample + size1, size2);
+        ring.copyFrom(1, start2, buffer, rightChannel, startSample + size1, size2);
+    }
+    fifo.finishedWrite(size1 + size2);
+}
+
+int AudioTap::pull(float* left, float* right, int maxSamples)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+    if (size1 > 0)
+    {
+        juce::FloatVectorOperations::copy(left, ring.getReadPointer(0, start1), size1);
+        juce::FloatVectorOperations::copy(right, ring.getReadPointer(1, start1), size1);
+    }
+    if (size2 > 0)
+    {
+        juce::FloatVectorOperations::copy(left + size1, ring.getReadPointer(0, start2), size2);
+        juce::FloatVectorOperations::copy(right + size1, ring.getReadPointer(1, start2), size2);
+    }
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
+
+void AudioTap::discardPending()
+{
+    fifo.finishedRead(fifo.getNumReady());
+}
+
+void AudioTap::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+}
+
+bool AudioTap::isEnabled()
+{
+    return enabled;
+}
+
+void AudioTap::setSampleRate(double _sampleRate)
+{
+    sampleRate = _sampleRate;
+}
+
+double AudioTap::getSampleRate()
+{
+    return sampleRate;
+}
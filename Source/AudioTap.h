@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    AudioTap.h
+    Created: 18 Oct 2026 2:14:08pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+/*
+ Lock-free stereo tap on an audio stream
+ The audio thread pushes samples into a preallocated ring buffer
+ and a single reader thread pulls them out for analysis
+ Does nothing but check a flag while disabled
+*/
+class AudioTap
+{
+public:
+    AudioTap(int _capacity = 16384);
+    ~AudioTap();
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     AudioTap::push()
+     Input                  juce::AudioBuffer, int, int
+     Output                 none
+     @param buffer          the buffer the audio thread has just filled
+     @param startSample     first sample of the block in the buffer
+     @param numSamples      number of samples in the block
+     Called from the audio thread. Copies the block into the ring buffer if the tap is enabled
+     Samples that don't fit are dropped, it never waits or allocates
+     */
+    void push(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    
+    /**
+     AudioTap::pull()
+     Input                  float*, float*, int
+     Output                 int number of samples read
+     @param left            destination for left channel samples
+     @param right           destination for right channel samples
+     @param maxSamples      maximum number of samples to read
+     Called from the reader thread. Reads as many samples as are available up to maxSamples
+     */
+    int pull(float* left, float* right, int maxSamples);
+    
+    /**
+     AudioTap::discardPending()
+     Input                  none
+     Output                 none
+     Called from the reader thread. Throws away anything waiting in the ring buffer
+     */
+    void discardPending();
+    
+    /**
+     AudioTap::setEnabled()
+     Input                  bool
+     Output                 none
+     Turns the tap on or off. While off the audio thread skips the copy entirely
+     */
+    void setEnabled(bool shouldBeEnabled);
+    
+    /** AudioTap::isEnabled() returns true if the tap is copying samples */
+    bool isEnabled();
+    
+    /** AudioTap::setSampleRate() stores the rate of the tapped stream, called from prepareToPlay */
+    void setSampleRate(double _sampleRate);
+    
+    /** AudioTap::getSampleRate() returns the rate of the tapped stream */
+    double getSampleRate();
+
+private:
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** manages the read / write positions of the ring buffer */
+    juce::AbstractFifo fifo;
+    /** the ring buffer, allocated once in the constructor */
+    juce::AudioBuffer<float> ring;
+    /** set by the GUI, checked by the audio thread */
+    std::atomic<bool> enabled{false};
+    /** sample rate of the tapped stream */
+    std::atomic<double> sampleRate{44100.0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioTap)
+};
@@ -20,7 +20,6 @@ BPMCalculator::BPMCalculator()
     blockCounter = 0;
     localBlockCounter = 0;
     _bpm = -1.0f;
-    startTimer(5000);
 }
 
 BPMCalculator::~BPMCalculator()
@@ -117,9 +116,10 @@ void BPMCalculator::calculateBPM()
     float timeTakenForBeatsDetected = localBlockCounter * samplesPerBlock / sampleRate;
     beatsPerMinute = localBeatCounter * 60 / timeTakenForBeatsDetected;
     instantBpm.push_back(beatsPerMinute);
+    averageBPM();
 }
 
-void BPMCalculator::timerCallback()
+void BPMCalculator::averageBPM()
 {
     double bpmTotal = 0;
     float bpmSize = instantBpm.size();
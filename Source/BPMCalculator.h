@@ -14,7 +14,7 @@
 #include <utility>
 #include <JuceHeader.h>
 
-class BPMCalculator : public Timer
+class BPMCalculator
 {
 public:
     BPMCalculator();
@@ -37,8 +37,14 @@ public:
      */
     void getBlockEnergy();
 private:
-    // pure virtual Timer
-    void timerCallback() override;
+    /**
+     BPMCalculator::averageBPM()
+     Input                  none
+     Output                 none
+     Averages the instantaneous bpms into BPMCalculator::_bpm
+     and folds the result into the 90 - 180 range
+     */
+    void averageBPM();
     /**
      BPMCalculator::averageLocalEnergy()
      Input                  none
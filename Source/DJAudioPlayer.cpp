@@ -10,6 +10,11 @@
 
 #include "DJAudioPlayer.h"
 #include <iostream>
+#include <cmath>
+
+constexpr float DJAudioPlayer::maxNormalisationDb;
+constexpr float DJAudioPlayer::maxTruePeakDb;
+constexpr double DJAudioPlayer::defaultMixOutSeconds;
 
 DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager)
     :   formatManager(_formatManager)
@@ -25,20 +30,36 @@ void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate
 {
     transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    currentSampleRate = sampleRate;
+    analyserTap.setSampleRate(sampleRate);
+    meter.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 void DJAudioPlayer::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill)
 {
     // set level as gain without crossfade so GUI meter shows level of track
-    transportSource.setGain(currentGain);
+    // normalisation is folded into the same gain, so costs nothing per sample
+    transportSource.setGain(currentGain * normalisationGain.load(std::memory_order_relaxed));
     resampleSource.getNextAudioBlock(bufferToFill);
-    // get output of player for meters
-    float currLMax = bufferToFill.buffer->getMagnitude(0, 0, bufferToFill.numSamples);
-    float currRMax = bufferToFill.buffer->getMagnitude(1, 0, bufferToFill.numSamples);
-    if (currLMax > leftPeak)
-        leftPeak = currLMax;
-    if (currRMax > rightPeak)
-        rightPeak = currRMax;
+    publishPlayhead(bufferToFill.numSamples);
+    // the hand-off is noticed where the track is read, so it starts within a block of the mix out point
+    if (!mixOutReached.load(std::memory_order_relaxed) && transportSource.isPlaying())
+    {
+        double mixOutPosition = mixOut.load(std::memory_order_relaxed);
+        if (std::isnan(mixOutPosition))
+            mixOutPosition = transportSource.getLengthInSeconds() - defaultMixOutSeconds;
+        if (transportSource.getCurrentPosition() >= mixOutPosition)
+        {
+            mixOutReached = true;
+            mixOutPending = true;
+            sendChangeMessage();
+        }
+    }
+    analyserTap.push(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+    // meter output of player, starting afresh on a newly loaded track
+    if (meterNeedsReset.exchange(false))
+        meter.reset();
+    meter.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
     // push samples to bpm calculator block, if full do stuff
     for (int i = 0; i < bufferToFill.numSamples; ++i)
     {
@@ -63,14 +84,22 @@ void DJAudioPlayer::releaseResources()
     resampleSource.releaseResources();
 }
 
-void DJAudioPlayer::loadURL(URL audioURL)
+void DJAudioPlayer::loadURL(URL audioURL, float _trackLoudness, float _trackPeak)
 {
     auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
     if (reader != nullptr) // good file
     {
+        // set before the source, so the first block of the track is already normalised
+        setTrackLoudness(_trackLoudness, _trackPeak);
         std::unique_ptr<AudioFormatReaderSource> newSource (new AudioFormatReaderSource(reader, true));
         transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
         readerSource.reset (newSource.release());
+        // the library sets the track's own mix out after loading it
+        mixOut = std::numeric_limits<double>::quiet_NaN();
+        mixOutReached = false;
+        mixOutPending = false;
+        // reset on the audio thread, which the meter's state belongs to
+        meterNeedsReset = true;
         // inform bpm calculator of track sample rate, initialise
         bpmCalculator.sampleRate = reader->sampleRate;
         bpmCalculator.localPeakCounter = 0;
@@ -81,6 +110,50 @@ void DJAudioPlayer::loadURL(URL audioURL)
     }
 }
 
+void DJAudioPlayer::setTrackLoudness(float lufs, float truePeak)
+{
+    trackLoudness = lufs;
+    trackPeak = truePeak;
+    updateNormalisationGain();
+}
+
+void DJAudioPlayer::setTargetLoudness(float lufs)
+{
+    targetLoudness = lufs;
+    updateNormalisationGain();
+}
+
+void DJAudioPlayer::updateNormalisationGain()
+{
+    if (std::isnan(trackLoudness))
+    {
+        normalisationGain = 1.0;
+        return;
+    }
+    float gainDb = juce::jlimit(-maxNormalisationDb, maxNormalisationDb, targetLoudness - trackLoudness);
+    // a boost stops where the track would clip, and a track whose peaks aren't known is only ever turned down
+    const float peakHeadroomDb = std::isnan(trackPeak) ? 0.0f : juce::jmax(0.0f, maxTruePeakDb - trackPeak);
+    gainDb = juce::jmin(gainDb, peakHeadroomDb);
+    normalisationGain = juce::Decibels::decibelsToGain((double)gainDb);
+}
+
+void DJAudioPlayer::setMixOut(double seconds)
+{
+    mixOut = seconds;
+    // a point moved ahead of the playhead is crossed again, one moved behind it was already handed off at
+    double mixOutPosition = std::isnan(seconds) ? transportSource.getLengthInSeconds() - defaultMixOutSeconds : seconds;
+    if (transportSource.getCurrentPosition() < mixOutPosition)
+    {
+        mixOutReached = false;
+        mixOutPending = false;
+    }
+}
+
+bool DJAudioPlayer::takeMixOutReached()
+{
+    return mixOutPending.exchange(false);
+}
+
 double DJAudioPlayer::getGain()
 {
     return currentGain;
@@ -113,12 +186,18 @@ void DJAudioPlayer::setSpeed(double ratio)
     if (ratio < 0.5 || ratio > 2)
         std::cout << "DJAudioPlayer::setSpeed ratio should be in the range 50 - 200%" << std::endl;
     else
+    {
         resampleSource.setResamplingRatio(ratio);
+        currentSpeed = ratio;
+    }
 }
 
 void DJAudioPlayer::setPosition(double posInSecs)
 {
     transportSource.setPosition(posInSecs);
+    // the audio thread flags it again if the new position is still past the mix out point
+    mixOutReached = false;
+    mixOutPending = false;
 }
 
 void DJAudioPlayer::setPositionRelative(double pos)
@@ -165,14 +244,58 @@ int DJAudioPlayer::getLengthInSeconds()
     return transportSource.getLengthInSeconds();
 }
 
-std::vector<double> DJAudioPlayer::getLevels()
+void DJAudioPlayer::publishPlayhead(int numSamples)
+{
+    juce::uint32 sequence = playheadSequence.load(std::memory_order_relaxed);
+    playheadSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    playheadSamplePosition.store(transportSource.getNextReadPosition(), std::memory_order_relaxed);
+    playheadSampleRate.store(currentSampleRate, std::memory_order_relaxed);
+    playheadSpeed.store(currentSpeed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    playheadHostTimeMs.store(juce::Time::getMillisecondCounterHiRes(), std::memory_order_relaxed);
+    playheadBlockDurationMs.store(currentSampleRate > 0 ? numSamples * 1000.0 / currentSampleRate : 0, std::memory_order_relaxed);
+    playheadPlaying.store(transportSource.isPlaying(), std::memory_order_relaxed);
+    playheadSequence.store(sequence + 2, std::memory_order_release);
+}
+
+DJAudioPlayer::PlayheadSnapshot DJAudioPlayer::getPlayhead()
+{
+    PlayheadSnapshot snapshot;
+    juce::uint32 before, after;
+    do
+    {
+        // retry if the audio thread was part way through publishing
+        before = playheadSequence.load(std::memory_order_acquire);
+        snapshot.samplePosition = playheadSamplePosition.load(std::memory_order_relaxed);
+        snapshot.sampleRate = playheadSampleRate.load(std::memory_order_relaxed);
+        snapshot.speed = playheadSpeed.load(std::memory_order_relaxed);
+        snapshot.hostTimeMs = playheadHostTimeMs.load(std::memory_order_relaxed);
+        snapshot.blockDurationMs = playheadBlockDurationMs.load(std::memory_order_relaxed);
+        snapshot.playing = playheadPlaying.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = playheadSequence.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1) != 0);
+    return snapshot;
+}
+
+double DJAudioPlayer::getExtrapolatedPosition(double frameTimeMs)
+{
+    PlayheadSnapshot playhead = getPlayhead();
+    if (playhead.sampleRate <= 0)
+        return getPosition();
+    double position = playhead.samplePosition / playhead.sampleRate;
+    if (playhead.playing)
+    {
+        // never run further ahead than a couple of blocks in case the audio thread stalls
+        double elapsedMs = juce::jlimit(0.0, playhead.blockDurationMs * 2, frameTimeMs - playhead.hostTimeMs);
+        position += elapsedMs / 1000 * playhead.speed;
+    }
+    return juce::jmin(position, transportSource.getLengthInSeconds());
+}
+
+LoudnessMeter::Readings DJAudioPlayer::getMeterReadings()
 {
-    std::vector<double> levels(2);
-    levels[0] = leftPeak;
-    levels[1] = rightPeak;
-    leftPeak = 0;
-    rightPeak = 0;
-    return levels;
+    return meter.getReadings();
 }
 
 bool DJAudioPlayer::hasStreamFinished()
@@ -11,7 +11,11 @@
 #pragma once
 #include <JuceHeader.h>
 #include <vector>
+#include <atomic>
+#include <limits>
 #include "BPMCalculator.h"
+#include "AudioTap.h"
+#include "LoudnessMeter.h"
 
 class DJAudioPlayer :
     public juce::AudioSource,
@@ -35,6 +39,20 @@ public:
     
     /** float of bpm for current playing track */
     float currentBPM;
+    
+    /** tap on the player output for the deck's analyser view */
+    AudioTap analyserTap;
+    
+    /** playhead as published by the audio thread at the end of each block */
+    struct PlayheadSnapshot
+    {
+        juce::int64     samplePosition;     // next read position of the transport
+        double          sampleRate;         // rate samplePosition is counted at
+        double          speed;              // resampling ratio the block was played at
+        double          hostTimeMs;         // millisecond counter time the block was rendered
+        double          blockDurationMs;    // length of the block in ms
+        bool            playing;
+    };
 
     /* ===================== */
     /* ====== methods ====== */
@@ -42,13 +60,55 @@ public:
     
     /**
      DJAudioPlayer::loadURL
-     Input                  juce::URL
+     Input                  juce::URL, float, float
      Output                 none
      @param audioURL        juce::URL passed from a DeckGUI for loading into the player
+     @param trackLoudness   integrated loudness of the track in LUFS, NaN if it isn't known
+     @param trackPeak       highest true peak of the track in dBTP, NaN if it isn't known
      Takes a resource locator, checks if file pointed to is valid audio
      If it is it creates a unique pointer to the file and sets it as the transport source of the player
+     The track is normalised to the target loudness from its first block, or left as it is if its loudness isn't known
+     */
+    void loadURL(URL audioURL, float trackLoudness = std::numeric_limits<float>::quiet_NaN(),
+                 float trackPeak = std::numeric_limits<float>::quiet_NaN());
+    
+    /**
+     DJAudioPlayer::setTrackLoudness()
+     Input                  float, float
+     Output                 none
+     @param lufs            integrated loudness of the loaded track, NaN if it isn't known
+     @param truePeak        highest true peak of the loaded track in dBTP, NaN if it isn't known
+     Sets the normalisation gain for the loaded track, for when its loudness is found after it was loaded
+     A track is only turned up as far as its peaks stay below maxTruePeakDb, and not at all if they aren't known
+     */
+    void setTrackLoudness(float lufs, float truePeak = std::numeric_limits<float>::quiet_NaN());
+    
+    /**
+     DJAudioPlayer::setTargetLoudness()
+     Input                  float
+     Output                 none
+     @param lufs            integrated loudness every track is normalised to
+     Sets the level tracks are normalised to, and renormalises the loaded track
+     */
+    void setTargetLoudness(float lufs);
+    
+    /**
+     DJAudioPlayer::setMixOut()
+     Input                  double
+     Output                 none
+     @param seconds         where in the loaded track the hand-off to the other deck starts, NaN for defaultMixOutSeconds before its end
+     Cached until the next track is loaded. The audio thread sends a change message as the playhead passes it, see takeMixOutReached()
+     Moving the point doesn't hand off again if the playhead is already past it
      */
-    void loadURL(URL audioURL);
+    void setMixOut(double seconds);
+    
+    /**
+     DJAudioPlayer::takeMixOutReached()
+     Input                  none
+     Output                 bool
+     Returns true once each time the playing track passes its mix out point, false until it crosses it again
+     */
+    bool takeMixOutReached();
     
     /**
      DJAudioPlayer::getGain()
@@ -113,13 +173,13 @@ public:
     int getLengthInSeconds();
     
     /**
-     DJAudioPlayer::getLevels()
+     DJAudioPlayer::getMeterReadings()
      Input                  none
-     Output                 vector<double> of left and right levels from the player
-     Returns the current stored peak levels to a DeckGUI for metering in range 0 - 1
-     Resets peak levels to zero
+     Output                 LoudnessMeter::Readings for the player
+     Returns the peak, true-peak, RMS and loudness of the player output to a DeckGUI
+     Peaks are the maximum since the last call
      */
-    std::vector<double> getLevels();
+    LoudnessMeter::Readings getMeterReadings();
     
     /** DJAudioPlayer::isPlaying()
      Input                  none
@@ -158,6 +218,25 @@ public:
      */
     double getPosition();
     
+    /**
+     DJAudioPlayer::getPlayhead()
+     Input                  none
+     Output                 PlayheadSnapshot
+     Lock-free read of the playhead last published by the audio thread
+     Safe to call from the message thread once per frame, or from any other thread
+     */
+    PlayheadSnapshot getPlayhead();
+    
+    /**
+     DJAudioPlayer::getExtrapolatedPosition()
+     Input                  double
+     Output                 double position in seconds
+     @param frameTimeMs     millisecond counter time of the frame being drawn
+     Extrapolates the published playhead forward to the given frame time
+     so the position moves smoothly between audio blocks
+     */
+    double getExtrapolatedPosition(double frameTimeMs);
+    
     /**
      DJAudioPlayer::hasStreamFinished()
      Input                  none
@@ -187,8 +266,50 @@ private:
     // native
     /** store current gain / crossfade levels */
     double currentGain, currentCrossfadeRatio;
-    /** store peak levels for left / right */
-    float leftPeak = 0, rightPeak = 0;
+    /** loudness of the loaded track and the level it is normalised to, in LUFS */
+    float trackLoudness = std::numeric_limits<float>::quiet_NaN(), targetLoudness = -14.0f;
+    /** highest true peak of the loaded track in dBTP */
+    float trackPeak = std::numeric_limits<float>::quiet_NaN();
+    /** linear gain taking the loaded track to targetLoudness, read by the audio thread */
+    std::atomic<double> normalisationGain{1.0};
+    /** most a track is turned up or down by normalisation */
+    static constexpr float maxNormalisationDb = 12.0f;
+    /** highest a normalised track's true peak may reach, in dBTP, leaving headroom for the resampler and EQ */
+    static constexpr float maxTruePeakDb = -1.0f;
+    /** where the loaded track hands off to the other deck in seconds, NaN for defaultMixOutSeconds before its end */
+    std::atomic<double> mixOut{std::numeric_limits<double>::quiet_NaN()};
+    /** set by the audio thread as the playhead passes mixOut, cleared as the playhead or mixOut are moved back */
+    std::atomic<bool> mixOutReached{false};
+    /** set alongside mixOutReached, cleared as the message thread takes it so each crossing hands off once */
+    std::atomic<bool> mixOutPending{false};
+    /** set by loadURL() so the audio thread resets the meter before metering the new track */
+    std::atomic<bool> meterNeedsReset{false};
+    /** how long before the end of a track without a known outro the hand-off starts */
+    static constexpr double defaultMixOutSeconds = 5.0;
+    /** meters the player output on the audio thread */
+    LoudnessMeter meter;
+    /** speed ratio, set from the GUI and read by the audio thread */
+    std::atomic<double> currentSpeed{1.0};
+    /** sample rate the player was prepared at */
+    double currentSampleRate = 0;
+    
+    // playhead fields, published by the audio thread as a seqlock
+    /** odd while the audio thread is writing the playhead */
+    std::atomic<juce::uint32> playheadSequence{0};
+    std::atomic<juce::int64> playheadSamplePosition{0};
+    std::atomic<double> playheadSampleRate{0}, playheadSpeed{1.0}, playheadHostTimeMs{0}, playheadBlockDurationMs{0};
+    std::atomic<bool> playheadPlaying{false};
+    
+    /**
+     DJAudioPlayer::publishPlayhead()
+     Input                  int number of samples in the block
+     Output                 none
+     Called by the audio thread after each block to publish the playhead
+     */
+    void publishPlayhead(int numSamples);
+    
+    /** DJAudioPlayer::updateNormalisationGain() recalculates normalisationGain from the track and target loudness */
+    void updateNormalisationGain();
     /** class to calculate the bpm of the currently playing song */
     BPMCalculator bpmCalculator;
 };
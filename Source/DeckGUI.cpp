@@ -15,9 +15,11 @@
 DeckGUI::DeckGUI(DJAudioPlayer* _player,
                  AudioFormatManager &formatManagerToUse,
                  AudioThumbnailCache &cacheToUse,
+                 FrameScheduler &_frameScheduler,
                  short int _guiID
                  ) :    guiID(_guiID),
                         player(_player),
+                        frameScheduler(_frameScheduler),
                         waveformDisplay(formatManagerToUse, cacheToUse)
 {
     // initialise settings
@@ -88,12 +90,12 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     addAndMakeVisible(levelL);
     addAndMakeVisible(levelR);
     
-    startTimer(100);
+    frameScheduler.addClient(this);
 }
 
 DeckGUI::~DeckGUI()
 {
-    stopTimer();
+    frameScheduler.removeClient(this);
     posSlider.setLookAndFeel(nullptr);
 }
 
@@ -106,14 +108,18 @@ void DeckGUI::paint (Graphics& g)
     g.setColour(infoTextColour);
     // show track time (5, 0) to (7, 0)
     c = 5; r = 0; w = 2; h = 1;
-    g.drawText(secondsToMinutesAndSeconds(posSlider.getValue()), colW * c + padding, rowH * r + padding, colW * w, rowH * h, Justification::centredLeft, true);
-    // show track name (1, 1) to (1, 6)
-    c = 1; r = 1; w = 7; h = 1;
+    displayedTrackTime = secondsToMinutesAndSeconds(posSlider.getValue());
+    g.drawText(displayedTrackTime, colW * c + padding, rowH * r + padding, colW * w, rowH * h, Justification::centredLeft, true);
+    // show track name (1, 1) to (1, 6), and key (7, 1) if known
+    c = 1; r = 1; w = currentTrackKey != "" ? 6 : 7; h = 1;
     if (currentTrackName != "")
     {
         g.setFont(18.0f);
         g.drawText(currentTrackName, colW * c + padding, rowH * r + padding, colW * w, rowH * h, Justification::centredLeft, true);
     }
+    c = 7; r = 1; w = 1; h = 1;
+    if (currentTrackKey != "")
+        g.drawText(currentTrackKey, colW * c + padding, rowH * r + padding, colW * w, rowH * h, Justification::centredRight, true);
     g.setColour(warningTextColour);
     // status (1, 2)
     c = 1; r = 2; w = 2; h = 1;
@@ -165,6 +171,9 @@ void DeckGUI::resized()
     colW = (getWidth() - (padding * 2)) / 8;
     int c, r, w, h;                                                     // column, row, width, height - count from 0
     // fixed position elements
+    // track time (5, 0) to (7, 0)
+    c = 5; r = 0; w = 2; h = 1;
+    trackTimeArea = juce::Rectangle<double>(colW * c + padding, rowH * r + padding, colW * w, rowH * h).getSmallestIntegerContainer();
     // posSlider (1, 5) to (8, 6)
     c = 1; r = 5; w = 7; h = 3;
     posSlider.setBounds(colW * c + padding, rowH * r  + padding, colW * w, rowH * h);
@@ -275,7 +284,10 @@ void DeckGUI::sliderValueChanged(Slider* slider)
         if (slider == &speedSlider)
             player->setSpeed(slider->getValue());
         if (slider == &posSlider)
+        {
             player->setPosition(slider->getValue());
+            repaint(trackTimeArea);
+        }
 }
 
 bool DeckGUI::isInterestedInFileDrag (const StringArray &files)
@@ -294,34 +306,36 @@ void DeckGUI::filesDropped (const StringArray &files, int x, int y)
     }
 }
 
-void DeckGUI::timerCallback()
+bool DeckGUI::frameCallback(double frameTimeMs)
 {
-    if (player->isPlaying())
+    bool playing = player->isPlaying();
+    if (playing)
     {
-        // update slider position as track plays
-        posSlider.setValue(player->getPosition(), juce::dontSendNotification);
+        // update slider position as track plays, extrapolated to this frame
+        double position = player->getExtrapolatedPosition(frameTimeMs);
+        posSlider.setValue(position, juce::dontSendNotification);
         // update level meters
-        std::vector<double> audioLevels = player->getLevels();
-        levelL.displayLevel(audioLevels[0]);
-        levelR.displayLevel(audioLevels[1]);
-        // send message if less than 5 seconds from the end
-        if (player->getLengthInSeconds() - player->getPosition() < 5 && !streamNearlyEnded)
-        {
-            streamNearlyEnded = true;
-            sendChangeMessage();
-        }
+        LoudnessMeter::Readings readings = player->getMeterReadings();
+        levelL.displayLevels(readings.rms[0], readings.truePeak[0]);
+        levelR.displayLevels(readings.rms[1], readings.truePeak[1]);
     }
     else
     {
-        levelL.displayLevel(0);
-        levelR.displayLevel(0);
+        levelL.displayLevels(0, 0);
+        levelR.displayLevels(0, 0);
     }
-    if ((bpm != (int)player->currentBPM && isPlaying()) || targetBpm == -1)
+    if ((bpm != (int)player->currentBPM && playing) || targetBpm == -1)
     {
+        bool bpmChanged = bpm != (int)player->currentBPM;
         bpm = (int)player->currentBPM;
         sendChangeMessage();
+        if (bpmChanged)
+            repaint();
     }
-    repaint();
+    // only repaint the track time when the displayed text changes
+    if (secondsToMinutesAndSeconds(posSlider.getValue()) != displayedTrackTime)
+        repaint(trackTimeArea);
+    return playing || levelL.isActive() || levelR.isActive();
 }
 
 bool DeckGUI::keyPressed (const KeyPress &key)
@@ -333,9 +347,9 @@ bool DeckGUI::keyPressed (const KeyPress &key)
     return true;
 }
 
-void DeckGUI::loadFile(juce::URL url)
+void DeckGUI::loadFile(juce::URL url, float loudness, float truePeak)
 {
-    player->loadURL(url);
+    player->loadURL(url, loudness, truePeak);
     playerStatus = "Queued";
     waveformDisplay.loadURL(url);
     // update slider with length in seconds of new file
@@ -344,12 +358,29 @@ void DeckGUI::loadFile(juce::URL url)
     // initialise gain and crossfade
     player->setGain(volSlider.getValue()/100);
     player->setCrossfadeRatio(currentCrossfadeRatio);
+    // the library sets these after loading its own tracks
+    currentLibraryId = -1;
+    currentTrackKey = "";
+    trackStart = 0;
     // initialise bpm, stream ended and stream nearly ended
     bpm = -1;
     sendChangeMessage();
     streamEnded = false;
     streamNearlyEnded = false;
     fileLoaded = true;
+    repaint();
+    frameScheduler.wake();
+}
+
+void DeckGUI::setTrackLoudness(float lufs, float truePeak)
+{
+    player->setTrackLoudness(lufs, truePeak);
+}
+
+void DeckGUI::setMixPoints(double _trackStart, double mixOut)
+{
+    trackStart = _trackStart;
+    player->setMixOut(mixOut);
 }
 
 // reduce volume when dragging through track
@@ -380,7 +411,7 @@ void DeckGUI::play()
 {
     if (streamEnded)
     {
-        posSlider.setValue(0);
+        toTrackStart();
         streamEnded = false;
         streamNearlyEnded = false;
         playerStatus = "Queued";
@@ -398,19 +429,28 @@ void DeckGUI::play()
         player->start();
         playerStatus = "Playing";
     }
+    repaint();
+    frameScheduler.wake();
 }
 void DeckGUI::changeListenerCallback(juce::ChangeBroadcaster* source)
 {
+    // the player notices its mix out point on the audio thread, so the hand-off doesn't wait on a frame
+    if (source == player && player->takeMixOutReached())
+    {
+        streamNearlyEnded = true;
+        sendChangeMessage();
+    }
     if (source == player && player->getPosition() >= player->getLengthInSeconds() && !streamEnded)
     {
         streamEnded = true;
         sendChangeMessage();
     }
+    repaint();
 }
 
 void DeckGUI::toTrackStart()
 {
-    posSlider.setValue(0);
+    posSlider.setValue(trackStart);
 }
 
 void DeckGUI::openFileChooser()
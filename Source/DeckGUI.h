@@ -15,6 +15,7 @@
 #include "WaveformDisplay.h"
 #include "LevelMeter.h"
 #include "OtoDecksLookAndFeel.h"
+#include "FrameScheduler.h"
 
 
 //==============================================================================
@@ -26,12 +27,13 @@ class DeckGUI    :  public juce::Component,
                     public juce::ChangeBroadcaster,
                     public juce::ChangeListener,
                     public juce::FileDragAndDropTarget,
-                    public juce::Timer
+                    public FrameScheduler::Client
 {
 public:
     DeckGUI(DJAudioPlayer* _player,
             juce::AudioFormatManager &formatManagerToUse,
             juce::AudioThumbnailCache &cacheToUse,
+            FrameScheduler &_frameScheduler,
             short int _guiID);
     ~DeckGUI();
 
@@ -43,12 +45,16 @@ public:
     /* ====== properties ====== */
     /* ======================== */
     
-    /** flags for end of track */
+    /** flags for end of track, streamNearlyEnded is set as the track passes its mix out point and cleared once the hand-off starts */
     bool streamEnded = false, streamNearlyEnded = false;
     /** flag for whether player has a file loaded */
     bool fileLoaded = false;
     /** display name for loaded audio file */
     juce::String currentTrackName;
+    /** library id of the loaded file, -1 if it wasn't loaded from the library */
+    long int currentLibraryId = -1;
+    /** Camelot key of the loaded file, empty if it isn't known */
+    juce::String currentTrackKey;
     /** store this track's est. bpm, and the bpm in the other player */
     int bpm, targetBpm;
     
@@ -58,13 +64,34 @@ public:
     
     /**
      DeckGUI::loadFile()
-     Input                  juce::URL
+     Input                  juce::URL, float, float
      Output                 none
      @param url             juce::URL of an audio file to be loaded into the player
+     @param loudness        integrated loudness of the file in LUFS if known, the player normalises it
+     @param truePeak        highest true peak of the file in dBTP if known, limits how far the player turns it up
      Takes passed URL, loads it into associated player and waveform display
      Initialises player, GUI and DeckGUI flags read by PlaylistComponent
      */
-    void loadFile(juce::URL url);
+    void loadFile(juce::URL url, float loudness = std::numeric_limits<float>::quiet_NaN(),
+                  float truePeak = std::numeric_limits<float>::quiet_NaN());
+    
+    /**
+     DeckGUI::setTrackLoudness()
+     Input                  float, float
+     Output                 none
+     Passes the loudness and true peak of the loaded file to the player, for a file whose loudness was found after it was loaded
+     */
+    void setTrackLoudness(float lufs, float truePeak);
+    
+    /**
+     DeckGUI::setMixPoints()
+     Input                  double, double
+     Output                 none
+     @param _trackStart     where the loaded file's sound starts in seconds, toTrackStart() goes here
+     @param mixOut          where the player starts the hand-off to the other deck, see DJAudioPlayer::setMixOut()
+     Sets the points the library found for the loaded file, reset by loadFile()
+     */
+    void setMixPoints(double _trackStart, double mixOut);
     
     /**
      DeckGUI::play()
@@ -87,7 +114,7 @@ public:
      DeckGUI::toTrackStart()
      Input                  none
      Output                 none
-     Sets associated player transport to beginning of audio file
+     Sets associated player transport to where the sound of the audio file starts, past any leading silence
      */
     void toTrackStart();
     
@@ -129,11 +156,19 @@ private:
     bool isInterestedInFileDrag (const juce::StringArray &files) override;
     void filesDropped (const juce::StringArray &files, int x, int y) override;
     
-    // implement changeListener */
+    // implement changeListener, sets the end of track flags as the player reaches its mix out point and its end */
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     
-    // implement timer */
-    void timerCallback() override;
+    // implement FrameScheduler::Client */
+    /**
+     DeckGUI::frameCallback()
+     Input                  double frame time in ms
+     Output                 bool
+     Updates the position slider and meters from the player
+     Repaints only the parts of the deck that have changed
+     Returns true while the player is playing or the meters are still falling back
+     */
+    bool frameCallback(double frameTimeMs) override;
     
     /* ======================== */
     /* ====== properties ====== */
@@ -155,9 +190,15 @@ private:
     /** stores current crossfade ratio */
     double currentCrossfadeRatio;
     
+    /** where the loaded file's sound starts in seconds, 0 unless the library knows */
+    double trackStart = 0;
+    
     /** pointer to DJAudioPlayer which the GUI will interact with */
     DJAudioPlayer* player;
     
+    /** app frame tick, woken whenever this deck starts animating */
+    FrameScheduler& frameScheduler;
+    
     /** object to display audio waveform thumbnail */
     WaveformDisplay waveformDisplay;
     
@@ -169,6 +210,10 @@ private:
     float padding;
     /** class variables for meter layout */
     double meterWidth, meterMargin, meterBetween;
+    /** area the track time is drawn in, repainted on its own as the track plays */
+    juce::Rectangle<int> trackTimeArea;
+    /** the track time text as last painted */
+    juce::String displayedTrackTime;
     // these above don't need class scope, but hey ho, I can afford a handful of wasted bytes
     
     /** stores the current status of the player: no file loaded, play, stop, queued */
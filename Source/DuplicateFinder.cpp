@@ -0,0 +1,353 @@
+/*
+  ==============================================================================
+
+    DuplicateFinder.cpp
+    Created: 2 Nov 2026 4:05:41pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "DuplicateFinder.h"
+#include "Fingerprinter.h"
+#include "LibraryJournal.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+
+constexpr int DuplicateFinder::startDelayMs;
+constexpr int DuplicateFinder::saveInterval;
+constexpr int DuplicateFinder::keyWords;
+constexpr int DuplicateFinder::maxTracksPerKey;
+constexpr int DuplicateFinder::minSharedKeys;
+constexpr int DuplicateFinder::maxOffsetWords;
+constexpr float DuplicateFinder::maxBitErrorRate;
+
+namespace
+{
+    const char storeMagic[4] = { 'O', 'T', 'F', 'P' };
+    const juce::uint32 storeVersion = 1;
+
+    template <typename Value>
+    void appendValue(std::string& data, Value value)
+    {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(Value));
+    }
+
+    template <typename Value>
+    bool readValue(const std::string& data, size_t& position, Value& value)
+    {
+        if (data.size() - position < sizeof(Value))
+            return false;
+        std::memcpy(&value, data.data() + position, sizeof(Value));
+        position += sizeof(Value);
+        return true;
+    }
+}
+
+DuplicateFinder::DuplicateFinder(const juce::File& _storeFile) :
+                                    juce::Thread("duplicate finder"),
+                                    storeFile(_storeFile)
+{
+    startThread(1);
+}
+
+DuplicateFinder::~DuplicateFinder()
+{
+    cancelPendingUpdate();
+    cancelled = true;
+    stopThread(4000);
+}
+
+/* ================================= */
+/* ====== message thread side ====== */
+/* ================================= */
+
+void DuplicateFinder::addFingerprint(long int libraryId, const TrackStore::FileSignature& signature, std::vector<juce::uint32> words)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        StoredFingerprint fingerprint;
+        fingerprint.signature = signature;
+        fingerprint.words = std::move(words);
+        pendingFingerprints.emplace_back(libraryId, std::move(fingerprint));
+    }
+    notify();
+}
+
+void DuplicateFinder::findDuplicates(const std::vector<Track>& tracks)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        pendingTracks = tracks;
+        hasPendingTracks = true;
+        // a search already running stops at its next track
+        cancelled = true;
+    }
+    notify();
+}
+
+void DuplicateFinder::handleAsyncUpdate()
+{
+    std::vector<std::vector<long int>> groups;
+    std::vector<long int> missing;
+    bool ready;
+    {
+        const juce::ScopedLock sl(lock);
+        groups.swap(readyGroups);
+        missing.swap(readyMissing);
+        ready = groupsReady;
+        groupsReady = false;
+    }
+    if (!ready)
+        return;
+    if (!missing.empty() && onMissing)
+        onMissing(missing);
+    if (onGroups)
+        onGroups(groups);
+}
+
+/* ================================ */
+/* ====== finder thread side ====== */
+/* ================================ */
+
+void DuplicateFinder::run()
+{
+    int unsaved = 0;
+    while (!threadShouldExit())
+    {
+        wait(-1);
+        if (!loaded)
+        {
+            // let the app finish starting before touching the disk, anything sent meanwhile waits
+            const juce::uint32 startMs = juce::Time::getMillisecondCounter();
+            for (int elapsed = 0; elapsed < startDelayMs && !threadShouldExit(); elapsed = (int)(juce::Time::getMillisecondCounter() - startMs))
+                wait(startDelayMs - elapsed);
+            if (threadShouldExit())
+                break;
+            load();
+            loaded = true;
+        }
+        std::vector<Track> tracks;
+        std::vector<std::pair<long int, StoredFingerprint>> newFingerprints;
+        bool hasTracks;
+        {
+            const juce::ScopedLock sl(lock);
+            newFingerprints.swap(pendingFingerprints);
+            tracks.swap(pendingTracks);
+            hasTracks = hasPendingTracks;
+            hasPendingTracks = false;
+            cancelled = false;
+        }
+        for (auto& fingerprint : newFingerprints)
+        {
+            fingerprints[fingerprint.first] = std::move(fingerprint.second);
+            ++unsaved;
+        }
+        if (hasTracks)
+        {
+            // tracks that have left the library, or whose file has changed, are forgotten
+            std::unordered_map<long int, const TrackStore::FileSignature*> librarySignatures;
+            for (const Track& track : tracks)
+                librarySignatures[track.libraryId] = &track.signature;
+            for (auto stored = fingerprints.begin(); stored != fingerprints.end(); )
+            {
+                auto track = librarySignatures.find(stored->first);
+                if (track == librarySignatures.end() || *track->second != stored->second.signature)
+                {
+                    stored = fingerprints.erase(stored);
+                    ++unsaved;
+                }
+                else
+                    ++stored;
+            }
+        }
+        if (unsaved >= saveInterval || (hasTracks && unsaved > 0))
+        {
+            save();
+            unsaved = 0;
+        }
+        if (!hasTracks || cancelled.load() || threadShouldExit())
+            continue;
+
+        const std::vector<juce::uint32> noFingerprint;
+        std::vector<const std::vector<juce::uint32>*> trackFingerprints;
+        std::vector<long int> missing;
+        trackFingerprints.reserve(tracks.size());
+        for (const Track& track : tracks)
+        {
+            auto stored = fingerprints.find(track.libraryId);
+            trackFingerprints.push_back(stored != fingerprints.end() ? &stored->second.words : &noFingerprint);
+            if (stored == fingerprints.end())
+                missing.push_back(track.libraryId);
+        }
+        std::vector<std::vector<long int>> groups;
+        for (const std::vector<size_t>& indexGroup : groupFingerprints(trackFingerprints))
+        {
+            std::vector<long int> group;
+            for (size_t index : indexGroup)
+                group.push_back(tracks[index].libraryId);
+            groups.push_back(std::move(group));
+        }
+        {
+            const juce::ScopedLock sl(lock);
+            readyGroups.swap(groups);
+            readyMissing.swap(missing);
+            groupsReady = true;
+        }
+        triggerAsyncUpdate();
+    }
+    // fingerprints kept since the last save would otherwise be taken again next time
+    if (loaded && unsaved > 0)
+        save();
+}
+
+std::vector<std::vector<size_t>> DuplicateFinder::groupFingerprints(const std::vector<const std::vector<juce::uint32>*>& fingerprints)
+{
+    // each entry is a key in the top 32 bits and a fingerprint index in the bottom 32
+    std::vector<juce::uint64> entries;
+    for (size_t index = 0; index < fingerprints.size(); ++index)
+    {
+        const std::vector<juce::uint32>& words = *fingerprints[index];
+        if ((int)words.size() < keyWords)
+            continue;
+        juce::uint32 previousKey = 0;
+        for (size_t start = 0; start + keyWords <= words.size(); ++start)
+        {
+            // counts the set bits of the window's words in all 32 positions at once, a 3 bit counter
+            // per position, whose top bit is then set where 4 or more of the 7 words had the bit set
+            juce::uint32 ones = 0, twos = 0, fours = 0;
+            for (size_t i = start; i < start + keyWords; ++i)
+            {
+                juce::uint32 carry = ones & words[i];
+                ones ^= words[i];
+                fours |= twos & carry;
+                twos ^= carry;
+            }
+            juce::uint32 key = fours;
+            // neighbouring windows often vote the same, one entry stands for the run
+            if (key != previousKey && key != 0 && key != 0xffffffffu)
+                entries.push_back(((juce::uint64)key << 32) | (juce::uint64)index);
+            previousKey = key;
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    // every pair of fingerprints sharing a key, once per key, lower index in the top 32 bits
+    std::vector<juce::uint64> pairs;
+    for (size_t first = 0; first < entries.size(); )
+    {
+        size_t end = first + 1;
+        while (end < entries.size() && (entries[end] >> 32) == (entries[first] >> 32))
+            ++end;
+        if (end - first <= (size_t)maxTracksPerKey)
+            for (size_t a = first; a < end; ++a)
+                for (size_t b = a + 1; b < end; ++b)
+                    pairs.push_back((entries[a] << 32) | (entries[b] & 0xffffffffu));
+        first = end;
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    // pairs sharing enough keys are compared in full, and matches joined into groups
+    std::vector<size_t> parents(fingerprints.size());
+    for (size_t index = 0; index < parents.size(); ++index)
+        parents[index] = index;
+    auto findRoot = [&parents] (size_t index)
+    {
+        while (parents[index] != index)
+        {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    };
+    for (size_t first = 0; first < pairs.size(); )
+    {
+        size_t end = first + 1;
+        while (end < pairs.size() && pairs[end] == pairs[first])
+            ++end;
+        size_t a = (size_t)(pairs[first] >> 32), b = (size_t)(pairs[first] & 0xffffffffu);
+        if (end - first >= (size_t)minSharedKeys && findRoot(a) != findRoot(b)
+            && Fingerprinter::compare(*fingerprints[a], *fingerprints[b], maxOffsetWords) <= maxBitErrorRate)
+            parents[findRoot(b)] = findRoot(a);
+        first = end;
+    }
+
+    std::unordered_map<size_t, size_t> groupOfRoot;
+    std::vector<std::vector<size_t>> groups;
+    for (size_t index = 0; index < parents.size(); ++index)
+    {
+        size_t root = findRoot(index);
+        auto group = groupOfRoot.find(root);
+        if (group == groupOfRoot.end())
+        {
+            groupOfRoot[root] = groups.size();
+            groups.push_back({ index });
+        }
+        else
+            groups[group->second].push_back(index);
+    }
+    // tracks that matched nothing are groups of one
+    groups.erase(std::remove_if(groups.begin(), groups.end(),
+                                [] (const std::vector<size_t>& group) { return group.size() < 2; }),
+                 groups.end());
+    return groups;
+}
+
+void DuplicateFinder::load()
+{
+    fingerprints.clear();
+    std::ifstream in(storeFile.getFullPathName().toStdString(), std::ios::binary);
+    if (!in.is_open())
+        return;
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t position = 0;
+    juce::uint32 version = 0, count = 0;
+    bool valid = data.size() >= sizeof(storeMagic) && std::memcmp(data.data(), storeMagic, sizeof(storeMagic)) == 0;
+    position = sizeof(storeMagic);
+    valid = valid && readValue(data, position, version) && version == storeVersion && readValue(data, position, count);
+    for (juce::uint32 i = 0; valid && i < count; ++i)
+    {
+        juce::int64 libraryId = 0;
+        juce::uint32 numWords = 0;
+        StoredFingerprint fingerprint;
+        valid = readValue(data, position, libraryId)
+             && readValue(data, position, fingerprint.signature.modified)
+             && readValue(data, position, fingerprint.signature.size)
+             && readValue(data, position, fingerprint.signature.fileId)
+             && readValue(data, position, numWords)
+             && numWords <= (juce::uint32)Fingerprinter::maxWords
+             && data.size() - position >= numWords * sizeof(juce::uint32);
+        if (!valid)
+            break;
+        fingerprint.words.resize(numWords);
+        std::memcpy(fingerprint.words.data(), data.data() + position, numWords * sizeof(juce::uint32));
+        position += numWords * sizeof(juce::uint32);
+        fingerprints[(long int)libraryId] = std::move(fingerprint);
+    }
+    if (!valid)
+    {
+        std::cout << "DuplicateFinder::load: " << storeFile.getFullPathName() << " is damaged, fingerprinting the library again" << std::endl;
+        fingerprints.clear();
+    }
+}
+
+void DuplicateFinder::save()
+{
+    std::string data(storeMagic, sizeof(storeMagic));
+    appendValue(data, storeVersion);
+    appendValue(data, (juce::uint32)fingerprints.size());
+    for (const auto& stored : fingerprints)
+    {
+        appendValue(data, (juce::int64)stored.first);
+        appendValue(data, stored.second.signature.modified);
+        appendValue(data, stored.second.signature.size);
+        appendValue(data, stored.second.signature.fileId);
+        appendValue(data, (juce::uint32)stored.second.words.size());
+        data.append(reinterpret_cast<const char*>(stored.second.words.data()), stored.second.words.size() * sizeof(juce::uint32));
+    }
+    if (!LibraryJournal::writeFileDurably(storeFile, data))
+        std::cout << "DuplicateFinder::save: could not write " << storeFile.getFullPathName() << std::endl;
+}
@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    DuplicateFinder.h
+    Created: 2 Nov 2026 4:05:41pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <atomic>
+#include <functional>
+#include "TrackStore.h"
+
+//==============================================================================
+/*
+ Finds tracks in the library that are the same recording, whatever their
+ file names, formats or bitrates
+ Each track is fingerprinted by the TrackAnalyser pipeline as it is analysed, and the
+ fingerprints are kept in their own file along with the file signature they
+ were taken from, so a fingerprint of a file that has since changed is never matched
+ Matching is locality sensitive. Every few words of a fingerprint are folded into
+ a key by a majority vote of each bit, which the same recording almost always
+ reproduces even where single words differ, and only tracks sharing several keys
+ are compared in full. So matching a whole library takes one sort of its keys
+ rather than comparing every pair of tracks
+*/
+class DuplicateFinder  : private juce::Thread,
+                         private juce::AsyncUpdater
+{
+public:
+    /**
+     DuplicateFinder::DuplicateFinder()
+     @param _storeFile      where fingerprints are kept between runs
+     */
+    DuplicateFinder(const juce::File& _storeFile);
+    ~DuplicateFinder() override;
+
+    /** a library track to match */
+    struct Track
+    {
+        long int                    libraryId;
+        TrackStore::FileSignature   signature;
+    };
+
+    /** called on the message thread with every group of duplicates, each in the order the tracks were given */
+    std::function<void(std::vector<std::vector<long int>>&)> onGroups;
+    /** called on the message thread, before onGroups, with the tracks that had no fingerprint of their current file */
+    std::function<void(std::vector<long int>&)> onMissing;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     DuplicateFinder::addFingerprint()
+     Input                  long int, TrackStore::FileSignature, std::vector<juce::uint32>
+     Output                 none
+     @param words           empty for a file with no sound or that couldn't be decoded
+     Keeps a track's fingerprint, replacing any older one, to be matched from the next findDuplicates()
+     */
+    void addFingerprint(long int libraryId, const TrackStore::FileSignature& signature, std::vector<juce::uint32> words);
+
+    /**
+     DuplicateFinder::findDuplicates()
+     Input                  std::vector<Track>
+     Output                 none
+     Matches the fingerprints of the tracks and calls onGroups
+     Tracks that aren't given, and fingerprints of files that have since changed, are forgotten
+     Replaces any search still running
+     */
+    void findDuplicates(const std::vector<Track>& tracks);
+
+    /**
+     DuplicateFinder::groupFingerprints()
+     Input                  std::vector<const std::vector<juce::uint32>*>
+     Output                 std::vector<std::vector<size_t>>
+     Returns the indices of the fingerprints that match, in groups of two or more, each in index order
+     Safe to call from any thread
+     */
+    static std::vector<std::vector<size_t>> groupFingerprints(const std::vector<const std::vector<juce::uint32>*>& fingerprints);
+
+private:
+    /** a fingerprint and the file it was taken from */
+    struct StoredFingerprint
+    {
+        TrackStore::FileSignature   signature;
+        /** empty for a file with no sound, or that couldn't be read */
+        std::vector<juce::uint32>   words;
+    };
+
+    // implement Thread
+    void run() override;
+    // implement AsyncUpdater
+    void handleAsyncUpdate() override;
+
+    /** DuplicateFinder::load() reads the store file, starting empty if it is missing or damaged */
+    void load();
+    /** DuplicateFinder::save() writes every fingerprint to the store file */
+    void save();
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    juce::File storeFile;
+
+    /** fingerprints by library id, only used on the finder thread */
+    std::unordered_map<long int, StoredFingerprint> fingerprints;
+    bool loaded = false;
+
+    /** guards everything below that both threads use */
+    juce::CriticalSection lock;
+    /** tracks waiting to be matched */
+    std::vector<Track> pendingTracks;
+    bool hasPendingTracks = false;
+    /** fingerprints waiting to be kept */
+    std::vector<std::pair<long int, StoredFingerprint>> pendingFingerprints;
+    /** groups from a finished search waiting for the message thread */
+    std::vector<std::vector<long int>> readyGroups;
+    std::vector<long int> readyMissing;
+    bool groupsReady = false;
+
+    std::atomic<bool> cancelled {false};
+
+    /** how long after the finder starts the store is loaded, so the app can finish starting */
+    static constexpr int startDelayMs = 10000;
+    /** new fingerprints kept between saves, which also happen after each search and as the app closes */
+    static constexpr int saveInterval = 200;
+    /** words folded into each key, 7 so every bit has a majority and a 3 bit count finds it */
+    static constexpr int keyWords = 7;
+    /** keys shared by so many tracks they say nothing, such as from near silence, are skipped */
+    static constexpr int maxTracksPerKey = 64;
+    /** keys two tracks have to share before they are compared in full */
+    static constexpr int minSharedKeys = 3;
+    /** furthest two fingerprints are slid against each other when compared, in words */
+    static constexpr int maxOffsetWords = 48;
+    /** most bits that can differ between fingerprints of the same recording */
+    static constexpr float maxBitErrorRate = 0.3f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DuplicateFinder)
+};
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    Fingerprinter.cpp
+    Created: 2 Nov 2026 11:38:22am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "Fingerprinter.h"
+#include <cmath>
+
+constexpr int Fingerprinter::maxWords;
+constexpr int Fingerprinter::fftOrder;
+constexpr int Fingerprinter::fftSize;
+constexpr double Fingerprinter::targetSampleRate;
+constexpr double Fingerprinter::hopSeconds;
+constexpr float Fingerprinter::onsetLevel;
+constexpr int Fingerprinter::smoothingFrames;
+constexpr int Fingerprinter::historyFrames;
+constexpr int Fingerprinter::minOverlapWords;
+
+Fingerprinter::Fingerprinter(double sampleRate) :
+                                    decimation(juce::jmax(1, juce::roundToInt(sampleRate / targetSampleRate))),
+                                    samples((size_t)fftSize, 0.0f),
+                                    hopInputSamples(hopSeconds * sampleRate),
+                                    binPitchClasses((size_t)fftSize / 2 + 1, -1),
+                                    fftData((size_t)fftSize * 2, 0.0f)
+{
+    // the range where most pitched instruments and voices have their fundamentals and first harmonics
+    const double binWidth = sampleRate / decimation / fftSize;
+    for (int bin = 1; bin <= fftSize / 2; ++bin)
+    {
+        double frequency = bin * binWidth;
+        if (frequency >= 110.0 && frequency <= 2000.0)
+        {
+            int semitone = juce::roundToInt(12.0 * std::log2(frequency / 440.0));
+            binPitchClasses[(size_t)bin] = ((semitone % 12) + 12) % 12;
+        }
+    }
+    words.reserve(maxWords);
+}
+
+Fingerprinter::~Fingerprinter()
+{
+}
+
+void Fingerprinter::process(const float* const* channels, int numChannels, int numSamples)
+{
+    if (numChannels <= 0)
+        return;
+    const float channelGain = 1.0f / (float)numChannels;
+    for (int i = 0; i < numSamples && !isComplete(); ++i)
+    {
+        float sample = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+            sample += channels[channel][i];
+        sample *= channelGain;
+        if (!started && std::abs(sample) > onsetLevel)
+        {
+            // the first frame is centred on the first sound
+            started = true;
+            nextFrame = (double)inputPosition + 0.5 * fftSize * decimation;
+        }
+        ++inputPosition;
+        decimatedSum += sample;
+        if (++decimatedCount == decimation)
+        {
+            samples[(size_t)samplePosition] = decimatedSum / (float)decimation;
+            samplePosition = (samplePosition + 1) % fftSize;
+            decimatedSum = 0.0f;
+            decimatedCount = 0;
+        }
+        if (started && (double)inputPosition >= nextFrame)
+        {
+            processFrame();
+            nextFrame += hopInputSamples;
+        }
+    }
+}
+
+bool Fingerprinter::isComplete() const
+{
+    return (int)words.size() >= maxWords;
+}
+
+const std::vector<juce::uint32>& Fingerprinter::getFingerprint() const
+{
+    return words;
+}
+
+void Fingerprinter::processFrame()
+{
+    // oldest sample first
+    for (int i = 0; i < fftSize; ++i)
+        fftData[(size_t)i] = samples[(size_t)((samplePosition + i) % fftSize)];
+    window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.0f);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    std::array<float, 12>& chroma = chromas[(size_t)(numChromas % historyFrames)];
+    chroma.fill(0.0f);
+    float total = 0.0f;
+    for (int bin = 1; bin <= fftSize / 2; ++bin)
+    {
+        int pitchClass = binPitchClasses[(size_t)bin];
+        if (pitchClass < 0)
+            continue;
+        float energy = fftData[(size_t)bin] * fftData[(size_t)bin];
+        chroma[(size_t)pitchClass] += energy;
+        total += energy;
+    }
+    for (float& value : chroma)
+        value = total > 0.0f ? value / total : 0.0f;
+    if (++numChromas < historyFrames)
+        return;
+
+    // the sum of the smoothingFrames chromas ending age frames ago
+    auto smoothed = [this] (int age)
+    {
+        std::array<float, 12> sum;
+        sum.fill(0.0f);
+        for (int frame = 0; frame < smoothingFrames; ++frame)
+        {
+            const std::array<float, 12>& chromaAtFrame = chromas[(size_t)((numChromas - 1 - age - frame) % historyFrames)];
+            for (size_t pitchClass = 0; pitchClass < 12; ++pitchClass)
+                sum[pitchClass] += chromaAtFrame[pitchClass];
+        }
+        return sum;
+    };
+    const std::array<float, 12> now = smoothed(0), before = smoothed(2), earlier = smoothed(smoothingFrames);
+    // every bit compares a change, so a steady chroma profile, like the key a track is in, cancels out
+    juce::uint32 word = 0;
+    for (size_t i = 0; i < 12; ++i)
+    {
+        size_t next = (i + 1) % 12, fifth = (i + 7) % 12;
+        if ((now[i] - now[next]) - (before[i] - before[next]) > 0.0f)
+            word |= 1u << i;
+        if (now[i] - earlier[i] > 0.0f)
+            word |= 1u << (12 + i);
+        if (i < 8 && (now[i] - now[fifth]) - (earlier[i] - earlier[fifth]) > 0.0f)
+            word |= 1u << (24 + i);
+    }
+    words.push_back(word);
+}
+
+float Fingerprinter::compare(const std::vector<juce::uint32>& first, const std::vector<juce::uint32>& second, int maxOffset)
+{
+    const int firstSize = (int)first.size(), secondSize = (int)second.size();
+    const int minOverlap = juce::jmin(minOverlapWords, juce::jmin(firstSize, secondSize));
+    float best = 1.0f;
+    if (minOverlap < minOverlapWords / 2)
+        return best;
+    // second[i + offset] lines up with first[i]
+    for (int offset = -maxOffset; offset <= maxOffset; ++offset)
+    {
+        int start = juce::jmax(0, -offset), end = juce::jmin(firstSize, secondSize - offset);
+        if (end - start < minOverlap)
+            continue;
+        int differentBits = 0;
+        for (int i = start; i < end; ++i)
+            differentBits += juce::countNumberOfBits(first[(size_t)i] ^ second[(size_t)(i + offset)]);
+        best = juce::jmin(best, (float)differentBits / (float)(32 * (end - start)));
+    }
+    return best;
+}
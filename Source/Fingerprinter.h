@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    Fingerprinter.h
+    Created: 2 Nov 2026 11:38:22am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <array>
+
+//==============================================================================
+/*
+ Compact acoustic fingerprint of the start of a track, for finding the same
+ recording under a different file name, format or bitrate
+ Audio is mixed to mono and decimated to about 5.5kHz, then a 12 bin chroma is
+ taken every 186ms and smoothed over 4 frames. Each frame gives a 32 bit
+ word whose bits say which way the chroma is changing, between neighbouring
+ pitch classes and over time, so the key a track is in or its level have no
+ effect, only how its harmony moves. Frames are timed from the first sound rather
+ than the start of the file, so leading silence and the sample rate don't shift them
+ Two fingerprints of the same recording differ in few bits once aligned, two
+ different recordings in about half of them
+ Audio is fed in blocks, so the fingerprint can be taken alongside other analysis
+*/
+class Fingerprinter
+{
+public:
+    Fingerprinter(double sampleRate);
+    ~Fingerprinter();
+
+    /** 32 bit words in a complete fingerprint, about 30 seconds of audio */
+    static constexpr int maxWords = 160;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     Fingerprinter::process()
+     Input                  const float* const*, int, int
+     Output                 none
+     Adds a block of audio, mixing its channels to mono. Does nothing once the fingerprint is complete
+     */
+    void process(const float* const* channels, int numChannels, int numSamples);
+
+    /** Fingerprinter::isComplete() returns true once maxWords words have been taken */
+    bool isComplete() const;
+
+    /** Fingerprinter::getFingerprint() returns the words taken so far, shorter than maxWords for a short track */
+    const std::vector<juce::uint32>& getFingerprint() const;
+
+    /**
+     Fingerprinter::compare()
+     Input                  std::vector<juce::uint32>, std::vector<juce::uint32>, int
+     Output                 float
+     @param maxOffset       furthest the fingerprints are slid against each other, in words
+     Returns the fraction of bits that differ where the fingerprints line up best, about 0.5
+     for different recordings, or 1 if they are too short to overlap by enough
+     */
+    static float compare(const std::vector<juce::uint32>& first, const std::vector<juce::uint32>& second, int maxOffset);
+
+private:
+    /** Fingerprinter::processFrame() turns the frame ending at the latest sample into a chroma, and a word once there are enough */
+    void processFrame();
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr double targetSampleRate = 5512.5;
+    static constexpr double hopSeconds = 1024 / targetSampleRate;
+    /** the first sample louder than this, about -50dB, starts the fingerprint */
+    static constexpr float onsetLevel = 0.003f;
+    /** frames in each smoothed chroma, and chromas kept for comparing over time */
+    static constexpr int smoothingFrames = 4;
+    static constexpr int historyFrames = 2 * smoothingFrames;
+    /** fewest words two fingerprints have to overlap by to be compared */
+    static constexpr int minOverlapWords = 32;
+
+    /** input samples averaged into each decimated sample */
+    int decimation;
+    float decimatedSum = 0.0f;
+    int decimatedCount = 0;
+    /** ring of the last fftSize decimated samples */
+    std::vector<float> samples;
+    int samplePosition = 0;
+    /** input samples so far, when the next frame is due, and the input samples between frames */
+    juce::int64 inputPosition = 0;
+    double nextFrame = 0.0, hopInputSamples;
+    /** pitch class of each fft bin, -1 for bins outside the range used */
+    std::vector<int> binPitchClasses;
+    juce::dsp::FFT fft{fftOrder};
+    juce::dsp::WindowingFunction<float> window{(size_t)fftSize, juce::dsp::WindowingFunction<float>::hann};
+    std::vector<float> fftData;
+    /** ring of the latest chromas, each normalised to sum to 1 */
+    std::array<std::array<float, 12>, historyFrames> chromas;
+    int numChromas = 0;
+    /** false until the first sample that isn't silent */
+    bool started = false;
+    std::vector<juce::uint32> words;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Fingerprinter)
+};
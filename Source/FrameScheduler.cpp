@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    FrameScheduler.cpp
+    Created: 18 Oct 2026 10:02:41am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "FrameScheduler.h"
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(juce::Component& _vsyncSource) :
+                                vsyncSource(_vsyncSource)
+{
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    stop();
+}
+
+void FrameScheduler::addClient(Client* client)
+{
+    if (std::find(clients.begin(), clients.end(), client) == clients.end())
+        clients.push_back(client);
+}
+
+void FrameScheduler::removeClient(Client* client)
+{
+    clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+}
+
+void FrameScheduler::wake()
+{
+    if (running)
+        return;
+    running = true;
+   #if JUCE_MAJOR_VERSION >= 7
+    vBlankAttachment = std::make_unique<juce::VBlankAttachment>(&vsyncSource, [this] { tick(); });
+   #else
+    // JUCE 6 has no vsync callback, so tick at display rate and stop when idle instead
+    startTimerHz(fallbackFrameRateHz);
+   #endif
+}
+
+bool FrameScheduler::isRunning()
+{
+    return running;
+}
+
+void FrameScheduler::timerCallback()
+{
+    tick();
+}
+
+void FrameScheduler::tick()
+{
+    double frameTimeMs = juce::Time::getMillisecondCounterHiRes();
+    bool needsAnotherFrame = false;
+    // copy in case a client adds or removes clients from its callback
+    std::vector<Client*> clientsThisFrame = clients;
+    for (Client* client : clientsThisFrame)
+    {
+        if (client->frameCallback(frameTimeMs))
+            needsAnotherFrame = true;
+    }
+    if (!needsAnotherFrame)
+        stop();
+}
+
+void FrameScheduler::stop()
+{
+    running = false;
+   #if JUCE_MAJOR_VERSION >= 7
+    vBlankAttachment.reset();
+   #else
+    stopTimer();
+   #endif
+}
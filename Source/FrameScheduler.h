@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    FrameScheduler.h
+    Created: 18 Oct 2026 10:02:41am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+/*
+ Drives every GUI refresh in the app from a single frame tick
+ Runs while any client has something to animate, and stops completely when idle
+*/
+class FrameScheduler  : private juce::Timer
+{
+public:
+    /** interface for anything that wants to be refreshed once per frame */
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+        /**
+         FrameScheduler::Client::frameCallback()
+         Input                  double
+         Output                 bool
+         @param frameTimeMs     millisecond counter time of the current frame
+         Poll audio-side state and repaint whatever has changed
+         Return true if the client still needs frames, false if it is idle
+         */
+        virtual bool frameCallback(double frameTimeMs) = 0;
+    };
+
+    FrameScheduler(juce::Component& _vsyncSource);
+    ~FrameScheduler() override;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     FrameScheduler::addClient()
+     Input                  FrameScheduler::Client*
+     Output                 none
+     Registers a client to be called on every frame while the scheduler is running
+     */
+    void addClient(Client* client);
+    
+    /**
+     FrameScheduler::removeClient()
+     Input                  FrameScheduler::Client*
+     Output                 none
+     Unregisters a client, must be called before the client is destroyed
+     */
+    void removeClient(Client* client);
+    
+    /**
+     FrameScheduler::wake()
+     Input                  none
+     Output                 none
+     Starts the frame tick if it is stopped
+     Call whenever something happens that a client needs to animate (play, load, crossfade)
+     */
+    void wake();
+    
+    /**
+     FrameScheduler::isRunning()
+     Input                  none
+     Output                 bool
+     Returns true if frames are currently being delivered
+     */
+    bool isRunning();
+
+private:
+    // implement Timer, used where vsync callbacks aren't available
+    void timerCallback() override;
+    
+    /**
+     FrameScheduler::tick()
+     Input                  none
+     Output                 none
+     Calls every client once, stops the scheduler if none of them need another frame
+     */
+    void tick();
+    
+    /**
+     FrameScheduler::stop()
+     Input                  none
+     Output                 none
+     Detaches from the frame source so the app makes no wakeups while idle
+     */
+    void stop();
+    
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** component whose display provides the vsync */
+    juce::Component& vsyncSource;
+    /** registered clients */
+    std::vector<Client*> clients;
+    /** true while frames are being delivered */
+    bool running = false;
+   #if JUCE_MAJOR_VERSION >= 7
+    /** delivers a callback on each vertical blank of vsyncSource's display */
+    std::unique_ptr<juce::VBlankAttachment> vBlankAttachment;
+   #endif
+    /** frame rate used when vsync callbacks aren't available */
+    static constexpr int fallbackFrameRateHz = 60;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FrameScheduler)
+};
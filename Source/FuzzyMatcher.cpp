@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    FuzzyMatcher.cpp
+    Created: 25 Oct 2026 3:52:31pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "FuzzyMatcher.h"
+#include <algorithm>
+#include <queue>
+#include <atomic>
+
+constexpr int FuzzyMatcher::maxResults;
+constexpr int FuzzyMatcher::maxQueryLength;
+constexpr int FuzzyMatcher::rowsPerCancelCheck;
+
+FuzzyMatcher::FuzzyMatcher() : pool(juce::jmax(1, juce::SystemStats::getNumCpus() - 1)),
+                               numShares(juce::jmax(1, juce::SystemStats::getNumCpus()))
+{
+}
+
+FuzzyMatcher::~FuzzyMatcher()
+{
+    pool.removeAllJobs(true, 2000);
+}
+
+bool FuzzyMatcher::search(const std::string& query, const TrackStore& tracks, const TitleSearchIndex& index,
+                          std::vector<juce::uint32>& results, const std::function<bool()>& shouldCancel)
+{
+    results.clear();
+    Pattern pattern;
+    compile(TitleSearchIndex::normalise(query.data(), (int)query.size()), pattern);
+    if (pattern.length == 0)
+        return true;
+    const int maxDistance = maxDistanceFor(pattern.length);
+    const std::vector<juce::uint32>& order = tracks.getOrder();
+    
+    // rank keys sort by distance, then library position, and are unique
+    std::vector<std::vector<juce::uint64>> shares((size_t)numShares);
+    std::atomic<bool> cancelled {false};
+    std::atomic<int> sharesLeft {numShares};
+    juce::WaitableEvent allDone;
+    auto scoreShare = [&] (int share)
+    {
+        size_t begin = order.size() * (size_t)share / (size_t)numShares;
+        size_t end = order.size() * (size_t)(share + 1) / (size_t)numShares;
+        // max heap of the best keys so far, the worst on top to be pushed out
+        std::priority_queue<juce::uint64> best;
+        for (size_t position = begin; position < end; ++position)
+        {
+            if ((position - begin) % rowsPerCancelCheck == rowsPerCancelCheck - 1
+                && (cancelled.load() || (shouldCancel && shouldCancel())))
+            {
+                cancelled = true;
+                break;
+            }
+            juce::uint32 row = order[position];
+            int distance = bestDistance(pattern, index.getNormalisedTitle(row));
+            if (distance > 0)
+                distance = juce::jmin(distance, bestDistance(pattern, index.getNormalisedFileName(row)));
+            if (distance > maxDistance)
+                continue;
+            juce::uint64 key = ((juce::uint64)distance << 32) | (juce::uint64)position;
+            if ((int)best.size() < maxResults)
+                best.push(key);
+            else if (key < best.top())
+            {
+                best.pop();
+                best.push(key);
+            }
+        }
+        std::vector<juce::uint64>& kept = shares[(size_t)share];
+        for (; !best.empty(); best.pop())
+            kept.push_back(best.top());
+        if (--sharesLeft == 0)
+            allDone.signal();
+    };
+    for (int share = 1; share < numShares; ++share)
+        pool.addJob([&scoreShare, share] { scoreShare(share); });
+    scoreShare(0);
+    allDone.wait();
+    if (cancelled.load())
+        return false;
+    
+    std::vector<juce::uint64> merged;
+    for (const std::vector<juce::uint64>& kept : shares)
+        merged.insert(merged.end(), kept.begin(), kept.end());
+    size_t numResults = juce::jmin(merged.size(), (size_t)maxResults);
+    std::partial_sort(merged.begin(), merged.begin() + (long)numResults, merged.end());
+    for (size_t i = 0; i < numResults; ++i)
+        results.push_back(order[(size_t)(merged[i] & 0xffffffff)]);
+    return true;
+}
+
+void FuzzyMatcher::compile(const std::string& normalisedQuery, Pattern& pattern)
+{
+    std::fill(std::begin(pattern.matchMasks), std::end(pattern.matchMasks), (juce::uint64)0);
+    pattern.length = juce::jmin((int)normalisedQuery.size(), maxQueryLength);
+    for (int i = 0; i < pattern.length; ++i)
+        pattern.matchMasks[(juce::uint8)normalisedQuery[(size_t)i]] |= (juce::uint64)1 << i;
+}
+
+int FuzzyMatcher::bestDistance(const Pattern& pattern, const std::string& text)
+{
+    // Myers 1999 / Hyyro 2003: vertical deltas of one column of the edit distance table
+    // held as bit vectors, with swapped neighbouring letters counted as one edit
+    // The match may start anywhere in the text, so row 0 stays at 0
+    const juce::uint64 lastBit = (juce::uint64)1 << (pattern.length - 1);
+    juce::uint64 positive = ~(juce::uint64)0, negative = 0;
+    juce::uint64 previousMatch = 0, previousDiagonal = 0;
+    int score = pattern.length, best = pattern.length;
+    for (char c : text)
+    {
+        juce::uint64 match = pattern.matchMasks[(juce::uint8)c];
+        juce::uint64 transposed = (((~previousDiagonal) & match) << 1) & previousMatch;
+        juce::uint64 diagonal = (((match & positive) + positive) ^ positive) | match | negative | transposed;
+        juce::uint64 horizontalPositive = negative | ~(diagonal | positive);
+        juce::uint64 horizontalNegative = positive & diagonal;
+        if (horizontalPositive & lastBit)
+            ++score;
+        else if (horizontalNegative & lastBit)
+            --score;
+        horizontalPositive <<= 1;
+        horizontalNegative <<= 1;
+        positive = horizontalNegative | ~(diagonal | horizontalPositive);
+        negative = horizontalPositive & diagonal;
+        previousMatch = match;
+        previousDiagonal = diagonal;
+        best = juce::jmin(best, score);
+        if (best == 0)
+            break;
+    }
+    return best;
+}
+
+int FuzzyMatcher::maxDistanceFor(int queryLength)
+{
+    // roughly one typo per three characters, none for the shortest queries
+    if (queryLength <= 2)
+        return 0;
+    return juce::jlimit(1, 4, queryLength / 3);
+}
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    FuzzyMatcher.h
+    Created: 25 Oct 2026 3:52:31pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include "TrackStore.h"
+#include "TitleSearchIndex.h"
+
+//==============================================================================
+/*
+ Typo tolerant search over track titles and file names
+ Each field is scored by the fewest edits needed to turn the query into any
+ part of it, counting a swapped pair of letters as one edit, using Hyyro's
+ bit-parallel form of Myers' algorithm, which advances a whole column of the
+ edit distance table in a handful of 64 bit operations per byte
+ The library is split across a thread pool, each worker keeping its best
+ matches in a bounded heap, and the heaps are merged into one ranked list
+*/
+class FuzzyMatcher
+{
+public:
+    FuzzyMatcher();
+    ~FuzzyMatcher();
+
+    /** most results returned by a search */
+    static constexpr int maxResults = 250;
+    /** longest query in bytes, the length of a bit-parallel column */
+    static constexpr int maxQueryLength = 64;
+    
+    /** query compiled into a bit mask per byte value */
+    struct Pattern
+    {
+        juce::uint64    matchMasks[256];
+        int             length = 0;
+    };
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     FuzzyMatcher::search()
+     Input                  std::string, TrackStore, TitleSearchIndex, std::vector<juce::uint32>, std::function<bool()>
+     Output                 bool
+     @param query           text typed by the user
+     @param results         filled with up to maxResults rows, closest match first
+     @param shouldCancel    polled by every worker, may be empty
+     Ranks the tracks by how closely their title or file name matches the query
+     Returns false if the search was cancelled
+     */
+    bool search(const std::string& query, const TrackStore& tracks, const TitleSearchIndex& index,
+                std::vector<juce::uint32>& results, const std::function<bool()>& shouldCancel = nullptr);
+    
+    /** FuzzyMatcher::compile() builds the pattern for a normalised query, truncated to maxQueryLength */
+    static void compile(const std::string& normalisedQuery, Pattern& pattern);
+    
+    /**
+     FuzzyMatcher::bestDistance()
+     Input                  Pattern, std::string
+     Output                 int
+     Returns the edit distance between the pattern and the closest matching part of the text,
+     where an edit is an insertion, deletion, substitution or swap of neighbouring bytes
+     */
+    static int bestDistance(const Pattern& pattern, const std::string& text);
+    
+    /** FuzzyMatcher::maxDistanceFor() returns how many edits are tolerated for a query length */
+    static int maxDistanceFor(int queryLength);
+
+private:
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** rows scored between polls of the cancel function */
+    static constexpr int rowsPerCancelCheck = 1024;
+    /** workers for scoring, the calling thread scores one share itself */
+    juce::ThreadPool pool;
+    int numShares;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FuzzyMatcher)
+};
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    KeyDetector.cpp
+    Created: 4 Nov 2026 9:14:37am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "KeyDetector.h"
+#include <cmath>
+
+constexpr int KeyDetector::fftOrder;
+constexpr int KeyDetector::fftSize;
+constexpr double KeyDetector::targetSampleRate;
+constexpr int KeyDetector::hopSize;
+constexpr double KeyDetector::minFrequency;
+constexpr double KeyDetector::maxFrequency;
+constexpr float KeyDetector::silenceLevel;
+
+KeyDetector::KeyDetector(double sampleRate) :
+                                    decimation(juce::jmax(1, juce::roundToInt(sampleRate / targetSampleRate))),
+                                    samples((size_t)fftSize, 0.0f),
+                                    binPitchClasses((size_t)fftSize / 2 + 1, -1),
+                                    fftData((size_t)fftSize * 2, 0.0f)
+{
+    const double binWidth = sampleRate / decimation / fftSize;
+    for (int bin = 1; bin <= fftSize / 2; ++bin)
+    {
+        double frequency = bin * binWidth;
+        if (frequency >= minFrequency && frequency <= maxFrequency)
+        {
+            // semitones from A, and A is 9 semitones above C
+            int semitone = juce::roundToInt(12.0 * std::log2(frequency / 440.0)) + 9;
+            binPitchClasses[(size_t)bin] = ((semitone % 12) + 12) % 12;
+        }
+    }
+    chromaSum.fill(0.0);
+}
+
+KeyDetector::~KeyDetector()
+{
+}
+
+void KeyDetector::process(const float* const* channels, int numChannels, int numSamples)
+{
+    if (numChannels <= 0)
+        return;
+    const float channelGain = 1.0f / (float)numChannels;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float sample = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+            sample += channels[channel][i];
+        decimatedSum += sample * channelGain;
+        if (++decimatedCount < decimation)
+            continue;
+        samples[(size_t)samplePosition] = decimatedSum / (float)decimation;
+        samplePosition = (samplePosition + 1) % fftSize;
+        decimatedSum = 0.0f;
+        decimatedCount = 0;
+        if (--samplesToFrame == 0)
+        {
+            processFrame();
+            samplesToFrame = hopSize;
+        }
+    }
+}
+
+int KeyDetector::getKey() const
+{
+    if (numFrames == 0)
+        return -1;
+    // Krumhansl-Kessler probe tone ratings, from the tonic up
+    static const double profiles[2][12] = {
+        { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 },
+        { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 }
+    };
+    double chromaMean = 0;
+    for (double value : chromaSum)
+        chromaMean += value / 12.0;
+    int bestKey = -1;
+    double bestCorrelation = -2.0;
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        double profileMean = 0;
+        for (double value : profiles[mode])
+            profileMean += value / 12.0;
+        for (int tonic = 0; tonic < 12; ++tonic)
+        {
+            double covariance = 0, chromaVariance = 0, profileVariance = 0;
+            for (int pitchClass = 0; pitchClass < 12; ++pitchClass)
+            {
+                const double x = chromaSum[(size_t)pitchClass] - chromaMean;
+                const double y = profiles[mode][(pitchClass - tonic + 12) % 12] - profileMean;
+                covariance += x * y;
+                chromaVariance += x * x;
+                profileVariance += y * y;
+            }
+            if (chromaVariance <= 0)
+                return -1;
+            const double correlation = covariance / std::sqrt(chromaVariance * profileVariance);
+            if (correlation > bestCorrelation)
+            {
+                bestCorrelation = correlation;
+                bestKey = mode * 12 + tonic;
+            }
+        }
+    }
+    return bestKey;
+}
+
+void KeyDetector::processFrame()
+{
+    // oldest sample first
+    for (int i = 0; i < fftSize; ++i)
+        fftData[(size_t)i] = samples[(size_t)((samplePosition + i) % fftSize)];
+    window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.0f);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    std::array<float, 12> chroma;
+    chroma.fill(0.0f);
+    float total = 0.0f;
+    for (int bin = 1; bin <= fftSize / 2; ++bin)
+    {
+        int pitchClass = binPitchClasses[(size_t)bin];
+        if (pitchClass < 0)
+            continue;
+        float energy = fftData[(size_t)bin] * fftData[(size_t)bin];
+        chroma[(size_t)pitchClass] += energy;
+        total += energy;
+    }
+    if (total < silenceLevel)
+        return;
+    for (size_t pitchClass = 0; pitchClass < 12; ++pitchClass)
+        chromaSum[pitchClass] += chroma[pitchClass] / total;
+    ++numFrames;
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    KeyDetector.h
+    Created: 4 Nov 2026 9:14:37am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <array>
+
+//==============================================================================
+/*
+ Estimates the musical key of a whole track
+ Audio is mixed to mono and decimated to about 11kHz, and a 12 bin chroma is
+ taken every 186ms from the energy of the pitches between C2 and C7. Each chroma is normalised,
+ so quiet passages count as much as loud ones, and they are summed over the track.
+ The sum is correlated with the Krumhansl-Kessler major and minor key profiles
+ in all 12 transpositions, and the best fit is the key
+ Audio is fed in blocks, so the key can be found alongside other analysis
+*/
+class KeyDetector
+{
+public:
+    KeyDetector(double sampleRate);
+    ~KeyDetector();
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     KeyDetector::process()
+     Input                  const float* const*, int, int
+     Output                 none
+     Adds a block of audio, mixing its channels to mono
+     */
+    void process(const float* const* channels, int numChannels, int numSamples);
+
+    /**
+     KeyDetector::getKey()
+     Input                  none
+     Output                 int
+     Returns the key of the audio so far as TrackStore keeps it, 0 - 11 major from C
+     and 12 - 23 minor from C, or -1 if it had no pitched sound
+     */
+    int getKey() const;
+
+private:
+    /** KeyDetector::processFrame() adds the chroma of the frame ending at the latest sample */
+    void processFrame();
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr double targetSampleRate = 11025.0;
+    /** frames overlap by half */
+    static constexpr int hopSize = fftSize / 2;
+    static constexpr double minFrequency = 65.4;
+    static constexpr double maxFrequency = 2093.0;
+    /** frames with less energy than this in the range, about -60dB, are silence and left out */
+    static constexpr float silenceLevel = 1.0f;
+
+    /** input samples averaged into each decimated sample */
+    int decimation;
+    float decimatedSum = 0.0f;
+    int decimatedCount = 0;
+    /** ring of the last fftSize decimated samples, and decimated samples until the next frame */
+    std::vector<float> samples;
+    int samplePosition = 0;
+    int samplesToFrame = fftSize;
+    /** pitch class from C of each fft bin, -1 for bins outside the range used */
+    std::vector<int> binPitchClasses;
+    juce::dsp::FFT fft{fftOrder};
+    juce::dsp::WindowingFunction<float> window{(size_t)fftSize, juce::dsp::WindowingFunction<float>::hann};
+    std::vector<float> fftData;
+    /** sum of every frame's normalised chroma */
+    std::array<double, 12> chromaSum;
+    int numFrames = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KeyDetector)
+};
@@ -29,6 +29,8 @@ LevelMeter::LevelMeter(
     meterRedTransition = 0.93f;
     meterMinLevelThreshold = 0.01f;
     meterFalloff = 0.95;
+    peakFalloff = 60;
+    peakHoldCountdown = 0;
 }
 
 LevelMeter::~LevelMeter()
@@ -38,41 +40,41 @@ LevelMeter::~LevelMeter()
 
 void LevelMeter::paint (juce::Graphics& g)
 {
-    int fullScale;
-    if (!vertical)
-        fullScale = getWidth() / meterPaintBlockSize;
-    else
-        fullScale = getHeight() / meterPaintBlockSize;
-    for (int i = 0; i < numBlocksToPaint; ++i)
+    if (meterPaintBlockSize > 0 && litImage.isValid())
     {
-        if (i > fullScale * meterRedTransition)
-            g.setColour(meterRed);
-        else if (i > fullScale * meterOrangeTransition)
-            g.setColour(meterOrange);
-        else
-            g.setColour(meterGreen);
-        
-        if (!vertical)
-            g.drawLine(meterPaintBlockSize * i, 0, meterPaintBlockSize * i, getHeight(), 1);
-        else
-            g.drawLine(0, getHeight() - (meterPaintBlockSize * i), getWidth(), getHeight() - (meterPaintBlockSize * i), 1);
+        // blit the lit portion of the pre-rendered meter
+        int litExtent = getLitExtent(numBlocksToPaint);
+        float imageScale = (float)litImage.getWidth() / (float)getWidth();
+        if (litExtent > 0)
+        {
+            if (!vertical)
+                g.drawImage(litImage, 0, 0, litExtent, getHeight(),
+                            0, 0, (int)(litExtent * imageScale), litImage.getHeight());
+            else
+                g.drawImage(litImage, 0, getHeight() - litExtent, getWidth(), litExtent,
+                            0, litImage.getHeight() - (int)(litExtent * imageScale), litImage.getWidth(), (int)(litExtent * imageScale));
+        }
+        // final block
+        g.setColour(colourForBlock(numBlocksToPaint).withAlpha(finalBlockAlpha));
+        drawBlock(g, numBlocksToPaint);
+        // held peak marker
+        if (currentPeak > 0)
+        {
+            int peakPosition = getPeakPosition();
+            g.setColour(colourForBlock((int)(peakPosition / meterPaintBlockSize)));
+            if (!vertical)
+                g.fillRect(peakPosition - 1, 0, 2, getHeight());
+            else
+                g.fillRect(0, getHeight() - peakPosition - 1, getWidth(), 2);
+        }
     }
-    // final block
-    if (numBlocksToPaint > fullScale * meterRedTransition)
-        g.setColour(meterRed.withAlpha(finalBlockAlpha));
-    else if (numBlocksToPaint > fullScale * meterOrangeTransition)
-        g.setColour(meterOrange.withAlpha(finalBlockAlpha));
-    else
-        g.setColour(meterGreen.withAlpha(finalBlockAlpha));
-    if (!vertical)
-        g.drawLine(meterPaintBlockSize * numBlocksToPaint, 0, meterPaintBlockSize * numBlocksToPaint, getHeight(), 1);
-    else
-        g.drawLine(0, getHeight() - (meterPaintBlockSize * numBlocksToPaint), getWidth(), getHeight() - (meterPaintBlockSize * numBlocksToPaint), 1);
 
     g.setColour (juce::Colours::white);
     g.setFont (10.0f);
     g.drawText (getName(), getLocalBounds(),
                 juce::Justification::left, true);   // draw some placeholder text
+    if (readout.isNotEmpty())
+        g.drawText (readout, getLocalBounds(), juce::Justification::right, true);
 }
 
 void LevelMeter::resized()
@@ -81,6 +83,7 @@ void LevelMeter::resized()
         meterPaintBlockSize = getWidth() / meterResolution;
     else
         meterPaintBlockSize = getHeight() / meterResolution;
+    renderLitImage();
 }
 
 void LevelMeter::displayLevel(double level)
@@ -100,18 +103,137 @@ void LevelMeter::displayLevel(double level)
         if (currentSmoothedLevel < meterMinLevelThreshold)
             currentSmoothedLevel = 0;
     }
-    if (level > currentPeak)
-        currentPeak = level;
-    if (!vertical)
+    if (meterPaintBlockSize <= 0)
+        return;
+
+    int previousBlocksToPaint = numBlocksToPaint;
+    float previousBlockAlpha = finalBlockAlpha;
+    int meterLength = vertical ? getHeight() : getWidth();
+    numBlocksToPaint = ((int)(meterLength*currentSmoothedLevel)/meterPaintBlockSize);
+    finalBlockAlpha = 1.0f * (((meterLength * currentSmoothedLevel) - (numBlocksToPaint * meterPaintBlockSize)) / meterPaintBlockSize);
+
+    // only repaint the strip between the old and new final blocks
+    if (numBlocksToPaint == previousBlocksToPaint && finalBlockAlpha == previousBlockAlpha)
+        return;
+    int lowBlock = juce::jmin(numBlocksToPaint, previousBlocksToPaint);
+    int highBlock = juce::jmax(numBlocksToPaint, previousBlocksToPaint);
+    int from = (int)(meterPaintBlockSize * lowBlock) - (int)meterPaintBlockSize - 1;
+    int to = (int)(meterPaintBlockSize * highBlock) + (int)meterPaintBlockSize + 1;
+    repaintAlongMeter(from, to);
+}
+
+void LevelMeter::displayLevels(float rms, float truePeak)
+{
+    displayLevel(gainToMeterLevel(rms));
+    // hold the highest true-peak, then let it fall at the same rate as the meter
+    int previousPeakPosition = getPeakPosition();
+    double peak = gainToMeterLevel(truePeak);
+    if (peak >= currentPeak)
+    {
+        currentPeak = peak;
+        peakHoldCountdown = peakFalloff;
+    }
+    else if (peakHoldCountdown > 0)
+        --peakHoldCountdown;
+    else
+    {
+        currentPeak *= meterFalloff;
+        if (currentPeak < meterMinLevelThreshold)
+            currentPeak = 0;
+    }
+    int peakPosition = getPeakPosition();
+    if (peakPosition != previousPeakPosition)
     {
-        numBlocksToPaint = ((int)(getWidth()*currentSmoothedLevel)/meterPaintBlockSize);
-        finalBlockAlpha = 1.0f * (((getWidth() * currentSmoothedLevel) - (numBlocksToPaint * meterPaintBlockSize)) / meterPaintBlockSize);
+        repaintAlongMeter(previousPeakPosition - 2, previousPeakPosition + 2);
+        repaintAlongMeter(peakPosition - 2, peakPosition + 2);
     }
+}
+
+void LevelMeter::setReadout(const juce::String& text)
+{
+    if (text == readout)
+        return;
+    readout = text;
+    // the readout is right justified, so only the end of the meter needs repainting
+    repaint(getLocalBounds().removeFromRight(juce::jmax(1, getWidth() / 3)));
+}
+
+double LevelMeter::gainToMeterLevel(float gain)
+{
+    float decibels = juce::Decibels::gainToDecibels(gain, (float)meterFloorDecibels);
+    return juce::jmap(decibels, (float)meterFloorDecibels, 0.0f, 0.0f, 1.0f);
+}
+
+int LevelMeter::getPeakPosition()
+{
+    int meterLength = vertical ? getHeight() : getWidth();
+    return juce::roundToInt(juce::jmin(1.0, currentPeak) * meterLength);
+}
+
+void LevelMeter::repaintAlongMeter(int from, int to)
+{
+    int meterLength = vertical ? getHeight() : getWidth();
+    from = juce::jlimit(0, meterLength, from);
+    to = juce::jlimit(0, meterLength, to);
+    if (to <= from)
+        return;
+    if (!vertical)
+        repaint(from, 0, to - from, getHeight());
     else
+        repaint(0, getHeight() - to, getWidth(), to - from);
+}
+
+bool LevelMeter::isActive()
+{
+    return currentSmoothedLevel > 0 || currentPeak > 0;
+}
+
+void LevelMeter::renderLitImage()
+{
+    if (getWidth() <= 0 || getHeight() <= 0 || meterPaintBlockSize <= 0)
+    {
+        litImage = juce::Image();
+        return;
+    }
+    // render at the display scale so the blit stays sharp on high-DPI screens
+    float scale = juce::jmax(1.0f, juce::Component::getApproximateScaleFactorForComponent(this));
+    litImage = juce::Image(juce::Image::ARGB,
+                           juce::roundToInt(getWidth() * scale),
+                           juce::roundToInt(getHeight() * scale),
+                           true);
+    juce::Graphics g(litImage);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    int meterLength = vertical ? getHeight() : getWidth();
+    int fullScale = (int)(meterLength / meterPaintBlockSize);
+    for (int i = 0; i <= fullScale; ++i)
     {
-        numBlocksToPaint = ((int)(getHeight()*currentSmoothedLevel)/meterPaintBlockSize);
-        finalBlockAlpha = 1.0f * (((getHeight() * currentSmoothedLevel) - (numBlocksToPaint * meterPaintBlockSize)) / meterPaintBlockSize);
+        g.setColour(colourForBlock(i));
+        drawBlock(g, i);
     }
+}
+
+juce::Colour LevelMeter::colourForBlock(int block)
+{
+    int meterLength = vertical ? getHeight() : getWidth();
+    int fullScale = (int)(meterLength / meterPaintBlockSize);
+    if (block > fullScale * meterRedTransition)
+        return meterRed;
+    else if (block > fullScale * meterOrangeTransition)
+        return meterOrange;
+    else
+        return meterGreen;
+}
 
-    repaint();
+void LevelMeter::drawBlock(juce::Graphics& g, int block)
+{
+    if (!vertical)
+        g.drawLine(meterPaintBlockSize * block, 0, meterPaintBlockSize * block, getHeight(), 1);
+    else
+        g.drawLine(0, getHeight() - (meterPaintBlockSize * block), getWidth(), getHeight() - (meterPaintBlockSize * block), 1);
+}
+
+int LevelMeter::getLitExtent(int blocks)
+{
+    // stop half a block short so the final (alpha) block isn't drawn twice
+    return juce::jmax(0, juce::roundToInt(meterPaintBlockSize * blocks - meterPaintBlockSize * 0.5));
 }
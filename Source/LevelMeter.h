@@ -40,11 +40,99 @@ public:
      @param level           a double in the range 0 - 1 to be shown as an audio level
      Takes the passed level, updates the currentSmoothedLevel
      Calculates and stores numBlocksToPaint and finalBlockAlpha
-     Calls repaint() on the component
+     Repaints only the strip of the meter that has changed
      */
     void displayLevel(double level);
     
+    /**
+     LevelMeter::displayLevels()
+     Input                  float, float
+     Output                 none
+     @param rms             linear RMS level, drawn as the meter bar
+     @param truePeak        linear true-peak level, drawn as a held peak marker
+     Converts both to the meter's decibel scale and displays them
+     */
+    void displayLevels(float rms, float truePeak);
+    
+    /**
+     LevelMeter::setReadout()
+     Input                  juce::String
+     Output                 none
+     Sets text drawn at the end of the meter, e.g. a loudness reading
+     */
+    void setReadout(const juce::String& text);
+    
+    /**
+     LevelMeter::gainToMeterLevel()
+     Input                  float linear gain
+     Output                 double in the range 0 - 1
+     Maps a gain onto the meter scale, which is linear in decibels from meterFloorDecibels to 0dB
+     */
+    static double gainToMeterLevel(float gain);
+    
+    /**
+     LevelMeter::isActive()
+     Input                  none
+     Output                 bool
+     Returns true while the meter is showing any level, so callers know to keep feeding it
+     */
+    bool isActive();
+    
 private:
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     LevelMeter::renderLitImage()
+     Input                  none
+     Output                 none
+     Pre-renders every block of the meter fully lit into LevelMeter::litImage
+     Called from resized() so paint() only has to blit the lit portion
+     */
+    void renderLitImage();
+    
+    /**
+     LevelMeter::colourForBlock()
+     Input                  int block index
+     Output                 juce::Colour
+     Returns green, orange or red depending on where the block sits in the meter
+     */
+    juce::Colour colourForBlock(int block);
+    
+    /**
+     LevelMeter::drawBlock()
+     Input                  juce::Graphics, int block index
+     Output                 none
+     Draws a single meter block in the current colour
+     */
+    void drawBlock(juce::Graphics& g, int block);
+    
+    /**
+     LevelMeter::getLitExtent()
+     Input                  int number of blocks
+     Output                 int length in pixels
+     Returns how much of the pre-rendered meter to blit for the given number of blocks
+     */
+    int getLitExtent(int blocks);
+    
+    /**
+     LevelMeter::getPeakPosition()
+     Input                  none
+     Output                 int
+     Returns the distance in pixels along the meter of the held peak marker
+     */
+    int getPeakPosition();
+    
+    /**
+     LevelMeter::repaintAlongMeter()
+     Input                  int, int
+     Output                 none
+     Repaints the strip of the meter between two distances along it
+     */
+    void repaintAlongMeter(int from, int to);
+    
+
     /* ======================== */
     /* ====== properties ====== */
     /* ======================== */
@@ -57,10 +145,16 @@ private:
     double meterPaintBlockSize;
     /* the number of meter blocks that will be painted */
     int numBlocksToPaint;
-    /* stores current peak for peak hold **not yet implemented** */
+    /* stores current peak for peak hold */
     double currentPeak;
-    /** controls how fast the peak hold decreases **not yet implemented** */
+    /** number of displayLevels() calls the peak is held for before it falls */
     int peakFalloff;
+    /** calls left before the held peak starts to fall */
+    int peakHoldCountdown;
+    /** text drawn at the end of the meter */
+    juce::String readout;
+    /** bottom of the decibel scale used by displayLevels() */
+    static constexpr float meterFloorDecibels = -60.0f;
     /** a smoothed value for the input level to the meter */
     double currentSmoothedLevel;
     /** value for alpha value of final block depending on level */
@@ -72,6 +166,8 @@ private:
     // to do - figure out why this can't be initialised with hex values in constructor
     /** if true meter is drawn vertically, otherwise drawn horizontally */
     bool vertical;
+    /** the fully lit meter, rendered once per resize */
+    juce::Image litImage;
   
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
@@ -0,0 +1,266 @@
+/*
+  ==============================================================================
+
+    LibraryImporter.cpp
+    Created: 29 Oct 2026 2:18:40pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "LibraryImporter.h"
+#include "MetadataProbe.h"
+#include <memory>
+#if JUCE_LINUX || JUCE_BSD || JUCE_MAC
+ #include <sys/stat.h>
+#endif
+
+LibraryImporter::LibraryImporter(juce::AudioFormatManager& _formatManager) :
+                                    juce::Thread("library import"),
+                                    formatManager(_formatManager),
+                                    pool(juce::jmax(1, juce::SystemStats::getNumCpus() - 1)),
+                                    numProbers(juce::jmax(1, juce::SystemStats::getNumCpus()))
+{
+    startThread(3);
+}
+
+LibraryImporter::~LibraryImporter()
+{
+    cancelPendingUpdate();
+    cancelled = true;
+    stopThread(4000);
+    pool.removeAllJobs(true, 2000);
+}
+
+/* ================================= */
+/* ====== message thread side ====== */
+/* ================================= */
+
+void LibraryImporter::import(const juce::StringArray& paths, const std::vector<std::string>& knownURLs)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        // an import that finished keeps nothing from the library it was given then
+        if (!importing.load())
+            seenURLs.clear();
+        seenURLs.insert(knownURLs.begin(), knownURLs.end());
+        pendingPaths.addArray(paths);
+        finished = false;
+    }
+    if (!importing.exchange(true))
+    {
+        cancelled = false;
+        numFound = 0;
+        numProbed = 0;
+    }
+    notify();
+}
+
+void LibraryImporter::cancel()
+{
+    // set under the lock, so any path still queued while cancelled was added after the cancel
+    const juce::ScopedLock sl(lock);
+    cancelled = true;
+    pendingPaths.clear();
+}
+
+bool LibraryImporter::isImporting() const
+{
+    return importing.load();
+}
+
+double LibraryImporter::getProgress() const
+{
+    if (walking.load() || numFound.load() == 0)
+        return -1.0;
+    return (double)numProbed.load() / (double)numFound.load();
+}
+
+int LibraryImporter::getNumFound() const
+{
+    return numFound.load();
+}
+
+int LibraryImporter::getNumProbed() const
+{
+    return numProbed.load();
+}
+
+void LibraryImporter::handleAsyncUpdate()
+{
+    std::vector<TrackStore::TrackInfo> tracks;
+    bool importFinished;
+    {
+        const juce::ScopedLock sl(lock);
+        tracks.swap(readyTracks);
+        importFinished = finished;
+        finished = false;
+    }
+    if (!tracks.empty() && onTracks)
+        onTracks(tracks);
+    // the import thread can report finishing more than once if woken after it has
+    if (importFinished && importing.exchange(false))
+    {
+        if (onFinished)
+            onFinished(cancelled.load());
+    }
+}
+
+/* ================================ */
+/* ====== import thread side ====== */
+/* ================================ */
+
+void LibraryImporter::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+        for (;;)
+        {
+            juce::StringArray paths;
+            {
+                const juce::ScopedLock sl(lock);
+                paths.swapWith(pendingPaths);
+                if (paths.isEmpty())
+                {
+                    // only an import that was started reports finishing
+                    finished = importing.load();
+                    break;
+                }
+                // paths dropped after a cancel, before it finished, start the import again
+                if (cancelled.load() && !threadShouldExit())
+                {
+                    cancelled = false;
+                    numFound = 0;
+                    numProbed = 0;
+                }
+            }
+            walking = true;
+            std::vector<juce::File> files = findFiles(paths);
+            walking = false;
+            probeFiles(files);
+            if (threadShouldExit())
+                return;
+        }
+        triggerAsyncUpdate();
+    }
+}
+
+std::vector<juce::File> LibraryImporter::findFiles(const juce::StringArray& paths)
+{
+    std::vector<juce::File> files;
+    auto addIfNew = [this, &files] (const juce::File& file)
+    {
+        std::string url = juce::URL(file).toString(false).toStdString();
+        const juce::ScopedLock sl(lock);
+        if (seenURLs.insert(url).second)
+        {
+            files.push_back(file);
+            ++numFound;
+        }
+    };
+    const juce::String audioWildcard = formatManager.getWildcardForAllFormats();
+    for (const juce::String& path : paths)
+    {
+        juce::File file(path);
+        if (file.isDirectory())
+        {
+            for (const juce::DirectoryEntry& entry : juce::RangedDirectoryIterator(file, true, audioWildcard, juce::File::findFiles))
+            {
+                if (cancelled.load() || threadShouldExit())
+                    return files;
+                addIfNew(entry.getFile());
+            }
+        }
+        else if (file.existsAsFile())
+            addIfNew(file);
+    }
+    return files;
+}
+
+void LibraryImporter::probeFiles(const std::vector<juce::File>& files)
+{
+    // each prober takes the next unprobed file, so slow files don't hold up a fixed share
+    std::atomic<size_t> nextFile {0};
+    std::atomic<int> probersLeft {numProbers};
+    juce::WaitableEvent allDone;
+    std::vector<juce::uint8> probed(files.size(), 0);
+    auto probeNext = [this, &files, &nextFile, &probersLeft, &allDone, &probed] ()
+    {
+        for (size_t i = nextFile++; i < files.size() && !cancelled.load() && !threadShouldExit(); i = nextFile++)
+        {
+            TrackStore::TrackInfo track;
+            bool isAudio = probe(files[i], formatManager, track);
+            probed[i] = 1;
+            ++numProbed;
+            if (isAudio)
+            {
+                const juce::ScopedLock sl(lock);
+                readyTracks.push_back(std::move(track));
+            }
+            triggerAsyncUpdate();
+        }
+        if (--probersLeft == 0)
+            allDone.signal();
+    };
+    for (int prober = 1; prober < numProbers; ++prober)
+        pool.addJob(probeNext);
+    probeNext();
+    allDone.wait();
+    if (cancelled.load())
+    {
+        // files found but never probed are imported if they are dropped again
+        const juce::ScopedLock sl(lock);
+        for (size_t i = 0; i < files.size(); ++i)
+            if (probed[i] == 0)
+                seenURLs.erase(juce::URL(files[i]).toString(false).toStdString());
+    }
+}
+
+bool LibraryImporter::probe(const juce::File& file, juce::AudioFormatManager& formatManager, TrackStore::TrackInfo& track)
+{
+    // only files the app can play go in the library, however well their headers read
+    if (formatManager.findFormatForFileExtension(file.getFileExtension()) == nullptr)
+        return false;
+    // signed before reading, so a write during the probe shows up as a change next time
+    track.signature = readSignature(file);
+    MetadataProbe::Metadata metadata;
+    if (MetadataProbe::probe(file, metadata))
+    {
+        track.length = (float)metadata.length;
+    }
+    else
+    {
+        // headers the probe can't read, open the file properly instead
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        if (reader == nullptr || reader->sampleRate <= 0)
+            return false;
+        track.length = (float)(reader->lengthInSamples / reader->sampleRate);
+    }
+    track.title = metadata.title.empty() ? file.getFileName().toStdString() : metadata.title;
+    track.artist = metadata.artist;
+    track.album = metadata.album;
+    track.url = juce::URL(file).toString(false).toStdString();
+    track.dateAdded = juce::Time::currentTimeMillis();
+    return true;
+}
+
+TrackStore::FileSignature LibraryImporter::readSignature(const juce::File& file)
+{
+    TrackStore::FileSignature signature;
+#if JUCE_LINUX || JUCE_BSD || JUCE_MAC
+    // one stat gives all three, and the inode number isn't available through juce::File
+    struct stat info;
+    if (::stat(file.getFullPathName().toRawUTF8(), &info) != 0 || !S_ISREG(info.st_mode))
+        return signature;
+    signature.modified = (juce::int64)info.st_mtime * 1000;
+    signature.size = (juce::int64)info.st_size;
+    signature.fileId = (juce::uint64)info.st_ino;
+#else
+    if (!file.existsAsFile())
+        return signature;
+    signature.modified = file.getLastModificationTime().toMilliseconds();
+    signature.size = file.getSize();
+#endif
+    return signature;
+}
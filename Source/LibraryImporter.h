@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    LibraryImporter.h
+    Created: 29 Oct 2026 2:18:40pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <atomic>
+#include <functional>
+#include "TrackStore.h"
+
+//==============================================================================
+/*
+ Background import of dropped audio files and folders
+ Folders are walked recursively for files with a known audio extension, and
+ paths already in the library or already found are skipped. The files are then
+ probed across a thread pool, and finished tracks are handed to the message
+ thread in batches, however many have piled up since the last batch
+ More paths can be added while an import is running
+*/
+class LibraryImporter  : private juce::Thread,
+                         private juce::AsyncUpdater
+{
+public:
+    LibraryImporter(juce::AudioFormatManager& _formatManager);
+    ~LibraryImporter() override;
+
+    /** called on the message thread with each batch of probed tracks, their library ids still to be assigned */
+    std::function<void(std::vector<TrackStore::TrackInfo>&)> onTracks;
+    /** called on the message thread once every path has been imported, or the import was cancelled */
+    std::function<void(bool wasCancelled)> onFinished;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     LibraryImporter::import()
+     Input                  juce::StringArray, std::vector<std::string>
+     Output                 none
+     @param paths           dropped files and folders
+     @param knownURLs       urls of the tracks already in the library, which aren't imported again
+     Queues paths for import, starting the import if it isn't already running
+     */
+    void import(const juce::StringArray& paths, const std::vector<std::string>& knownURLs);
+
+    /** LibraryImporter::cancel() stops the import, tracks already handed over stay in the library, paths imported after it start a new one */
+    void cancel();
+
+    /** LibraryImporter::isImporting() returns true from import() until onFinished has been called */
+    bool isImporting() const;
+
+    /**
+     LibraryImporter::getProgress()
+     Input                  none
+     Output                 double
+     Returns the fraction of found files probed so far, or -1 while folders are still being walked
+     */
+    double getProgress() const;
+
+    /** LibraryImporter::getNumFound() returns how many new files have been found */
+    int getNumFound() const;
+
+    /** LibraryImporter::getNumProbed() returns how many of the found files have been probed */
+    int getNumProbed() const;
+
+    /**
+     LibraryImporter::probe()
+     Input                  juce::File, juce::AudioFormatManager, TrackStore::TrackInfo
+     Output                 bool
+     Fills in a track's title, artist, album, url, length, date added and file signature from an audio file
+     Tags and length are read from the file's headers by MetadataProbe, only falling back to
+     an AudioFormatReader when they can't be, and the title falls back to the file name
+     Returns false if the file isn't audio in a known format. Safe to call from any thread
+     */
+    static bool probe(const juce::File& file, juce::AudioFormatManager& formatManager, TrackStore::TrackInfo& track);
+    
+    /**
+     LibraryImporter::readSignature()
+     Input                  juce::File
+     Output                 TrackStore::FileSignature
+     Returns the modification time, size and inode number of a file, with a size of -1 if it is missing
+     Safe to call from any thread
+     */
+    static TrackStore::FileSignature readSignature(const juce::File& file);
+
+private:
+    // implement Thread
+    void run() override;
+    // implement AsyncUpdater
+    void handleAsyncUpdate() override;
+
+    /**
+     LibraryImporter::findFiles()
+     Input                  juce::StringArray
+     Output                 std::vector<juce::File>
+     Called on the import thread. Expands folders into the audio files inside them,
+     dropping any path already seen. Returns early if cancelled
+     */
+    std::vector<juce::File> findFiles(const juce::StringArray& paths);
+
+    /**
+     LibraryImporter::probeFiles()
+     Input                  std::vector<juce::File>
+     Output                 none
+     Called on the import thread. Probes the files across the pool and the import thread,
+     queueing each track for the message thread as soon as it is ready
+     */
+    void probeFiles(const std::vector<juce::File>& files);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    /** shared with the rest of the app, only used to create readers */
+    juce::AudioFormatManager& formatManager;
+    /** workers for probing, the import thread probes too */
+    juce::ThreadPool pool;
+    int numProbers;
+
+    /** guards everything below that both threads use */
+    juce::CriticalSection lock;
+    /** paths waiting to be imported */
+    juce::StringArray pendingPaths;
+    /** urls of the library's tracks and of every file found so far, normalised as juce::URL writes them */
+    std::unordered_set<std::string> seenURLs;
+    /** probed tracks waiting for the message thread */
+    std::vector<TrackStore::TrackInfo> readyTracks;
+    /** set by the import thread when it runs out of paths */
+    bool finished = false;
+
+    std::atomic<bool> importing {false}, cancelled {false};
+    std::atomic<int> numFound {0}, numProbed {0};
+    std::atomic<bool> walking {false};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryImporter)
+};
@@ -0,0 +1,287 @@
+/*
+  ==============================================================================
+
+    LibraryIndex.cpp
+    Created: 21 Oct 2026 9:31:50am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "LibraryIndex.h"
+#include <cstring>
+#include <limits>
+
+static_assert(sizeof(LibraryIndex::Header) == 40, "LibraryIndex::Header layout has changed");
+static_assert(sizeof(LibraryIndex::Record) == 120, "LibraryIndex::Record layout has changed");
+static_assert(sizeof(LibraryIndex::RecordV2) == 56, "LibraryIndex::RecordV2 layout has changed");
+static_assert(sizeof(LibraryIndex::RecordV1) == 32, "LibraryIndex::RecordV1 layout has changed");
+
+constexpr juce::uint32 LibraryIndex::currentVersion;
+constexpr juce::uint32 LibraryIndex::headerSizeV7;
+constexpr juce::uint32 LibraryIndex::recordSizeV3;
+constexpr juce::uint32 LibraryIndex::recordSizeV5;
+constexpr juce::uint32 LibraryIndex::recordSizeV6;
+constexpr juce::uint8 LibraryIndex::noKey;
+
+/* ==================== */
+/* ====== Writer ====== */
+/* ==================== */
+
+void LibraryIndex::Writer::addTrack(Record record, const std::string& title, const std::string& url,
+                                    const std::string& artist, const std::string& album)
+{
+    std::memset(record.reserved, 0, sizeof(record.reserved));
+    record.reservedEnd = 0;
+    record.titleOffset = addString(title);
+    record.titleLength = (juce::uint32)title.size();
+    record.urlOffset = addString(url);
+    record.urlLength = (juce::uint32)url.size();
+    record.artistOffset = addString(artist);
+    record.artistLength = (juce::uint32)artist.size();
+    record.albumOffset = addString(album);
+    record.albumLength = (juce::uint32)album.size();
+    records.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    ++numTracks;
+}
+
+void LibraryIndex::Writer::setJournalSequence(juce::uint64 sequence)
+{
+    journalSequence = sequence;
+}
+
+juce::uint32 LibraryIndex::Writer::addString(const std::string& text)
+{
+    juce::uint32 offset = (juce::uint32)stringPool.size();
+    stringPool += text;
+    return offset;
+}
+
+std::string LibraryIndex::Writer::finish()
+{
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "OTOL", 4);
+    header.version = currentVersion;
+    header.numTracks = numTracks;
+    header.recordSize = sizeof(Record);
+    header.stringPoolOffset = sizeof(Header) + records.size();
+    header.stringPoolSize = stringPool.size();
+    header.journalSequence = journalSequence;
+    std::string file;
+    file.reserve(header.stringPoolOffset + stringPool.size());
+    file.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    file += records;
+    file += stringPool;
+    return file;
+}
+
+/* =================== */
+/* ====== Index ====== */
+/* =================== */
+
+LibraryIndex::LibraryIndex()
+{
+}
+
+LibraryIndex::~LibraryIndex()
+{
+}
+
+bool LibraryIndex::open(const juce::File& file)
+{
+    close();
+    if (!file.existsAsFile())
+        return false;
+    mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    const char* data = static_cast<const char*>(mapping->getData());
+    size_t size = mapping->getSize();
+    // check everything the records could point at lies inside the file
+    // only the fields every version's header has are read until the version is known
+    bool valid = data != nullptr && size >= headerSizeV7;
+    const Header* candidate = valid ? reinterpret_cast<const Header*>(data) : nullptr;
+    valid = valid && std::memcmp(candidate->magic, "OTOL", 4) == 0;
+    const juce::uint32 headerSize = valid && candidate->version >= 8 ? (juce::uint32)sizeof(Header) : headerSizeV7;
+    valid = valid && size >= headerSize;
+    juce::uint32 expectedRecordSize = 0;
+    if (valid && (candidate->version == currentVersion || candidate->version == 7))
+        expectedRecordSize = sizeof(Record);
+    else if (valid && candidate->version == 6)
+        expectedRecordSize = recordSizeV6;
+    else if (valid && (candidate->version == 5 || candidate->version == 4))
+        expectedRecordSize = recordSizeV5;
+    else if (valid && candidate->version == 3)
+        expectedRecordSize = recordSizeV3;
+    else if (valid && candidate->version == 2)
+        expectedRecordSize = sizeof(RecordV2);
+    else if (valid && candidate->version == 1)
+        expectedRecordSize = sizeof(RecordV1);
+    valid = valid && expectedRecordSize != 0
+                  && candidate->recordSize == expectedRecordSize
+                  && candidate->stringPoolOffset == headerSize + (juce::uint64)candidate->numTracks * expectedRecordSize
+                  && candidate->stringPoolOffset + candidate->stringPoolSize <= size;
+    if (valid && candidate->version == 1)
+    {
+        // widen the old records, filling the fields they didn't have with unknowns
+        const RecordV1* oldRecords = reinterpret_cast<const RecordV1*>(data + headerSize);
+        upgradedRecords.resize(candidate->numTracks);
+        for (juce::uint32 i = 0; i < candidate->numTracks; ++i)
+        {
+            Record& record = upgradedRecords[i];
+            std::memset(&record, 0, sizeof(record));
+            record.libraryId = oldRecords[i].libraryId;
+            record.length = oldRecords[i].length;
+            record.bpm = std::numeric_limits<float>::quiet_NaN();
+            record.loudness = std::numeric_limits<float>::quiet_NaN();
+            record.titleOffset = oldRecords[i].titleOffset;
+            record.titleLength = oldRecords[i].titleLength;
+            record.urlOffset = oldRecords[i].urlOffset;
+            record.urlLength = oldRecords[i].urlLength;
+            record.key = noKey;
+            record.firstBeat = std::numeric_limits<float>::quiet_NaN();
+            record.fileSize = -1;
+            setMixPointsUnknown(record);
+            record.truePeak = std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+    else if (valid && candidate->version >= 3 && candidate->version <= 6)
+    {
+        // a version 3 signature is unknown, so the next scan of a watched folder probes each file once
+        // the zeroed reserved bytes would read as a beat at 0 seconds. Every track is left unanalysed,
+        // so the pipeline finds its mix points and true peak, keeping what it found before until then
+        const char* oldRecords = data + headerSize;
+        upgradedRecords.resize(candidate->numTracks);
+        for (juce::uint32 i = 0; i < candidate->numTracks; ++i)
+        {
+            Record& record = upgradedRecords[i];
+            std::memset(&record, 0, sizeof(record));
+            std::memcpy(&record, oldRecords + (size_t)i * expectedRecordSize, expectedRecordSize);
+            record.analysed = 0;
+            if (candidate->version < 5)
+                record.firstBeat = std::numeric_limits<float>::quiet_NaN();
+            if (candidate->version == 3)
+                record.fileSize = -1;
+            if (candidate->version < 6)
+                setMixPointsUnknown(record);
+            record.truePeak = std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+    else if (valid && candidate->version == 2)
+    {
+        // the same fields with an empty artist and album, which sit at the start of the pool with no length
+        const RecordV2* oldRecords = reinterpret_cast<const RecordV2*>(data + headerSize);
+        upgradedRecords.resize(candidate->numTracks);
+        for (juce::uint32 i = 0; i < candidate->numTracks; ++i)
+        {
+            Record& record = upgradedRecords[i];
+            std::memset(&record, 0, sizeof(record));
+            record.libraryId = oldRecords[i].libraryId;
+            record.dateAdded = oldRecords[i].dateAdded;
+            record.length = oldRecords[i].length;
+            record.bpm = oldRecords[i].bpm;
+            record.loudness = oldRecords[i].loudness;
+            record.titleOffset = oldRecords[i].titleOffset;
+            record.titleLength = oldRecords[i].titleLength;
+            record.urlOffset = oldRecords[i].urlOffset;
+            record.urlLength = oldRecords[i].urlLength;
+            record.playCount = oldRecords[i].playCount;
+            record.key = oldRecords[i].key;
+            record.firstBeat = std::numeric_limits<float>::quiet_NaN();
+            record.fileSize = -1;
+            setMixPointsUnknown(record);
+            record.truePeak = std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+    const Record* candidateRecords = nullptr;
+    if (valid)
+    {
+        candidateRecords = candidate->version >= 7 ? reinterpret_cast<const Record*>(data + headerSize)
+                                                   : upgradedRecords.data();
+        for (juce::uint32 i = 0; i < candidate->numTracks && valid; ++i)
+        {
+            const Record& record = candidateRecords[i];
+            valid = (juce::uint64)record.titleOffset + record.titleLength <= candidate->stringPoolSize
+                 && (juce::uint64)record.urlOffset + record.urlLength <= candidate->stringPoolSize
+                 && (juce::uint64)record.artistOffset + record.artistLength <= candidate->stringPoolSize
+                 && (juce::uint64)record.albumOffset + record.albumLength <= candidate->stringPoolSize;
+        }
+    }
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+    header = candidate;
+    records = candidateRecords;
+    stringPool = data + header->stringPoolOffset;
+    journalSequence = header->version >= 8 ? header->journalSequence : 0;
+    return true;
+}
+
+bool LibraryIndex::isCurrentVersion()
+{
+    return header != nullptr && header->version == currentVersion;
+}
+
+juce::uint64 LibraryIndex::getJournalSequence()
+{
+    return journalSequence;
+}
+
+void LibraryIndex::close()
+{
+    header = nullptr;
+    journalSequence = 0;
+    records = nullptr;
+    stringPool = nullptr;
+    std::vector<Record>().swap(upgradedRecords);
+    mapping.reset();
+}
+
+void LibraryIndex::setMixPointsUnknown(Record& record)
+{
+    record.soundStart = std::numeric_limits<float>::quiet_NaN();
+    record.introEnd = std::numeric_limits<float>::quiet_NaN();
+    record.outroStart = std::numeric_limits<float>::quiet_NaN();
+    record.soundEnd = std::numeric_limits<float>::quiet_NaN();
+}
+
+int LibraryIndex::getNumTracks()
+{
+    return header != nullptr ? (int)header->numTracks : 0;
+}
+
+const LibraryIndex::Record& LibraryIndex::getRecord(int index)
+{
+    jassert(index >= 0 && index < getNumTracks());
+    return records[index];
+}
+
+const char* LibraryIndex::getString(juce::uint32 offset)
+{
+    return stringPool + offset;
+}
+
+juce::String LibraryIndex::getTitle(int index)
+{
+    const Record& record = getRecord(index);
+    return juce::String::fromUTF8(getString(record.titleOffset), (int)record.titleLength);
+}
+
+juce::String LibraryIndex::getURL(int index)
+{
+    const Record& record = getRecord(index);
+    return juce::String::fromUTF8(getString(record.urlOffset), (int)record.urlLength);
+}
+
+juce::String LibraryIndex::getArtist(int index)
+{
+    const Record& record = getRecord(index);
+    return juce::String::fromUTF8(getString(record.artistOffset), (int)record.artistLength);
+}
+
+juce::String LibraryIndex::getAlbum(int index)
+{
+    const Record& record = getRecord(index);
+    return juce::String::fromUTF8(getString(record.albumOffset), (int)record.albumLength);
+}
@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    LibraryIndex.h
+    Created: 21 Oct 2026 9:31:50am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/*
+ Versioned binary snapshot of the music library
+ A header, then one fixed width record per track, then a pool of UTF-8 strings
+ the records point into. Opened with a memory mapping and read in place,
+ so opening costs nothing per track until a track is actually read
+ The app's TrackStore keeps the mapping open and reads the strings from it, but still
+ copies every record's fixed width fields and builds its id table when the library loads
+*/
+class LibraryIndex
+{
+public:
+    /** file layout, all values little-endian */
+    struct Header
+    {
+        char            magic[4];           // "OTOL"
+        juce::uint32    version;
+        juce::uint32    numTracks;
+        juce::uint32    recordSize;
+        juce::uint64    stringPoolOffset;
+        juce::uint64    stringPoolSize;
+        juce::uint64    journalSequence;    // last LibraryJournal record the file holds, 0 if none
+    };
+    /** a version 1 - 7 header is the start of a current one, before the journal sequence */
+    static constexpr juce::uint32 headerSizeV7 = 32;
+    struct Record
+    {
+        juce::int64     libraryId;
+        juce::int64     dateAdded;          // in ms since 1970, 0 if unknown
+        float           length;             // in seconds
+        float           bpm;                // NaN if unknown
+        float           loudness;           // in LUFS, NaN if unknown
+        juce::uint32    titleOffset;        // into the string pool
+        juce::uint32    titleLength;        // in bytes
+        juce::uint32    urlOffset;
+        juce::uint32    urlLength;
+        juce::uint32    artistOffset;       // an empty string if unknown
+        juce::uint32    artistLength;
+        juce::uint32    albumOffset;
+        juce::uint32    albumLength;
+        juce::uint32    playCount;
+        juce::uint8     key;                // 0 - 23, or noKey
+        juce::uint8     analysed;           // 1 once the file has been through the analysis pipeline
+        juce::uint8     reserved[2];
+        float           firstBeat;          // in seconds, NaN if the beat grid is unknown
+        juce::int64     fileModified;       // file signature when last probed, see TrackStore::FileSignature
+        juce::int64     fileSize;
+        juce::uint64    fileId;
+        float           soundStart;         // in seconds, where the leading silence ends, NaN if unknown
+        float           introEnd;           // in seconds, see TrackStore::MixPoints
+        float           outroStart;
+        float           soundEnd;           // in seconds, where the trailing silence starts
+        float           truePeak;           // in dBTP, NaN if unknown
+        juce::uint32    reservedEnd;        // keeps the record a whole number of int64s
+    };
+    /** a version 3 record is the start of a current one, before the file signature */
+    static constexpr juce::uint32 recordSizeV3 = 72;
+    /** a version 4 or 5 record is the start of a current one, before the mix points */
+    static constexpr juce::uint32 recordSizeV5 = 96;
+    /** a version 6 record is the start of a current one, before the true peak */
+    static constexpr juce::uint32 recordSizeV6 = 112;
+    /** version 2 record, without artist and album */
+    struct RecordV2
+    {
+        juce::int64     libraryId;
+        juce::int64     dateAdded;
+        float           length;
+        float           bpm;
+        float           loudness;
+        juce::uint32    titleOffset;
+        juce::uint32    titleLength;
+        juce::uint32    urlOffset;
+        juce::uint32    urlLength;
+        juce::uint32    playCount;
+        juce::uint8     key;
+        juce::uint8     reserved[7];
+    };
+    /** version 1 record, still read so an older library file is upgraded rather than lost */
+    struct RecordV1
+    {
+        juce::int64     libraryId;
+        float           length;
+        juce::uint32    titleOffset;
+        juce::uint32    titleLength;
+        juce::uint32    urlOffset;
+        juce::uint32    urlLength;
+        juce::uint32    reserved;
+    };
+    /** a version 4 record has neither the analysed flag nor the beat grid, a version 7 record is a current one */
+    static constexpr juce::uint32 currentVersion = 8;
+    static constexpr juce::uint8 noKey = 0xff;
+
+    //==============================================================================
+    /** builds the contents of an index file one track at a time */
+    class Writer
+    {
+    public:
+        /**
+         LibraryIndex::Writer::addTrack()
+         Input                  Record, std::string, std::string, std::string, std::string
+         Output                 none
+         @param record          every field but the string offsets and lengths, which are filled in here
+         Appends a record and its strings
+         */
+        void addTrack(Record record, const std::string& title, const std::string& url,
+                      const std::string& artist, const std::string& album);
+        
+        /** LibraryIndex::Writer::setJournalSequence() records the last journal record the file holds */
+        void setJournalSequence(juce::uint64 sequence);
+        
+        /**
+         LibraryIndex::Writer::finish()
+         Input                  none
+         Output                 std::string holding the whole file
+         Joins the header, records and string pool into the bytes of an index file
+         */
+        std::string finish();
+
+    private:
+        std::string records, stringPool;
+        juce::uint32 numTracks = 0;
+        juce::uint64 journalSequence = 0;
+        juce::uint32 addString(const std::string& text);
+    };
+
+    //==============================================================================
+    LibraryIndex();
+    ~LibraryIndex();
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     LibraryIndex::open()
+     Input                  juce::File
+     Output                 bool
+     Memory maps an index file and checks its header and bounds
+     A version 1 - 6 file is converted into current records held in memory, a version 7 one is read in place
+     Returns false if the file is missing, from an unknown version or damaged
+     */
+    bool open(const juce::File& file);
+    
+    /** LibraryIndex::isCurrentVersion() returns false if the open file was written by an older version */
+    bool isCurrentVersion();
+    
+    /** LibraryIndex::getJournalSequence() returns the last journal record the open file holds, 0 if none or it is older than version 8 */
+    juce::uint64 getJournalSequence();
+    
+    /** LibraryIndex::close() releases the mapping */
+    void close();
+    
+    /** LibraryIndex::getNumTracks() returns the number of records, 0 if nothing is open */
+    int getNumTracks();
+    
+    /** LibraryIndex::getRecord() returns a record, read in place from the mapping */
+    const Record& getRecord(int index);
+    
+    /**
+     LibraryIndex::getString()
+     Input                  juce::uint32, juce::uint32
+     Output                 const char* into the mapping
+     Returns a pointer to a string in the pool, which is not null terminated
+     */
+    const char* getString(juce::uint32 offset);
+    
+    /** LibraryIndex::getTitle() returns the title of a record as a juce::String */
+    juce::String getTitle(int index);
+    
+    /** LibraryIndex::getURL() returns the url of a record as a juce::String */
+    juce::String getURL(int index);
+    
+    /** LibraryIndex::getArtist() returns the artist of a record as a juce::String, empty if unknown */
+    juce::String getArtist(int index);
+    
+    /** LibraryIndex::getAlbum() returns the album of a record as a juce::String, empty if unknown */
+    juce::String getAlbum(int index);
+
+private:
+    /** LibraryIndex::setMixPointsUnknown() sets an upgraded record's mix points to NaN */
+    static void setMixPointsUnknown(Record& record);
+
+    /** the open index file */
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    /** header, records and string pool in the mapping */
+    const Header* header = nullptr;
+    const Record* records = nullptr;
+    const char* stringPool = nullptr;
+    juce::uint64 journalSequence = 0;
+    /** records converted from an older version, records points into it */
+    std::vector<Record> upgradedRecords;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryIndex)
+};
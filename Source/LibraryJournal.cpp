@@ -0,0 +1,371 @@
+/*
+  ==============================================================================
+
+    LibraryJournal.cpp
+    Created: 20 Oct 2026 11:05:37am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "LibraryJournal.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <iostream>
+#if JUCE_WINDOWS
+ #include <io.h>
+#else
+ #include <unistd.h>
+ #include <fcntl.h>
+#endif
+
+namespace
+{
+    /** opens a file for writing or appending, handling wide paths on Windows */
+    std::FILE* openForWriting(const juce::File& file, bool appendToEnd)
+    {
+       #if JUCE_WINDOWS
+        return _wfopen(file.getFullPathName().toWideCharPointer(), appendToEnd ? L"ab" : L"wb");
+       #else
+        return std::fopen(file.getFullPathName().toRawUTF8(), appendToEnd ? "ab" : "wb");
+       #endif
+    }
+
+    /** flushes a file all the way to the disk */
+    bool syncAndClose(std::FILE* file)
+    {
+        bool ok = std::fflush(file) == 0;
+       #if JUCE_WINDOWS
+        ok = ok && _commit(_fileno(file)) == 0;
+       #else
+        ok = ok && fsync(fileno(file)) == 0;
+       #endif
+        return std::fclose(file) == 0 && ok;
+    }
+
+    /** flushes a folder's entries to the disk, so a file created, renamed or deleted in it stays that way after a crash */
+    bool syncDirectory(const juce::File& directory)
+    {
+       #if JUCE_WINDOWS
+        // NTFS journals its own metadata, and a folder can't be opened for a flush
+        juce::ignoreUnused(directory);
+        return true;
+       #else
+        int descriptor = open(directory.getFullPathName().toRawUTF8(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        bool ok = fsync(descriptor) == 0;
+        return close(descriptor) == 0 && ok;
+       #endif
+    }
+}
+
+LibraryJournal::LibraryJournal(const juce::File& _snapshotFile, const juce::File& _journalFile) :
+                                juce::Thread("library journal"),
+                                snapshotFile(_snapshotFile),
+                                journalFile(_journalFile),
+                                compactingJournalFile(_journalFile.getFullPathName() + ".compacting")
+{
+}
+
+LibraryJournal::~LibraryJournal()
+{
+    // the thread writes anything still queued on its way out
+    stopThread(5000);
+    if (pending.size() > 0 || pendingCompaction)
+        writeBatch();
+}
+
+void LibraryJournal::replay(juce::uint64 snapshotSequence, std::function<void(const Record&)> apply)
+{
+    nextSequence = snapshotSequence + 1;
+    juce::uint64 unnumberedSequence = 0;
+    bool unfinishedCompaction = compactingJournalFile.existsAsFile();
+    if (unfinishedCompaction)
+        replayFile(compactingJournalFile, snapshotSequence, unnumberedSequence, apply);
+    replayFile(journalFile, snapshotSequence, unnumberedSequence, apply);
+    if (unfinishedCompaction)
+    {
+        // fold the leftover journal into the current one so nothing is lost,
+        // records the snapshot already holds are skipped again on the next replay
+        std::string leftover = compactingJournalFile.loadFileAsString().toStdString();
+        std::string current = journalFile.loadFileAsString().toStdString();
+        if (writeFileDurably(journalFile, leftover + current))
+            compactingJournalFile.deleteFile();
+    }
+    startThread(2);
+}
+
+void LibraryJournal::replayFile(const juce::File& file, juce::uint64 snapshotSequence, juce::uint64& unnumberedSequence,
+                                std::function<void(const Record&)>& apply)
+{
+    std::ifstream journal(file.getFullPathName().toStdString(), std::ios::binary);
+    if (!journal.is_open())
+        return;
+    std::string contents((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+    size_t lineStart = 0;
+    while (lineStart < contents.size())
+    {
+        size_t lineEnd = contents.find('\n', lineStart);
+        // a line without a newline was torn by a crash mid-write
+        if (lineEnd == std::string::npos)
+            break;
+        std::string line = contents.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (line.size() < 1)
+            continue;
+        // numbered lines start with their number. Lines from older versions start with their type, always come
+        // before any numbered line and are numbered from 1 in the order they are read, which a replay repeats
+        juce::uint64 sequence = 0;
+        if (line[0] >= '0' && line[0] <= '9')
+        {
+            size_t tab = line.find('\t');
+            try
+            {
+                sequence = (juce::uint64)std::stoull(line.substr(0, tab));
+            }
+            catch (const std::exception&)
+            {
+                continue;
+            }
+            line = tab == std::string::npos ? std::string() : line.substr(tab + 1);
+        }
+        else
+            sequence = ++unnumberedSequence;
+        nextSequence = juce::jmax(nextSequence, sequence + 1);
+        if (sequence <= snapshotSequence || line.size() < 1)
+            continue;
+        Record record;
+        std::istringstream fields(line.size() > 2 ? line.substr(2) : "");
+        std::string field;
+        try
+        {
+            switch (line[0])
+            {
+                case 'A':
+                    record.type = Record::add;
+                    record.payload = line.substr(2);
+                    std::getline(fields, field, '\t');
+                    record.libraryId = std::stol(field);
+                    break;
+                case 'R':
+                    record.type = Record::remove;
+                    std::getline(fields, field, '\t');
+                    record.libraryId = std::stol(field);
+                    break;
+                case 'M':
+                    record.type = Record::move;
+                    std::getline(fields, field, '\t');
+                    record.libraryId = std::stol(field);
+                    std::getline(fields, field, '\t');
+                    record.index = std::stoi(field);
+                    break;
+                case 'S':
+                    record.type = Record::set;
+                    std::getline(fields, field, '\t');
+                    record.libraryId = std::stol(field);
+                    std::getline(fields, record.field, '\t');
+                    std::getline(fields, record.payload);
+                    break;
+                case 'C':
+                    record.type = Record::clear;
+                    break;
+                default:
+                    continue;
+            }
+        }
+        catch (const std::exception&)
+        {
+            // skip a damaged record rather than lose the rest of the journal
+            continue;
+        }
+        apply(record);
+        ++recordsSinceCompaction;
+    }
+}
+
+void LibraryJournal::appendAdd(const std::string& payload)
+{
+    append("A\t" + payload + "\n");
+}
+
+void LibraryJournal::appendAdd(const std::vector<std::string>& payloads)
+{
+    std::string lines;
+    for (const std::string& payload : payloads)
+        lines += "A\t" + payload + "\n";
+    append(lines, (int)payloads.size());
+}
+
+void LibraryJournal::appendRemove(long int libraryId)
+{
+    append("R\t" + std::to_string(libraryId) + "\n");
+}
+
+void LibraryJournal::appendRemove(const std::vector<long int>& libraryIds)
+{
+    std::string lines;
+    for (long int libraryId : libraryIds)
+        lines += "R\t" + std::to_string(libraryId) + "\n";
+    append(lines, (int)libraryIds.size());
+}
+
+void LibraryJournal::appendMove(long int libraryId, int index)
+{
+    append("M\t" + std::to_string(libraryId) + "\t" + std::to_string(index) + "\n");
+}
+
+void LibraryJournal::appendMove(const std::vector<long int>& libraryIds, int index)
+{
+    // once the block is gathered at the end, each move leaves the tracks before it where they are
+    std::string lines;
+    const std::string toEnd = "\t" + std::to_string(std::numeric_limits<int>::max()) + "\n";
+    for (long int libraryId : libraryIds)
+        lines += "M\t" + std::to_string(libraryId) + toEnd;
+    for (size_t i = 0; i < libraryIds.size(); ++i)
+        lines += "M\t" + std::to_string(libraryIds[i]) + "\t" + std::to_string(index + (int)i) + "\n";
+    append(lines, (int)libraryIds.size() * 2);
+}
+
+void LibraryJournal::appendSet(long int libraryId, const std::string& field, const std::string& value)
+{
+    append("S\t" + std::to_string(libraryId) + "\t" + field + "\t" + value + "\n");
+}
+
+void LibraryJournal::appendSet(const std::vector<long int>& libraryIds, const std::string& field, const std::string& value)
+{
+    std::string lines;
+    for (long int libraryId : libraryIds)
+        lines += "S\t" + std::to_string(libraryId) + "\t" + field + "\t" + value + "\n";
+    append(lines, (int)libraryIds.size());
+}
+
+void LibraryJournal::appendClear()
+{
+    append("C\n");
+}
+
+void LibraryJournal::append(const std::string& lines, int numRecords)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        // each line is numbered as it is queued, so the numbers follow the order the changes were made
+        for (size_t lineStart = 0; lineStart < lines.size();)
+        {
+            size_t lineEnd = lines.find('\n', lineStart);
+            lineEnd = lineEnd == std::string::npos ? lines.size() : lineEnd + 1;
+            pending += std::to_string(nextSequence++) + "\t";
+            pending.append(lines, lineStart, lineEnd - lineStart);
+            lineStart = lineEnd;
+        }
+        recordsSinceCompaction += numRecords;
+    }
+    notify();
+}
+
+void LibraryJournal::compact(std::function<std::string(juce::uint64)> buildSnapshot)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        // the snapshot already contains everything queued so far
+        pendingCompaction = std::move(buildSnapshot);
+        pendingCompactionMark = pending.size();
+        pendingCompactionSequence = nextSequence - 1;
+        recordsSinceCompaction = 0;
+    }
+    notify();
+}
+
+bool LibraryJournal::needsCompaction(int librarySize)
+{
+    const juce::ScopedLock sl(lock);
+    return !pendingCompaction && recordsSinceCompaction > juce::jmax(1000, librarySize);
+}
+
+void LibraryJournal::run()
+{
+    while (!threadShouldExit())
+    {
+        // batch up whatever arrives in the interval into one write and one fsync;
+        // sleep rather than wait so further appends don't cut the interval short
+        wait(-1);
+        if (!threadShouldExit())
+            juce::Thread::sleep(flushIntervalMs);
+        writeBatch();
+    }
+    writeBatch();
+}
+
+void LibraryJournal::writeBatch()
+{
+    std::string beforeCompaction, afterCompaction;
+    std::function<std::string(juce::uint64)> buildSnapshot;
+    juce::uint64 snapshotSequence = 0;
+    {
+        const juce::ScopedLock sl(lock);
+        if (pendingCompaction)
+        {
+            beforeCompaction = pending.substr(0, pendingCompactionMark);
+            afterCompaction = pending.substr(pendingCompactionMark);
+            buildSnapshot = std::move(pendingCompaction);
+            snapshotSequence = pendingCompactionSequence;
+            pendingCompaction = nullptr;
+        }
+        else
+            beforeCompaction = pending;
+        pending.clear();
+    }
+    if (beforeCompaction.size() > 0)
+        appendToJournalFile(beforeCompaction);
+    if (buildSnapshot)
+    {
+        // set the current journal aside, so a crash before the rename still replays it
+        if (journalFile.existsAsFile())
+            journalFile.moveFileTo(compactingJournalFile);
+        juce::File temporary = snapshotFile.getSiblingFile(snapshotFile.getFileName() + ".tmp");
+        if (writeFileDurably(temporary, buildSnapshot(snapshotSequence)) && temporary.replaceFileIn(snapshotFile))
+        {
+            // the rename has to reach the disk before the journal it replaces is deleted
+            // if it can't be made sure of, the journal stays, and a replay skips the records the new snapshot holds
+            if (syncDirectory(snapshotFile.getParentDirectory()))
+                compactingJournalFile.deleteFile();
+            else
+                std::cout << "LibraryJournal::writeBatch: unable to sync " << snapshotFile.getParentDirectory().getFullPathName() << std::endl;
+        }
+        else
+        {
+            // the old snapshot is still in place, so put its journal back
+            temporary.deleteFile();
+            std::string leftover = compactingJournalFile.loadFileAsString().toStdString();
+            if (writeFileDurably(journalFile, leftover))
+                compactingJournalFile.deleteFile();
+        }
+    }
+    if (afterCompaction.size() > 0)
+        appendToJournalFile(afterCompaction);
+}
+
+void LibraryJournal::appendToJournalFile(const std::string& data)
+{
+    std::FILE* file = openForWriting(journalFile, true);
+    if (file == nullptr)
+    {
+        std::cout << "LibraryJournal::appendToJournalFile: unable to open " << journalFile.getFullPathName() << std::endl;
+        return;
+    }
+    std::fwrite(data.data(), 1, data.size(), file);
+    syncAndClose(file);
+}
+
+bool LibraryJournal::writeFileDurably(const juce::File& file, const std::string& data)
+{
+    std::FILE* handle = openForWriting(file, false);
+    if (handle == nullptr)
+        return false;
+    bool ok = std::fwrite(data.data(), 1, data.size(), handle) == data.size();
+    ok = syncAndClose(handle) && ok;
+    // a file that was just created isn't durable until its folder entry is
+    return ok && syncDirectory(file.getParentDirectory());
+}
@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+    LibraryJournal.h
+    Created: 20 Oct 2026 11:05:37am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <functional>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/*
+ Append-only change journal for the music library
+ Each add / remove / move / set / clear is appended as one short numbered line, and lines are
+ written and fsynced in batches by a background thread
+ The library snapshot is rewritten in the background from time to time,
+ replacing the old one with an atomic rename, after which the journal starts again
+ The snapshot holds the number of the last record in it, so a journal left behind
+ by a crash after the rename isn't applied twice
+*/
+class LibraryJournal  : private juce::Thread
+{
+public:
+    LibraryJournal(const juce::File& _snapshotFile, const juce::File& _journalFile);
+    ~LibraryJournal() override;
+
+    /** one replayed change */
+    struct Record
+    {
+        enum Type { add, remove, move, clear, set };
+        Type            type;
+        long int        libraryId = -1;
+        int             index = -1;     // destination of a move
+        std::string     payload;        // serialised track for an add, new value for a set
+        std::string     field;          // name of the field changed by a set
+    };
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     LibraryJournal::replay()
+     Input                  juce::uint64, std::function<void(const Record&)>
+     Output                 none
+     @param snapshotSequence    number of the last record the loaded snapshot holds, 0 if none
+     @param apply               called for each record after it, in the order it was written
+     Reads back any journal left from a compaction that didn't finish, then the current journal
+     A torn final line from a crash is ignored
+     Call once at startup after the snapshot has been loaded, before anything is appended
+     */
+    void replay(juce::uint64 snapshotSequence, std::function<void(const Record&)> apply);
+    
+    /** LibraryJournal::appendAdd() journals a track added to the end of the library, payload is its serialised line */
+    void appendAdd(const std::string& payload);
+    
+    /** LibraryJournal::appendAdd() journals many tracks added to the end of the library, queued as one write */
+    void appendAdd(const std::vector<std::string>& payloads);
+    
+    /** LibraryJournal::appendRemove() journals the removal of a track */
+    void appendRemove(long int libraryId);
+    
+    /** LibraryJournal::appendRemove() journals the removal of many tracks, queued as one write */
+    void appendRemove(const std::vector<long int>& libraryIds);
+    
+    /** LibraryJournal::appendMove() journals a track being moved to a new position in the library */
+    void appendMove(long int libraryId, int index);
+    
+    /**
+     LibraryJournal::appendMove()
+     Input                  std::vector<long int>, int
+     Output                 none
+     @param libraryIds      the moved tracks in their new library order
+     @param index           position of the first of them once moved
+     Journals a block of tracks moved together, queued as one write
+     Replayed as single moves, first sending each track to the end, then each to its place in the block
+     */
+    void appendMove(const std::vector<long int>& libraryIds, int index);
+    
+    /**
+     LibraryJournal::appendSet()
+     Input                  long int, std::string, std::string
+     Output                 none
+     @param field           name of the field, without tabs
+     Journals a new value for one field of a track, such as its play count
+     */
+    void appendSet(long int libraryId, const std::string& field, const std::string& value);
+    
+    /** LibraryJournal::appendSet() journals the same new value for a field of many tracks, queued as one write */
+    void appendSet(const std::vector<long int>& libraryIds, const std::string& field, const std::string& value);
+    
+    /** LibraryJournal::appendClear() journals the library being emptied */
+    void appendClear();
+    
+    /**
+     LibraryJournal::compact()
+     Input                  std::function<std::string(juce::uint64)>
+     Output                 none
+     @param buildSnapshot   builds the full snapshot file contents, stamped with the number of the last
+                            record it holds, which it is passed. Run on the journal thread,
+                            so it must only use data captured by value
+     Schedules a background rewrite of the snapshot, which replaces the old one with an atomic
+     rename. Changes appended after this call go into a fresh journal
+     */
+    void compact(std::function<std::string(juce::uint64)> buildSnapshot);
+    
+    /**
+     LibraryJournal::needsCompaction()
+     Input                  int number of tracks in the library
+     Output                 bool
+     Returns true once the journal has grown large compared to the library it describes
+     */
+    bool needsCompaction(int librarySize);
+    
+    /**
+     LibraryJournal::writeFileDurably()
+     Input                  juce::File, std::string
+     Output                 bool
+     Writes data to file and fsyncs it and its folder before returning, returns false on failure
+     */
+    static bool writeFileDurably(const juce::File& file, const std::string& data);
+
+private:
+    // implement Thread
+    void run() override;
+    
+    /**
+     LibraryJournal::append()
+     Input                  std::string, int
+     Output                 none
+     @param numRecords      number of lines in lines
+     Queues lines for the next batched write and wakes the journal thread
+     */
+    void append(const std::string& lines, int numRecords = 1);
+    
+    /**
+     LibraryJournal::writeBatch()
+     Input                  none
+     Output                 none
+     Called on the journal thread. Writes and fsyncs everything queued,
+     performing a compaction at the point in the queue where it was requested
+     */
+    void writeBatch();
+    
+    /**
+     LibraryJournal::appendToJournalFile()
+     Input                  std::string
+     Output                 none
+     Appends bytes to the journal file and fsyncs it
+     */
+    void appendToJournalFile(const std::string& data);
+    
+    /**
+     LibraryJournal::replayFile()
+     Input                  juce::File, juce::uint64, std::function<void(const Record&)>
+     Output                 none
+     Parses one journal file and applies its records numbered after snapshotSequence
+     @param unnumberedSequence  number of the last line read that was written before lines were numbered
+     */
+    void replayFile(const juce::File& file, juce::uint64 snapshotSequence, juce::uint64& unnumberedSequence,
+                    std::function<void(const Record&)>& apply);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** full library snapshot, and the journal of changes since it was written */
+    juce::File snapshotFile, journalFile;
+    /** journal being folded into a new snapshot, only exists while a compaction is under way */
+    juce::File compactingJournalFile;
+    /** guards everything the message thread shares with the journal thread */
+    juce::CriticalSection lock;
+    /** lines waiting to be written */
+    std::string pending;
+    /** snapshot builder for a requested compaction, how much of pending it already covers and its last record */
+    std::function<std::string(juce::uint64)> pendingCompaction;
+    size_t pendingCompactionMark = 0;
+    juce::uint64 pendingCompactionSequence = 0;
+    /** number given to the next record appended, they start at 1 */
+    juce::uint64 nextSequence = 1;
+    /** records written since the last compaction */
+    int recordsSinceCompaction = 0;
+    /** how often queued lines are written and fsynced */
+    static constexpr int flushIntervalMs = 200;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryJournal)
+};
@@ -0,0 +1,270 @@
+/*
+  ==============================================================================
+
+    LibraryQuery.cpp
+    Created: 26 Oct 2026 10:44:19am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "LibraryQuery.h"
+#include <sstream>
+#include <cctype>
+
+/* ===================== */
+/* ====== parsing ====== */
+/* ===================== */
+
+LibraryQuery LibraryQuery::parse(const std::string& query)
+{
+    LibraryQuery parsed;
+    std::istringstream words(query);
+    std::string word;
+    while (words >> word)
+    {
+        size_t colon = word.find(':');
+        std::string field = juce::String(word.substr(0, colon)).toLowerCase().toStdString();
+        std::string value = colon == std::string::npos ? "" : word.substr(colon + 1);
+        bool understood = false;
+        if (colon != std::string::npos && !value.empty())
+        {
+            if (field == "bpm")
+                understood = parseRange(value, parseNumber, 0.5f, parsed.bpm);
+            else if (field == "len" || field == "length")
+                understood = parseRange(value, parseDuration, 0.5f, parsed.length);
+            else if (field == "lufs" || field == "loudness")
+                understood = parseRange(value, parseNumber, 0.5f, parsed.loudness);
+            else if (field == "key")
+            {
+                bool compatible = value.back() == '~';
+                if (compatible)
+                    value.pop_back();
+                std::istringstream keyList(value);
+                juce::uint32 keys = 0;
+                understood = true;
+                for (std::string keyName; std::getline(keyList, keyName, ',') && understood; )
+                {
+                    int key = parseKey(keyName);
+                    understood = key >= 0;
+                    if (understood)
+                        keys |= compatible ? compatibleKeys(key) : (juce::uint32)1 << key;
+                }
+                if (understood)
+                    parsed.keys |= keys;
+            }
+        }
+        if (!understood)
+            parsed.text += (parsed.text.empty() ? "" : " ") + word;
+    }
+    return parsed;
+}
+
+bool LibraryQuery::hasFilters() const
+{
+    return bpm.active || length.active || loudness.active || keys != 0;
+}
+
+bool LibraryQuery::parseRange(const std::string& text, std::function<bool(const std::string&, float&)> parseValue,
+                              float tolerance, Range& range)
+{
+    float low, high;
+    size_t dots = text.find("..");
+    // a leading '-' is a sign, not a range
+    size_t dash = text.find('-', 1);
+    if (text.compare(0, 2, "<=") == 0 || text.compare(0, 2, ">=") == 0)
+    {
+        if (!parseValue(text.substr(2), low))
+            return false;
+        (text[0] == '<' ? range.high : range.low) = low;
+    }
+    else if (text[0] == '<' || text[0] == '>')
+    {
+        if (!parseValue(text.substr(1), low))
+            return false;
+        (text[0] == '<' ? range.high : range.low) = low;
+    }
+    else if (dots != std::string::npos || dash != std::string::npos)
+    {
+        size_t split = dots != std::string::npos ? dots : dash;
+        size_t skip = dots != std::string::npos ? 2 : 1;
+        if (!parseValue(text.substr(0, split), low) || !parseValue(text.substr(split + skip), high))
+            return false;
+        range.low = juce::jmin(low, high);
+        range.high = juce::jmax(low, high);
+    }
+    else
+    {
+        if (!parseValue(text, low))
+            return false;
+        range.low = low - tolerance;
+        range.high = low + tolerance;
+    }
+    range.active = true;
+    return true;
+}
+
+bool LibraryQuery::parseNumber(const std::string& text, float& value)
+{
+    if (text.empty())
+        return false;
+    char* end = nullptr;
+    value = std::strtof(text.c_str(), &end);
+    return end == text.c_str() + text.size();
+}
+
+bool LibraryQuery::parseDuration(const std::string& text, float& seconds)
+{
+    if (text.empty())
+        return false;
+    size_t colon = text.find(':');
+    float minutes;
+    if (colon != std::string::npos)
+    {
+        if (!parseNumber(text.substr(0, colon), minutes) || !parseNumber(text.substr(colon + 1), seconds))
+            return false;
+        seconds += minutes * 60;
+        return true;
+    }
+    char unit = (char)std::tolower((unsigned char)text.back());
+    if (unit == 'm' && parseNumber(text.substr(0, text.size() - 1), minutes))
+    {
+        seconds = minutes * 60;
+        return true;
+    }
+    if (unit == 's')
+        return parseNumber(text.substr(0, text.size() - 1), seconds);
+    return parseNumber(text, seconds);
+}
+
+/* ================== */
+/* ====== keys ====== */
+/* ================== */
+
+int LibraryQuery::parseKey(const std::string& text)
+{
+    std::string key = juce::String(text).toLowerCase().toStdString();
+    if (key.empty())
+        return -1;
+    // Camelot: a number 1 - 12 then A for minor or B for major
+    if (std::isdigit((unsigned char)key[0]))
+    {
+        char* end = nullptr;
+        long number = std::strtol(key.c_str(), &end, 10);
+        std::string letter(end);
+        if (number < 1 || number > 12 || (letter != "a" && letter != "b"))
+            return -1;
+        // 8B is C major, each step up the wheel is a fifth up, 7 is its own inverse mod 12
+        int majorPitch = (int)(((number - 8) * 7 % 12 + 12) % 12);
+        return letter == "b" ? majorPitch : 12 + (majorPitch + 9) % 12;
+    }
+    // name: a letter, an optional sharp or flat, then m / min for minor
+    static const int letterPitches[] = { 9, 11, 0, 2, 4, 5, 7 };   // a - g
+    if (key[0] < 'a' || key[0] > 'g')
+        return -1;
+    int pitch = letterPitches[key[0] - 'a'];
+    size_t i = 1;
+    if (i < key.size() && (key[i] == '#' || key[i] == 'b'))
+        pitch += key[i++] == '#' ? 1 : -1;
+    std::string mode = key.substr(i);
+    if (mode != "" && mode != "m" && mode != "min" && mode != "maj")
+        return -1;
+    pitch = (pitch + 12) % 12;
+    return (mode == "m" || mode == "min") ? 12 + pitch : pitch;
+}
+
+int LibraryQuery::keyToCamelot(int key)
+{
+    int majorPitch = key < 12 ? key : (key - 12 + 3) % 12;
+    return (majorPitch * 7 + 7) % 12 + 1;
+}
+
+juce::uint32 LibraryQuery::compatibleKeys(int key)
+{
+    // same number on the other ring is the relative key, one step either way on the same ring is a fifth
+    juce::uint32 mask = (juce::uint32)1 << key;
+    bool minor = key >= 12;
+    int pitch = key % 12;
+    mask |= (juce::uint32)1 << ((minor ? 0 : 12) + (minor ? pitch + 3 : pitch + 9) % 12);
+    mask |= (juce::uint32)1 << ((minor ? 12 : 0) + (pitch + 7) % 12);
+    mask |= (juce::uint32)1 << ((minor ? 12 : 0) + (pitch + 5) % 12);
+    return mask;
+}
+
+/* ======================= */
+/* ====== filtering ====== */
+/* ======================= */
+
+bool LibraryQuery::run(const TrackStore& tracks, TitleSearchIndex& index,
+                       std::vector<juce::uint32>& results, const std::function<bool()>& shouldCancel) const
+{
+    results.clear();
+    int numRows = (int)tracks.getNumRows();
+    std::vector<juce::uint8> mask((size_t)numRows, 1);
+    if (bpm.active)
+        maskRange(tracks.getBpmColumn(), numRows, bpm, mask.data());
+    if (length.active)
+        maskRange(tracks.getLengthColumn(), numRows, length, mask.data());
+    if (loudness.active)
+        maskRange(tracks.getLoudnessColumn(), numRows, loudness, mask.data());
+    if (keys != 0)
+    {
+        const juce::uint8* keyColumn = tracks.getKeyColumn();
+        for (int row = 0; row < numRows; ++row)
+            mask[(size_t)row] &= (juce::uint8)(tracks.hasKey((juce::uint32)row) && ((keys >> keyColumn[row]) & 1));
+    }
+    if (shouldCancel && shouldCancel())
+        return false;
+    if (text.empty())
+    {
+        for (juce::uint32 row : tracks.getOrder())
+            if (mask[row])
+                results.push_back(row);
+        return true;
+    }
+    // when the field terms leave few rows, checking their titles directly beats the index, by the index's own rule
+    size_t survivors = 0;
+    for (juce::uint8 pass : mask)
+        survivors += pass;
+    if (survivors * 8 < mask.size())
+    {
+        std::string normalisedText = TitleSearchIndex::normalise(text.data(), (int)text.size());
+        for (juce::uint32 row : tracks.getOrder())
+            if (mask[row] && index.matches(normalisedText, row))
+                results.push_back(row);
+        return true;
+    }
+    // otherwise the index narrows the candidates, keeping library order
+    std::vector<juce::uint32> candidates;
+    if (!index.search(text, tracks, candidates, shouldCancel))
+        return false;
+    for (juce::uint32 row : candidates)
+        if (mask[row])
+            results.push_back(row);
+    return true;
+}
+
+void LibraryQuery::maskRange(const float* column, int numRows, const Range& range, juce::uint8* mask)
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+    int row = 0;
+    // NaN, an unknown value, fails both comparisons
+    auto scalarTest = [&range] (float value) { return (juce::uint8)(value >= range.low && value <= range.high); };
+    // scalar until the column is aligned for SIMD loads
+    const float* aligned = Vec::getNextSIMDAlignedPtr(const_cast<float*>(column));
+    int head = juce::jmin(numRows, (int)(aligned - column));
+    for (; row < head; ++row)
+        mask[row] &= scalarTest(column[row]);
+    const Vec low = Vec::expand(range.low), high = Vec::expand(range.high);
+    alignas(64) Vec::vMaskType::ElementType lanes[Vec::SIMDNumElements];
+    for (; row + (int)Vec::SIMDNumElements <= numRows; row += (int)Vec::SIMDNumElements)
+    {
+        Vec values = Vec::fromRawArray(column + row);
+        auto inRange = Vec::greaterThanOrEqual(values, low) & Vec::lessThanOrEqual(values, high);
+        inRange.copyToRawArray(lanes);
+        for (size_t lane = 0; lane < Vec::SIMDNumElements; ++lane)
+            mask[row + (int)lane] &= (juce::uint8)(lanes[lane] != 0);
+    }
+    for (; row < numRows; ++row)
+        mask[row] &= scalarTest(column[row]);
+}
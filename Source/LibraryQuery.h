@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    LibraryQuery.h
+    Created: 26 Oct 2026 10:44:19am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <limits>
+#include "TrackStore.h"
+#include "TitleSearchIndex.h"
+
+//==============================================================================
+/*
+ Structured library query, e.g. "bpm:120-128 key:8A len:<6m techno"
+ field:value terms filter on the numeric columns of a TrackStore, anything else
+ is title text searched through the TitleSearchIndex
+ Range terms are checked a SIMD register of rows at a time, each comparison
+ giving a lane mask that is ANDed into a mask per row
+ 
+ bpm:120-128  bpm:>=124  bpm:126        (a single bpm allows +/- 0.5)
+ len:<6m  len:3:30-5m  len:90s-200      (bare numbers are seconds)
+ lufs:-12..-8  lufs:>-9                 (use .. for ranges of negative numbers)
+ key:8A  key:Am,C  key:8A~              (~ adds the harmonically compatible keys)
+*/
+class LibraryQuery
+{
+public:
+    /** inclusive range on one column */
+    struct Range
+    {
+        bool            active = false;
+        float           low = -std::numeric_limits<float>::infinity();
+        float           high = std::numeric_limits<float>::infinity();
+    };
+    
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** title text, the words that weren't field:value terms */
+    std::string text;
+    Range bpm, length, loudness;
+    /** one bit per key index 0 - 23, 0 if there is no key term */
+    juce::uint32 keys = 0;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     LibraryQuery::parse()
+     Input                  std::string
+     Output                 LibraryQuery
+     Splits a query into field terms and title text
+     A term that can't be understood is treated as title text
+     */
+    static LibraryQuery parse(const std::string& query);
+    
+    /** LibraryQuery::hasFilters() returns true if any field term was given */
+    bool hasFilters() const;
+    
+    /**
+     LibraryQuery::run()
+     Input                  TrackStore, TitleSearchIndex, std::vector<juce::uint32>, std::function<bool()>
+     Output                 bool
+     @param results         filled with the matching rows, in library order
+     Finds the tracks that pass every field term and contain the title text
+     Returns false if the search was cancelled
+     */
+    bool run(const TrackStore& tracks, TitleSearchIndex& index,
+             std::vector<juce::uint32>& results, const std::function<bool()>& shouldCancel = nullptr) const;
+    
+    /**
+     LibraryQuery::parseKey()
+     Input                  std::string
+     Output                 int
+     Reads a key as Camelot ("8A", "12B") or a name ("C#m", "Bb", "F#min")
+     Returns the key index, 0 - 11 major from C and 12 - 23 minor from C, or -1
+     */
+    static int parseKey(const std::string& text);
+    
+    /** LibraryQuery::compatibleKeys() returns a key mask of the key, its Camelot neighbours and its relative key */
+    static juce::uint32 compatibleKeys(int key);
+    
+    /** LibraryQuery::keyToCamelot() returns the Camelot number 1 - 12 of a key index, the letter is B for major and A for minor */
+    static int keyToCamelot(int key);
+
+private:
+    /** LibraryQuery::parseRange() reads "a-b", "a..b", "<a", ">a", "<=a", ">=a" or "a", the last as a +/- tolerance range */
+    static bool parseRange(const std::string& text, std::function<bool(const std::string&, float&)> parseValue,
+                           float tolerance, Range& range);
+    /** LibraryQuery::parseDuration() reads seconds from "6m", "3:30", "90s" or "90" */
+    static bool parseDuration(const std::string& text, float& seconds);
+    static bool parseNumber(const std::string& text, float& value);
+    
+    /**
+     LibraryQuery::maskRange()
+     Input                  const float*, int, Range, juce::uint8*
+     Output                 none
+     Clears the mask of every row whose column value is outside the range
+     */
+    static void maskRange(const float* column, int numRows, const Range& range, juce::uint8* mask);
+};
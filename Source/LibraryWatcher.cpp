@@ -0,0 +1,502 @@
+/*
+  ==============================================================================
+
+    LibraryWatcher.cpp
+    Created: 31 Oct 2026 3:52:09pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "LibraryWatcher.h"
+#include "LibraryImporter.h"
+#include "LibraryJournal.h"
+#include <fstream>
+#include <unordered_map>
+#if JUCE_LINUX
+ #include <sys/inotify.h>
+ #include <unistd.h>
+ #include <cerrno>
+#endif
+
+constexpr int LibraryWatcher::pollIntervalMs;
+constexpr juce::uint32 LibraryWatcher::settleMs;
+constexpr juce::int64 LibraryWatcher::timeToleranceMs;
+
+LibraryWatcher::LibraryWatcher(juce::AudioFormatManager& _formatManager, const juce::File& _stateFile) :
+                                    juce::Thread("library watcher"),
+                                    formatManager(_formatManager),
+                                    stateFile(_stateFile)
+{
+    load();
+    startThread(2);
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    cancelPendingUpdate();
+    stopThread(4000);
+}
+
+/* ================================= */
+/* ====== message thread side ====== */
+/* ================================= */
+
+void LibraryWatcher::watch(const juce::File& folder)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        for (const juce::String& watched : folders)
+            if (folder == juce::File(watched) || folder.isAChildOf(juce::File(watched)))
+                return;
+        for (int i = folders.size(); --i >= 0; )
+            if (juce::File(folders[i]).isAChildOf(folder))
+                folders.remove(i);
+        folders.add(folder.getFullPathName());
+        foldersToWatch.add(folder.getFullPathName());
+        // the folder's files are being imported now, so a first scan only needs to look for newer ones
+        if (lastScanTime == 0)
+            lastScanTime = juce::Time::currentTimeMillis();
+    }
+    save();
+    notify();
+}
+
+void LibraryWatcher::unwatchAll()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        folders.clear();
+        foldersToWatch.clear();
+        foldersToScan.clear();
+        dropWatches = true;
+    }
+    save();
+    notify();
+}
+
+void LibraryWatcher::scanAll()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        FolderScan folderScan;
+        folderScan.recursive = true;
+        folderScan.newerThan = lastScanTime - timeToleranceMs;
+        for (const juce::String& folder : folders)
+            addFolderScan(foldersToScan, folder, folderScan);
+    }
+    triggerAsyncUpdate();
+}
+
+juce::StringArray LibraryWatcher::getFolders() const
+{
+    const juce::ScopedLock sl(lock);
+    return folders;
+}
+
+void LibraryWatcher::handleAsyncUpdate()
+{
+    std::vector<Change> changes;
+    bool deliver;
+    juce::int64 scanTime;
+    {
+        const juce::ScopedLock sl(lock);
+        deliver = changesReady;
+        changesReady = false;
+        changes.swap(readyChanges);
+        scanTime = readyScanTime;
+    }
+    if (deliver)
+    {
+        if (!changes.empty() && onChanges)
+            onChanges(changes);
+        // only once the library holds the changes does the scan count, or a crash could lose them
+        {
+            const juce::ScopedLock sl(lock);
+            lastScanTime = juce::jmax(lastScanTime, scanTime);
+        }
+        save();
+    }
+
+    // one scan at a time, each with a snapshot of the library as it is when it starts
+    {
+        const juce::ScopedLock sl(lock);
+        if (scanning || foldersToScan.empty())
+            return;
+        scanning = true;
+    }
+    std::vector<KnownTrack> tracks;
+    if (getKnownTracks)
+        tracks = getKnownTracks();
+    {
+        const juce::ScopedLock sl(lock);
+        scanFolders.swap(foldersToScan);
+        foldersToScan.clear();
+        scanTracks.swap(tracks);
+    }
+    notify();
+}
+
+void LibraryWatcher::load()
+{
+    const juce::ScopedLock sl(lock);
+    folders.clear();
+    std::ifstream watchFile(stateFile.getFullPathName().toStdString());
+    if (!watchFile.is_open())
+        return;
+    std::string line;
+    try
+    {
+        if (std::getline(watchFile, line))
+            lastScanTime = std::stoll(line);
+        while (std::getline(watchFile, line))
+            if (!line.empty())
+                folders.add(juce::String::fromUTF8(line.data(), (int)line.size()));
+    }
+    catch (const std::exception&)
+    {
+        std::cout << "LibraryWatcher::load: " << stateFile.getFullPathName() << " is damaged, no folders are watched" << std::endl;
+        folders.clear();
+        lastScanTime = 0;
+    }
+}
+
+void LibraryWatcher::save()
+{
+    std::string contents;
+    {
+        const juce::ScopedLock sl(lock);
+        contents = std::to_string(lastScanTime) + "\n";
+        for (const juce::String& folder : folders)
+            contents += folder.toStdString() + "\n";
+    }
+    if (!LibraryJournal::writeFileDurably(stateFile, contents))
+        std::cout << "LibraryWatcher::save: could not write " << stateFile.getFullPathName() << std::endl;
+}
+
+/* ================================= */
+/* ====== watcher thread side ====== */
+/* ================================= */
+
+void LibraryWatcher::run()
+{
+   #if JUCE_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+        std::cout << "LibraryWatcher::run: inotify is unavailable, watched folders are only scanned at startup" << std::endl;
+    {
+        const juce::ScopedLock sl(lock);
+        foldersToWatch.addArray(folders);
+    }
+   #endif
+    while (!threadShouldExit())
+    {
+       #if JUCE_LINUX
+        wait(inotifyFd >= 0 ? pollIntervalMs : -1);
+       #else
+        wait(-1);
+       #endif
+        if (threadShouldExit())
+            break;
+       #if JUCE_LINUX
+        if (inotifyFd >= 0)
+        {
+            juce::StringArray newFolders;
+            bool drop;
+            {
+                const juce::ScopedLock sl(lock);
+                newFolders.swapWith(foldersToWatch);
+                drop = dropWatches;
+                dropWatches = false;
+            }
+            if (drop)
+            {
+                for (const auto& watched : watchedDirectories)
+                    inotify_rm_watch(inotifyFd, watched.first);
+                watchedDirectories.clear();
+                changedFolders.clear();
+            }
+            for (const juce::String& folder : newFolders)
+                addWatches(juce::File(folder));
+            readEvents();
+            // wait for a quiet moment, so a folder being copied in is scanned once rather than file by file
+            if (!changedFolders.empty() && juce::Time::getMillisecondCounter() - lastEventMs >= settleMs)
+            {
+                {
+                    const juce::ScopedLock sl(lock);
+                    for (const auto& folder : changedFolders)
+                        addFolderScan(foldersToScan, folder.first, folder.second);
+                }
+                changedFolders.clear();
+                triggerAsyncUpdate();
+            }
+        }
+       #endif
+        std::map<juce::String, FolderScan> toScan;
+        std::vector<KnownTrack> tracks;
+        {
+            const juce::ScopedLock sl(lock);
+            if (!scanning || scanFolders.empty())
+                continue;
+            toScan.swap(scanFolders);
+            tracks.swap(scanTracks);
+        }
+        juce::int64 scanStart = juce::Time::currentTimeMillis();
+        std::vector<Change> changes = scan(toScan, tracks);
+        if (threadShouldExit())
+            break;
+        {
+            const juce::ScopedLock sl(lock);
+            readyChanges.insert(readyChanges.end(), changes.begin(), changes.end());
+            readyScanTime = scanStart;
+            changesReady = true;
+            scanning = false;
+        }
+        triggerAsyncUpdate();
+    }
+   #if JUCE_LINUX
+    if (inotifyFd >= 0)
+        ::close(inotifyFd);
+    inotifyFd = -1;
+    watchedDirectories.clear();
+   #endif
+}
+
+std::vector<LibraryWatcher::Change> LibraryWatcher::scan(const std::map<juce::String, FolderScan>& toScan,
+                                                         const std::vector<KnownTrack>& knownTracks)
+{
+    std::vector<Change> changes;
+    // a watched folder that has gone is most likely on a drive that isn't plugged in, so its tracks stay
+    const juce::StringArray watchedFolders = getFolders();
+    struct Scope
+    {
+        std::string     url;
+        bool            recursive;
+    };
+    std::vector<Scope> scopes;
+    auto isOnMissingFolder = [&watchedFolders] (const juce::File& directory)
+    {
+        for (const juce::String& watched : watchedFolders)
+            if (!juce::File(watched).isDirectory() && (directory == juce::File(watched) || directory.isAChildOf(juce::File(watched))))
+                return true;
+        return false;
+    };
+    for (const auto& folder : toScan)
+    {
+        juce::File directory(folder.first);
+        if (!directory.isDirectory() && isOnMissingFolder(directory))
+            continue;
+        scopes.push_back({ juce::URL(directory).toString(false).toStdString() + "/", folder.second.recursive });
+    }
+    auto inScope = [&scopes] (const std::string& url)
+    {
+        for (const Scope& scope : scopes)
+            if (url.compare(0, scope.url.size(), scope.url) == 0
+                && (scope.recursive || url.find('/', scope.url.size()) == std::string::npos))
+                return true;
+        return false;
+    };
+    std::vector<size_t> tracksInScope;
+    std::unordered_map<std::string, size_t> knownByURL;
+    for (size_t i = 0; i < knownTracks.size(); ++i)
+    {
+        if (inScope(knownTracks[i].url))
+        {
+            tracksInScope.push_back(i);
+            knownByURL.emplace(knownTracks[i].url, i);
+        }
+    }
+
+    // compare each file with its track, and keep the files that aren't in the library
+    struct UnknownFile
+    {
+        juce::File      file;
+        bool            isNew;
+    };
+    std::map<std::string, UnknownFile> unknownFiles;
+    std::vector<juce::uint8> seen(knownTracks.size(), 0);
+    const juce::String audioWildcard = formatManager.getWildcardForAllFormats();
+    for (const auto& folder : toScan)
+    {
+        juce::File directory(folder.first);
+        if (!directory.isDirectory())
+            continue;
+        for (const juce::DirectoryEntry& entry : juce::RangedDirectoryIterator(directory, folder.second.recursive, audioWildcard, juce::File::findFiles))
+        {
+            if (threadShouldExit())
+                return {};
+            std::string url = juce::URL(entry.getFile()).toString(false).toStdString();
+            auto known = knownByURL.find(url);
+            if (known == knownByURL.end())
+            {
+                // the creation time is the inode change time on Linux, so it also catches files moved in
+                bool isNew = juce::jmax(entry.getCreationTime(), entry.getModificationTime()).toMilliseconds() >= folder.second.newerThan;
+                auto unknown = unknownFiles.emplace(url, UnknownFile { entry.getFile(), isNew }).first;
+                unknown->second.isNew = unknown->second.isNew || isNew;
+                continue;
+            }
+            if (seen[known->second] != 0)
+                continue;
+            seen[known->second] = 1;
+            const KnownTrack& track = knownTracks[known->second];
+            TrackStore::FileSignature signature = LibraryImporter::readSignature(entry.getFile());
+            if (signature == track.signature)
+                continue;
+            Change change;
+            if (track.signature.size < 0)
+            {
+                // tracks from before signatures were kept are taken to be unchanged, and signed now
+                change.type = Change::moved;
+                change.track.url = url;
+                change.track.signature = signature;
+            }
+            else if (LibraryImporter::probe(entry.getFile(), formatManager, change.track))
+                change.type = Change::changed;
+            else
+                continue;
+            change.track.libraryId = track.libraryId;
+            changes.push_back(change);
+        }
+    }
+
+    // a track whose file has gone keeps its entry if the same file turned up under another name
+    std::unordered_map<juce::uint64, std::pair<std::string, TrackStore::FileSignature>> unknownById;
+    for (const auto& unknown : unknownFiles)
+    {
+        TrackStore::FileSignature signature = LibraryImporter::readSignature(unknown.second.file);
+        if (signature.fileId != 0)
+            unknownById.emplace(signature.fileId, std::make_pair(unknown.first, signature));
+    }
+    for (size_t i : tracksInScope)
+    {
+        if (seen[i] != 0)
+            continue;
+        const KnownTrack& track = knownTracks[i];
+        Change change;
+        auto renamed = track.signature.fileId != 0 ? unknownById.find(track.signature.fileId) : unknownById.end();
+        if (renamed != unknownById.end() && renamed->second.second.size == track.signature.size)
+        {
+            const std::string& url = renamed->second.first;
+            if (renamed->second.second.modified == track.signature.modified)
+            {
+                change.type = Change::moved;
+                change.track.url = url;
+                change.track.signature = renamed->second.second;
+            }
+            else if (LibraryImporter::probe(unknownFiles.at(url).file, formatManager, change.track))
+                change.type = Change::changed;
+            else
+                change.type = Change::removed;
+            unknownFiles.erase(url);
+            unknownById.erase(renamed);
+        }
+        else
+            change.type = Change::removed;
+        change.track.libraryId = track.libraryId;
+        changes.push_back(change);
+    }
+
+    // files that are new since the folder was last looked at join the library, older ones were left out on purpose
+    for (const auto& unknown : unknownFiles)
+    {
+        if (threadShouldExit())
+            return {};
+        Change change;
+        change.type = Change::added;
+        if (unknown.second.isNew && LibraryImporter::probe(unknown.second.file, formatManager, change.track))
+            changes.push_back(change);
+    }
+    return changes;
+}
+
+void LibraryWatcher::addFolderScan(std::map<juce::String, FolderScan>& toScan, const juce::String& path, FolderScan folderScan)
+{
+    auto inserted = toScan.emplace(path, folderScan);
+    if (inserted.second)
+        return;
+    FolderScan& existing = inserted.first->second;
+    existing.recursive = existing.recursive || folderScan.recursive;
+    existing.newerThan = juce::jmin(existing.newerThan, folderScan.newerThan);
+}
+
+#if JUCE_LINUX
+void LibraryWatcher::addWatches(const juce::File& folder)
+{
+    const juce::uint32 mask = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    auto addWatch = [this, mask] (const juce::File& directory)
+    {
+        // watching a folder again, as after it was moved, returns its existing watch
+        int watch = inotify_add_watch(inotifyFd, directory.getFullPathName().toRawUTF8(), mask);
+        if (watch >= 0)
+            watchedDirectories[watch] = directory.getFullPathName();
+        else if (errno == ENOSPC && !reportedWatchLimit)
+        {
+            reportedWatchLimit = true;
+            std::cout << "LibraryWatcher::addWatches: out of inotify watches, raise fs.inotify.max_user_watches to watch every folder" << std::endl;
+        }
+        return watch >= 0;
+    };
+    if (!folder.isDirectory() || !addWatch(folder))
+        return;
+    for (const juce::DirectoryEntry& entry : juce::RangedDirectoryIterator(folder, true, "*", juce::File::findDirectories))
+    {
+        if (threadShouldExit())
+            return;
+        addWatch(entry.getFile());
+    }
+}
+
+void LibraryWatcher::readEvents()
+{
+    alignas(struct inotify_event) char buffer[16384];
+    for (;;)
+    {
+        ssize_t numBytes = ::read(inotifyFd, buffer, sizeof(buffer));
+        if (numBytes <= 0)
+            return;
+        for (const char* position = buffer; position < buffer + numBytes; )
+        {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(position);
+            position += sizeof(struct inotify_event) + event->len;
+            if (changedFolders.empty())
+                firstEventTime = juce::Time::currentTimeMillis();
+            lastEventMs = juce::Time::getMillisecondCounter();
+            FolderScan folderScan;
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                // events were lost, so every folder is compared in full
+                folderScan.recursive = true;
+                const juce::ScopedLock sl(lock);
+                folderScan.newerThan = lastScanTime - timeToleranceMs;
+                for (const juce::String& folder : folders)
+                    addFolderScan(changedFolders, folder, folderScan);
+                continue;
+            }
+            auto directory = watchedDirectories.find(event->wd);
+            if (directory == watchedDirectories.end())
+                continue;
+            if ((event->mask & IN_IGNORED) != 0)
+            {
+                watchedDirectories.erase(directory);
+                continue;
+            }
+            if (event->len == 0)
+                continue;
+            juce::File file = juce::File(directory->second).getChildFile(juce::String::fromUTF8(event->name));
+            if ((event->mask & IN_ISDIR) != 0)
+            {
+                // every file in a folder created or moved in is new to the library, whatever its times
+                folderScan.recursive = true;
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+                    addWatches(file);
+                addFolderScan(changedFolders, file.getFullPathName(), folderScan);
+            }
+            else if (formatManager.findFormatForFileExtension(file.getFileExtension()) != nullptr)
+            {
+                folderScan.newerThan = firstEventTime - timeToleranceMs;
+                addFolderScan(changedFolders, directory->second, folderScan);
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    LibraryWatcher.h
+    Created: 31 Oct 2026 3:52:09pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include "TrackStore.h"
+#if JUCE_LINUX
+ #include <unordered_map>
+#endif
+
+//==============================================================================
+/*
+ Keeps the library in step with the folders it was imported from
+ Each track stores a signature of its file, the modification time, size and
+ inode number. A scan walks the watched folders and compares signatures, so only
+ files that have changed are probed again, and a file that was renamed or moved
+ keeps its library entry by matching its inode number. New files are added, and
+ tracks whose files have gone are removed
+ Every folder is scanned at startup. On Linux the folders are also watched with
+ inotify while the app runs, and only the folders that saw events are scanned,
+ once they have been quiet for a moment
+ A watched folder that is missing, such as an unplugged drive, is left alone
+*/
+class LibraryWatcher  : private juce::Thread,
+                        private juce::AsyncUpdater
+{
+public:
+    /**
+     LibraryWatcher::LibraryWatcher()
+     @param _stateFile      where the watched folders and the time of the last scan are kept
+     */
+    LibraryWatcher(juce::AudioFormatManager& _formatManager, const juce::File& _stateFile);
+    ~LibraryWatcher() override;
+
+    /** a library track as a scan compares it with its file */
+    struct KnownTrack
+    {
+        long int                    libraryId;
+        std::string                 url;
+        TrackStore::FileSignature   signature;
+    };
+    /** one difference a scan found between the library and the watched folders */
+    struct Change
+    {
+        /** a moved track has a new url or a first signature, but the same audio */
+        enum Type { added, changed, moved, removed };
+        Type                        type;
+        /** freshly probed for added and changed tracks, only the url and signature for moved tracks,
+            only the library id for removed ones. Added tracks have no library id yet */
+        TrackStore::TrackInfo       track;
+    };
+
+    /** called on the message thread when a scan is about to start, returns every track in the library */
+    std::function<std::vector<KnownTrack>()> getKnownTracks;
+    /** called on the message thread with the changes each scan found */
+    std::function<void(std::vector<Change>&)> onChanges;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     LibraryWatcher::watch()
+     Input                  juce::File
+     Output                 none
+     Starts watching a folder, unless it is inside one already watched. Folders inside it stop being watched
+     separately. Doesn't scan the folder, its files are expected to be imported already
+     */
+    void watch(const juce::File& folder);
+
+    /** LibraryWatcher::unwatchAll() stops watching every folder, such as when the library is emptied */
+    void unwatchAll();
+
+    /** LibraryWatcher::scanAll() scans every watched folder, comparing every track in them with its file */
+    void scanAll();
+
+    /** LibraryWatcher::getFolders() returns the watched folders */
+    juce::StringArray getFolders() const;
+
+private:
+    /** how much of a folder a scan looks at */
+    struct FolderScan
+    {
+        bool                        recursive = false;
+        /** files that aren't in the library are only added if created or modified since, in ms since 1970 */
+        juce::int64                 newerThan = 0;
+    };
+
+    // implement Thread
+    void run() override;
+    // implement AsyncUpdater
+    void handleAsyncUpdate() override;
+
+    /**
+     LibraryWatcher::scan()
+     Input                  std::map<juce::String, FolderScan>, std::vector<KnownTrack>
+     Output                 std::vector<Change>
+     @param toScan          paths of the folders to scan
+     @param knownTracks     every track in the library, only those inside the folders are checked
+     Called on the watcher thread. Walks the folders and works out how the library has to change to match them
+     Returns nothing if the thread is stopped part way
+     */
+    std::vector<Change> scan(const std::map<juce::String, FolderScan>& toScan, const std::vector<KnownTrack>& knownTracks);
+
+    /** LibraryWatcher::addFolderScan() merges a folder into a set of folders to scan, widening what is already there */
+    static void addFolderScan(std::map<juce::String, FolderScan>& toScan, const juce::String& path, FolderScan folderScan);
+
+    /** LibraryWatcher::load() reads the state file, leaving nothing watched if it is missing or damaged */
+    void load();
+    /** LibraryWatcher::save() writes the time of the last scan, then one watched folder per line */
+    void save();
+
+   #if JUCE_LINUX
+    /** LibraryWatcher::addWatches() adds an inotify watch to a folder and every folder inside it */
+    void addWatches(const juce::File& folder);
+    /** LibraryWatcher::readEvents() turns waiting inotify events into folders to scan */
+    void readEvents();
+   #endif
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    /** shared with the rest of the app, only used to probe files */
+    juce::AudioFormatManager& formatManager;
+    juce::File stateFile;
+
+    /** guards everything below that both threads use */
+    juce::CriticalSection lock;
+    /** folders being watched */
+    juce::StringArray folders;
+    /** when the last scan whose changes reached the library started, in ms since 1970 */
+    juce::int64 lastScanTime = 0;
+    /** folders waiting for a scan, and the folders and library snapshot of the scan handed to the watcher thread */
+    std::map<juce::String, FolderScan> foldersToScan, scanFolders;
+    std::vector<KnownTrack> scanTracks;
+    bool scanning = false;
+    /** changes from a finished scan waiting for the message thread, and when that scan started */
+    std::vector<Change> readyChanges;
+    juce::int64 readyScanTime = 0;
+    bool changesReady = false;
+    /** new folders for the watcher thread to add watches to, or true to drop every watch */
+    juce::StringArray foldersToWatch;
+    bool dropWatches = false;
+
+   #if JUCE_LINUX
+    /** only used on the watcher thread */
+    int inotifyFd = -1;
+    std::unordered_map<int, juce::String> watchedDirectories;
+    /** folders that saw events, when the first arrived in ms since 1970, and when the last arrived */
+    std::map<juce::String, FolderScan> changedFolders;
+    juce::int64 firstEventTime = 0;
+    juce::uint32 lastEventMs = 0;
+    bool reportedWatchLimit = false;
+   #endif
+
+    /** how often the watcher thread looks for inotify events */
+    static constexpr int pollIntervalMs = 250;
+    /** how long folders have to be free of events before they are scanned, so a copy finishes first */
+    static constexpr juce::uint32 settleMs = 1500;
+    /** slack on the creation times of new files, as some file systems keep whole seconds */
+    static constexpr juce::int64 timeToleranceMs = 2000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryWatcher)
+};
@@ -0,0 +1,308 @@
+/*
+  ==============================================================================
+
+    LoudnessMeter.cpp
+    Created: 19 Oct 2026 9:48:22am
+    Author:  Nigel Powell
+    K-weighting and true-peak filters follow ITU-R BS.1770-4
+    Loudness windows follow EBU R128 / Tech 3341
+
+  ==============================================================================
+*/
+
+#include "LoudnessMeter.h"
+#include <cmath>
+#include <cstring>
+
+const float LoudnessMeter::truePeakCoefficients[LoudnessMeter::oversampling][LoudnessMeter::truePeakTaps] =
+{
+    { 0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f, -0.0594482421875f,  0.1373291015625f,
+      0.9721679687500f, -0.1022949218750f,  0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+    {-0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f, -0.1665039062500f,  0.4650878906250f,
+      0.7797851562500f, -0.2003173828125f,  0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+    {-0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f, -0.2003173828125f,  0.7797851562500f,
+      0.4650878906250f, -0.1665039062500f,  0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+    {-0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f, -0.1022949218750f,  0.9721679687500f,
+      0.1373291015625f, -0.0594482421875f,  0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f }
+};
+
+LoudnessMeter::LoudnessMeter()
+{
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        peakHold[channel] = 0.0f;
+        truePeakHold[channel] = 0.0f;
+        rmsLevel[channel] = 0.0f;
+    }
+}
+
+LoudnessMeter::~LoudnessMeter()
+{
+}
+
+void LoudnessMeter::prepareToPlay(int _maxBlockSize, double sampleRate)
+{
+    maxBlockSize = juce::jmax(1, _maxBlockSize);
+    samplesPerGatingBlock = juce::jmax(1, juce::roundToInt(sampleRate / 10));
+    weightedScratch.assign(maxBlockSize, 0.0f);
+    oversampledScratch.assign(maxBlockSize, 0.0f);
+    for (int channel = 0; channel < 2; ++channel)
+        truePeakHistory[channel].assign(maxBlockSize + truePeakTaps - 1, 0.0f);
+
+    // stage 1 - high shelf modelling the acoustic effect of the head
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+    double vh = std::pow(10.0, gain / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    Biquad shelf;
+    shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    shelf.b1 = 2.0 * (k * k - vh) / a0;
+    shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    shelf.a2 = (1.0 - k / q + k * k) / a0;
+    // stage 2 - RLB high pass
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+    a0 = 1.0 + k / q + k * k;
+    Biquad highPass;
+    highPass.b0 = 1.0;
+    highPass.b1 = -2.0;
+    highPass.b2 = 1.0;
+    highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+    highPass.a2 = (1.0 - k / q + k * k) / a0;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        shelfFilter[channel] = shelf;
+        highPassFilter[channel] = highPass;
+    }
+    reset();
+}
+
+void LoudnessMeter::reset()
+{
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        shelfFilter[channel].z1 = shelfFilter[channel].z2 = 0;
+        highPassFilter[channel].z1 = highPassFilter[channel].z2 = 0;
+        std::fill(truePeakHistory[channel].begin(), truePeakHistory[channel].end(), 0.0f);
+        weightedEnergy[channel] = rawEnergy[channel] = 0;
+        std::fill(std::begin(rawHistory[channel]), std::end(rawHistory[channel]), 0.0);
+    }
+    std::fill(std::begin(weightedHistory), std::end(weightedHistory), 0.0);
+    std::fill(std::begin(integratedEnergy), std::end(integratedEnergy), 0.0);
+    std::fill(std::begin(integratedCount), std::end(integratedCount), 0u);
+    gatingBlockFill = 0;
+    historyWrite = 0;
+    historyCount = 0;
+    // the published readings go too, so a new track doesn't show the last one's levels
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        peakHold[channel] = 0.0f;
+        truePeakHold[channel] = 0.0f;
+        rmsLevel[channel] = 0.0f;
+    }
+    momentaryLufs = silenceLufs;
+    shortTermLufs = silenceLufs;
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (maxBlockSize == 0 || buffer.getNumChannels() == 0)
+        return;
+    int rightChannel = buffer.getNumChannels() > 1 ? 1 : 0;
+    // split blocks larger than the host promised rather than allocate
+    for (int offset = 0; offset < numSamples; offset += maxBlockSize)
+    {
+        int blockSize = juce::jmin(maxBlockSize, numSamples - offset);
+        const float* input[2] = {buffer.getReadPointer(0, startSample + offset),
+                                 buffer.getReadPointer(rightChannel, startSample + offset)};
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            publishMax(peakHold[channel], absoluteMax(input[channel], blockSize));
+            publishMax(truePeakHold[channel], measureTruePeak(channel, input[channel], blockSize));
+        }
+        // loudness is accumulated in 100ms gating blocks
+        int done = 0;
+        while (done < blockSize)
+        {
+            int segment = juce::jmin(blockSize - done, samplesPerGatingBlock - gatingBlockFill);
+            processSegment(input[0] + done, input[1] + done, segment);
+            done += segment;
+            gatingBlockFill += segment;
+            if (gatingBlockFill >= samplesPerGatingBlock)
+                completeGatingBlock();
+        }
+    }
+}
+
+void LoudnessMeter::processSegment(const float* left, const float* right, int numSamples)
+{
+    const float* input[2] = {left, right};
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        rawEnergy[channel] += sumOfSquares(input[channel], numSamples);
+        shelfFilter[channel].process(input[channel], weightedScratch.data(), numSamples);
+        highPassFilter[channel].process(weightedScratch.data(), weightedScratch.data(), numSamples);
+        weightedEnergy[channel] += sumOfSquares(weightedScratch.data(), numSamples);
+    }
+}
+
+void LoudnessMeter::completeGatingBlock()
+{
+    // left and right are both weighted 1.0 by BS.1770
+    weightedHistory[historyWrite] = (weightedEnergy[0] + weightedEnergy[1]) / samplesPerGatingBlock;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        rawHistory[channel][historyWrite] = rawEnergy[channel] / samplesPerGatingBlock;
+        weightedEnergy[channel] = rawEnergy[channel] = 0;
+    }
+    historyWrite = (historyWrite + 1) % gatingBlocksShortTerm;
+    historyCount = juce::jmin(historyCount + 1, (int)gatingBlocksShortTerm);
+    gatingBlockFill = 0;
+
+    // average the most recent n blocks of the history
+    auto recentMean = [this] (const double* history, int blocks)
+    {
+        blocks = juce::jmin(blocks, historyCount);
+        double total = 0;
+        for (int i = 1; i <= blocks; ++i)
+            total += history[(historyWrite - i + gatingBlocksShortTerm) % gatingBlocksShortTerm];
+        return blocks > 0 ? total / blocks : 0.0;
+    };
+    const double momentaryEnergy = recentMean(weightedHistory, gatingBlocksMomentary);
+    momentaryLufs.store(energyToLufs(momentaryEnergy), std::memory_order_relaxed);
+    // every 100ms completes a 400ms momentary block, the 75% overlapping gating blocks of BS.1770
+    if (historyCount >= gatingBlocksMomentary && momentaryEnergy > 0)
+    {
+        const float lufs = (float)(-0.691 + 10.0 * std::log10(momentaryEnergy));
+        if (lufs > silenceLufs)
+        {
+            const int bin = juce::jmin(integratedBins - 1, (int)((lufs - silenceLufs) / integratedBinWidth));
+            integratedEnergy[bin] += momentaryEnergy;
+            ++integratedCount[bin];
+        }
+    }
+    shortTermLufs.store(energyToLufs(recentMean(weightedHistory, gatingBlocksShortTerm)), std::memory_order_relaxed);
+    for (int channel = 0; channel < 2; ++channel)
+        rmsLevel[channel].store((float)std::sqrt(recentMean(rawHistory[channel], gatingBlocksRms)), std::memory_order_relaxed);
+}
+
+float LoudnessMeter::measureTruePeak(int channel, const float* input, int numSamples)
+{
+    // history holds the last truePeakTaps - 1 input samples followed by this block
+    float* history = truePeakHistory[channel].data();
+    float* output = oversampledScratch.data();
+    std::memcpy(history + truePeakTaps - 1, input, numSamples * sizeof(float));
+    float truePeak = 0.0f;
+    for (int phase = 0; phase < oversampling; ++phase)
+    {
+        // y[n] = sum of h[k] * x[n - k], one vectorised pass per tap
+        juce::FloatVectorOperations::clear(output, numSamples);
+        for (int tap = 0; tap < truePeakTaps; ++tap)
+            juce::FloatVectorOperations::addWithMultiply(output, history + truePeakTaps - 1 - tap, truePeakCoefficients[phase][tap], numSamples);
+        truePeak = juce::jmax(truePeak, absoluteMax(output, numSamples));
+    }
+    std::memmove(history, history + numSamples, (truePeakTaps - 1) * sizeof(float));
+    return truePeak;
+}
+
+LoudnessMeter::Readings LoudnessMeter::getReadings()
+{
+    Readings readings;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        readings.peak[channel] = peakHold[channel].exchange(0.0f);
+        readings.truePeak[channel] = truePeakHold[channel].exchange(0.0f);
+        readings.rms[channel] = rmsLevel[channel].load(std::memory_order_relaxed);
+    }
+    readings.momentaryLufs = momentaryLufs.load(std::memory_order_relaxed);
+    readings.shortTermLufs = shortTermLufs.load(std::memory_order_relaxed);
+    return readings;
+}
+
+float LoudnessMeter::getIntegratedLufs() const
+{
+    // the absolute gate was applied as blocks were binned
+    double total = 0;
+    juce::uint64 count = 0;
+    for (int bin = 0; bin < integratedBins; ++bin)
+    {
+        total += integratedEnergy[bin];
+        count += integratedCount[bin];
+    }
+    if (count == 0)
+        return silenceLufs;
+    const float relativeGate = energyToLufs(total / (double)count) - 10.0f;
+    total = 0;
+    count = 0;
+    for (int bin = 0; bin < integratedBins; ++bin)
+    {
+        if (silenceLufs + (bin + 0.5f) * integratedBinWidth <= relativeGate)
+            continue;
+        total += integratedEnergy[bin];
+        count += integratedCount[bin];
+    }
+    return count > 0 ? energyToLufs(total / (double)count) : silenceLufs;
+}
+
+float LoudnessMeter::energyToLufs(double meanSquare)
+{
+    if (meanSquare <= 0)
+        return silenceLufs;
+    return juce::jmax((float)silenceLufs, (float)(-0.691 + 10.0 * std::log10(meanSquare)));
+}
+
+float LoudnessMeter::sumOfSquares(const float* data, int numSamples)
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+    float total = 0.0f;
+    int i = 0;
+    // scalar until the data is aligned for SIMD loads
+    const float* aligned = Vec::getNextSIMDAlignedPtr(const_cast<float*>(data));
+    int head = juce::jmin(numSamples, (int)(aligned - data));
+    for (; i < head; ++i)
+        total += data[i] * data[i];
+    Vec accumulator = Vec::expand(0.0f);
+    for (; i + (int)Vec::size() <= numSamples; i += (int)Vec::size())
+    {
+        Vec samples = Vec::fromRawArray(data + i);
+        accumulator += samples * samples;
+    }
+    total += accumulator.sum();
+    for (; i < numSamples; ++i)
+        total += data[i] * data[i];
+    return total;
+}
+
+float LoudnessMeter::absoluteMax(const float* data, int numSamples)
+{
+    if (numSamples <= 0)
+        return 0.0f;
+    juce::Range<float> range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+    return juce::jmax(-range.getStart(), range.getEnd());
+}
+
+void LoudnessMeter::publishMax(std::atomic<float>& hold, float value)
+{
+    float current = hold.load(std::memory_order_relaxed);
+    while (value > current && !hold.compare_exchange_weak(current, value))
+    {
+    }
+}
+
+void LoudnessMeter::Biquad::process(const float* input, float* output, int numSamples)
+{
+    // recursive, so this stage stays scalar
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double x = input[i];
+        double y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        output[i] = (float)y;
+    }
+}
@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    LoudnessMeter.h
+    Created: 19 Oct 2026 9:48:22am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+/*
+ Audio-side metering engine
+ Measures sample peak, 4x oversampled true-peak, RMS and EBU R128
+ momentary / short-term / integrated loudness on a stereo stream
+ Runs on the audio thread and publishes its readings through atomics,
+ and is also run over whole tracks by the analysis pipeline for their integrated loudness
+*/
+class LoudnessMeter
+{
+public:
+    LoudnessMeter();
+    ~LoudnessMeter();
+
+    /** readings as seen by the GUI, levels are linear gain, loudness is in LUFS */
+    struct Readings
+    {
+        float peak[2];
+        float truePeak[2];
+        float rms[2];
+        float momentaryLufs;
+        float shortTermLufs;
+    };
+    
+    /** loudness reported for silence */
+    static constexpr float silenceLufs = -70.0f;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     LoudnessMeter::prepareToPlay()
+     Input                  int, double
+     Output                 none
+     @param maxBlockSize    largest block the meter will be asked to process in one go
+     @param sampleRate      sample rate of the metered stream
+     Calculates the K-weighting filters for the sample rate and allocates working buffers
+     Must be called before process(), never from the audio thread
+     */
+    void prepareToPlay(int maxBlockSize, double sampleRate);
+    
+    /**
+     LoudnessMeter::process()
+     Input                  juce::AudioBuffer, int, int
+     Output                 none
+     @param buffer          buffer to meter, a mono buffer is metered as both channels
+     @param startSample     first sample to meter
+     @param numSamples      number of samples to meter
+     Called from the audio thread. Never allocates or locks
+     */
+    void process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    
+    /**
+     LoudnessMeter::getReadings()
+     Input                  none
+     Output                 LoudnessMeter::Readings
+     Returns the latest readings. Peaks are the maximum since the last call,
+     and are reset by it so no peak is ever missed between GUI frames
+     */
+    Readings getReadings();
+    
+    /**
+     LoudnessMeter::reset()
+     Input                  none
+     Output                 none
+     Clears filter states, loudness history and the published readings, call from prepareToPlay or when stopped
+     Not thread safe against process(), so call it from the audio thread once audio is running
+     */
+    void reset();
+    
+    /**
+     LoudnessMeter::getIntegratedLufs()
+     Input                  none
+     Output                 float
+     Returns the EBU R128 integrated loudness of everything metered since the last reset(),
+     gated at -70 LUFS and then at 10 LU below that. Call from the thread that calls process()
+     */
+    float getIntegratedLufs() const;
+    
+    /** LoudnessMeter::energyToLufs() converts a mean square energy to LUFS */
+    static float energyToLufs(double meanSquare);
+
+private:
+    /** direct form II transposed biquad, used for the two K-weighting stages */
+    struct Biquad
+    {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        double z1 = 0, z2 = 0;
+        void process(const float* input, float* output, int numSamples);
+    };
+    
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     LoudnessMeter::processSegment()
+     Input                  const float* channel pointers, int
+     Output                 none
+     Accumulates K-weighted and unweighted energy for a run of samples
+     that doesn't cross a 100ms gating block boundary
+     */
+    void processSegment(const float* left, const float* right, int numSamples);
+    
+    /**
+     LoudnessMeter::completeGatingBlock()
+     Input                  none
+     Output                 none
+     Pushes the finished 100ms block into the history and publishes RMS and loudness
+     */
+    void completeGatingBlock();
+    
+    /**
+     LoudnessMeter::measureTruePeak()
+     Input                  int channel, const float*, int
+     Output                 float absolute true-peak of the block
+     Upsamples 4x with the ITU-R BS.1770 polyphase filter and returns the largest magnitude
+     */
+    float measureTruePeak(int channel, const float* input, int numSamples);
+    
+    /**
+     LoudnessMeter::sumOfSquares()
+     Input                  const float*, int
+     Output                 float
+     SIMD sum of squares of a run of samples
+     */
+    static float sumOfSquares(const float* data, int numSamples);
+    
+    /**
+     LoudnessMeter::absoluteMax()
+     Input                  const float*, int
+     Output                 float
+     SIMD search for the largest magnitude in a run of samples
+     */
+    static float absoluteMax(const float* data, int numSamples);
+    
+    /**
+     LoudnessMeter::publishMax()
+     Input                  std::atomic<float>&, float
+     Output                 none
+     Raises an atomic peak hold to value if value is larger
+     */
+    static void publishMax(std::atomic<float>& hold, float value);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** number of taps in each phase of the true-peak interpolator */
+    static constexpr int truePeakTaps = 12;
+    static constexpr int oversampling = 4;
+    /** history length for loudness, 30 x 100ms = 3s short-term window */
+    static constexpr int gatingBlocksShortTerm = 30;
+    static constexpr int gatingBlocksMomentary = 4;
+    static constexpr int gatingBlocksRms = 3;
+    
+    /** the integrated loudness histogram covers 80 LU above silenceLufs in 0.1 LU bins */
+    static constexpr int integratedBins = 800;
+    static constexpr float integratedBinWidth = 0.1f;
+    
+    /** polyphase coefficients from ITU-R BS.1770-4 annex 2 */
+    static const float truePeakCoefficients[oversampling][truePeakTaps];
+    
+    /** K-weighting filters for each channel */
+    Biquad shelfFilter[2], highPassFilter[2];
+    /** samples per 100ms gating block */
+    int samplesPerGatingBlock = 4410;
+    /** samples accumulated into the current gating block */
+    int gatingBlockFill = 0;
+    /** energy accumulated into the current gating block */
+    double weightedEnergy[2] = {0, 0}, rawEnergy[2] = {0, 0};
+    /** ring buffers of completed gating blocks */
+    double weightedHistory[gatingBlocksShortTerm] = {};
+    double rawHistory[2][gatingBlocksShortTerm] = {};
+    int historyWrite = 0, historyCount = 0;
+    /** energy and number of the momentary blocks in each loudness bin, fixed size so integrating never allocates */
+    double integratedEnergy[integratedBins] = {};
+    juce::uint32 integratedCount[integratedBins] = {};
+    /** largest block processed in one go, set in prepareToPlay */
+    int maxBlockSize = 0;
+    /** working buffers, allocated in prepareToPlay */
+    std::vector<float> weightedScratch, oversampledScratch;
+    /** per channel input history for the true-peak interpolator, truePeakTaps - 1 samples plus a block */
+    std::vector<float> truePeakHistory[2];
+    
+    // published readings
+    std::atomic<float> peakHold[2], truePeakHold[2], rmsLevel[2];
+    std::atomic<float> momentaryLufs{silenceLufs}, shortTermLufs{silenceLufs};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessMeter)
+};
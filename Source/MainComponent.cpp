@@ -38,6 +38,12 @@ MainComponent::MainComponent()
                                controllerIndicator,
                                infoTextColour,
                                warningTextColour);
+    for (AnalyserView* analyser : {&deck1Analyser, &masterAnalyser, &deck2Analyser})
+        analyser->setColourPalette(controllerBackground,
+                                   controllerBody,
+                                   controllerIndicator,
+                                   infoTextColour,
+                                   warningTextColour);
 
     // initialise main component and child component variables
     setSize (900, 600);
@@ -61,17 +67,29 @@ MainComponent::MainComponent()
     addAndMakeVisible(playlistComponent);
     addAndMakeVisible(outputLevelL);
     addAndMakeVisible(outputLevelR);
+    
+    // analysers start hidden so they cost nothing until they're opened
+    deck1Analyser.setName("player 1");
+    masterAnalyser.setName("master");
+    deck2Analyser.setName("player 2");
+    addChildComponent(deck1Analyser);
+    addChildComponent(masterAnalyser);
+    addChildComponent(deck2Analyser);
+    addAndMakeVisible(analyserToggle);
+    analyserToggle.setClickingTogglesState(true);
+    analyserToggle.onClick = [this] { showAnalysers(analyserToggle.getToggleState()); };
 
     formatManager.registerBasicFormats();
     
-    startTimer(50);
+    frameScheduler.addClient(this);
 }
 
 MainComponent::~MainComponent()
 {
     // This shuts down the audio device and clears the audio source.
     shutdownAudio();
-    stopTimer();
+    showAnalysers(false);
+    frameScheduler.removeClient(this);
     delete deckGUI1;
     delete deckGUI2;
     setLookAndFeel(nullptr);
@@ -81,6 +99,8 @@ MainComponent::~MainComponent()
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
     mixerSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    masterTap.setSampleRate(sampleRate);
+    masterMeter.prepareToPlay(samplesPerBlockExpected, sampleRate);
     mixerSource.addInputSource(&player1, false);
     mixerSource.addInputSource(&player2, false);
  }
@@ -88,13 +108,9 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
 void MainComponent::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill)
 {
     mixerSource.getNextAudioBlock(bufferToFill);
-    // store peak levels for current buffer if larger than stored peak
-    float currLPeak = bufferToFill.buffer->getMagnitude(0, 0, bufferToFill.numSamples);
-    float currRPeak = bufferToFill.buffer->getMagnitude(1, 0, bufferToFill.numSamples);
-    if (currLPeak > leftPeak)
-        leftPeak = currLPeak;
-    if (currRPeak > rightPeak)
-        rightPeak = currRPeak;
+    // meter the master output
+    masterMeter.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+    masterTap.push(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
 }
 
 void MainComponent::releaseResources()
@@ -114,26 +130,49 @@ void MainComponent::paint (Graphics& g)
 void MainComponent::resized()
 {
     playlistComponent.setBounds(drawGutter, drawGutter + 30, getWidth() - drawGutter * 2, getHeight() - 30 - drawGutter * 2);
-    outputLevelL.setBounds(drawGutter, drawGutter + 2, getWidth() - (drawGutter * 2), 10);
-    outputLevelR.setBounds(drawGutter, drawGutter + 13, getWidth() - (drawGutter * 2), 10);
+    int toggleWidth = 80;
+    outputLevelL.setBounds(drawGutter, drawGutter + 2, getWidth() - (drawGutter * 3) - toggleWidth, 10);
+    outputLevelR.setBounds(drawGutter, drawGutter + 13, getWidth() - (drawGutter * 3) - toggleWidth, 10);
+    analyserToggle.setBounds(getWidth() - drawGutter - toggleWidth, drawGutter + 2, toggleWidth, 21);
+    // analysers sit over the top of the playlist table while open
+    int analyserW = (getWidth() - drawGutter * 4) / 3;
+    int analyserH = juce::jmin(analyserW / 2, playlistComponent.getHeight() / 3);
+    int analyserY = playlistComponent.getY() + playlistComponent.getHeight() / 16;
+    deck1Analyser.setBounds(drawGutter, analyserY, analyserW, analyserH);
+    masterAnalyser.setBounds(drawGutter * 2 + analyserW, analyserY, analyserW, analyserH);
+    deck2Analyser.setBounds(drawGutter * 3 + analyserW * 2, analyserY, analyserW, analyserH);
+}
+
+void MainComponent::showAnalysers(bool shouldShow)
+{
+    deck1Analyser.setVisible(shouldShow);
+    masterAnalyser.setVisible(shouldShow);
+    deck2Analyser.setVisible(shouldShow);
 }
 
-// timer called every 50ms
-void MainComponent::timerCallback()
+// called once per frame while anything is animating
+bool MainComponent::frameCallback(double frameTimeMs)
 {
     // updates the meter output
     if (playlistComponent.isPlaying())
     {
-        outputLevelL.displayLevel(leftPeak);
-        outputLevelR.displayLevel(rightPeak);
-        leftPeak = 0;
-        rightPeak = 0;
+        LoudnessMeter::Readings readings = masterMeter.getReadings();
+        outputLevelL.displayLevels(readings.rms[0], readings.truePeak[0]);
+        outputLevelR.displayLevels(readings.rms[1], readings.truePeak[1]);
+        masterTruePeakMax = juce::jmax(masterTruePeakMax, readings.truePeak[0], readings.truePeak[1]);
+        outputLevelL.setReadout("M " + juce::String(readings.momentaryLufs, 1)
+                                + "  S " + juce::String(readings.shortTermLufs, 1) + " LUFS");
+        outputLevelR.setReadout("TP " + juce::String(juce::Decibels::gainToDecibels(masterTruePeakMax, -70.0f), 1) + " dBTP");
     }
     else
     {
         // feed zeroes to meters so they can fade back to nothing
-        outputLevelL.displayLevel(0);
-        outputLevelR.displayLevel(0);
+        outputLevelL.displayLevels(0, 0);
+        outputLevelR.displayLevels(0, 0);
+        outputLevelL.setReadout("");
+        outputLevelR.setReadout("");
+        masterTruePeakMax = 0;
     }
+    return playlistComponent.isPlaying() || outputLevelL.isActive() || outputLevelR.isActive();
 }
 
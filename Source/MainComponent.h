@@ -14,6 +14,11 @@
 #include "PlaylistComponent.h"
 #include "LevelMeter.h"
 #include "OtoDecksLookAndFeel.h"
+#include "FrameScheduler.h"
+#include "AudioTap.h"
+#include "AnalyserView.h"
+#include "LoudnessMeter.h"
+#include "ThumbnailDiskCache.h"
 
 //==============================================================================
 /*
@@ -21,7 +26,7 @@
     your controls and content.
 */
 class MainComponent   : public juce::AudioAppComponent,
-                        public juce::Timer
+                        public FrameScheduler::Client
 {
 public:
     //==============================================================================
@@ -39,15 +44,16 @@ public:
     void paint (Graphics& g) override;
     void resized() override;
     
-    // implement Timer pure virtual functions */
+    // implement FrameScheduler::Client pure virtual functions */
     /**
-     MainComponent::timerCallback()
-     Input                  none
-     Output                 none
-     Retrieves peak values from MainComponent::leftPeak / rightPeak
+     MainComponent::frameCallback()
+     Input                  double frame time in ms
+     Output                 bool
+     Retrieves RMS, true-peak and loudness readings from MainComponent::masterMeter
      and updates output meters accordingly
+     Returns true while audio is playing or the meters are still falling back
      */
-    void timerCallback() override;
+    bool frameCallback(double frameTimeMs) override;
 
     
 private:
@@ -59,21 +65,25 @@ private:
     juce::Colour controllerBackground, controllerBody, controllerIndicator, infoTextColour, warningTextColour;
     /** stores and manages the available audio formats */
     juce::AudioFormatManager formatManager;
-    /** stores the thumbnail for waveform display */
-    juce::AudioThumbnailCache thumbcache{100};
+    /** folder of waveform thumbnails, read by thumbcache and written by PlaylistComponent's analysis */
+    const juce::File thumbnailFolder{juce::File::getCurrentWorkingDirectory().getChildFile("thumbnails")};
+    /** stores the thumbnail for waveform display, including those drawn by PlaylistComponent's analysis */
+    ThumbnailDiskCache thumbcache{100, thumbnailFolder};
+    /** single frame tick that drives every GUI refresh */
+    FrameScheduler frameScheduler{*this};
 
     // instantiate two players and their respective GUIs */
     DJAudioPlayer player1{formatManager};
-    DeckGUI* deckGUI1 = new DeckGUI{&player1, formatManager, thumbcache, 0};
+    DeckGUI* deckGUI1 = new DeckGUI{&player1, formatManager, thumbcache, frameScheduler, 0};
 
     DJAudioPlayer player2{formatManager};
-    DeckGUI* deckGUI2 = new DeckGUI{&player2, formatManager, thumbcache, 1};
+    DeckGUI* deckGUI2 = new DeckGUI{&player2, formatManager, thumbcache, frameScheduler, 1};
     
     /** mixersource for audio output */
     juce::MixerAudioSource mixerSource;
     
     /** playlist component */
-    PlaylistComponent playlistComponent{formatManager, player1, deckGUI1, player2, deckGUI2};
+    PlaylistComponent playlistComponent{formatManager, frameScheduler, thumbnailFolder, player1, deckGUI1, player2, deckGUI2};
     
     /** padding around edge of app window */
     int drawGutter = 20;
@@ -82,10 +92,27 @@ private:
     LevelMeter outputLevelL{255, false};
     LevelMeter outputLevelR{255, false};
     
-    /** local variable storing peak value of buffer */
-    float leftPeak = 0;
-    /** local variable storing peak value of buffer */
-    float rightPeak = 0;
+    /** tap on the master output for the master analyser view */
+    AudioTap masterTap;
+    /** spectrum / goniometer views for each deck and the master output, hidden until toggled */
+    AnalyserView deck1Analyser{player1.analyserTap, frameScheduler};
+    AnalyserView masterAnalyser{masterTap, frameScheduler};
+    AnalyserView deck2Analyser{player2.analyserTap, frameScheduler};
+    /** shows / hides the analyser views */
+    juce::TextButton analyserToggle{"analyser"};
+    
+    /**
+     MainComponent::showAnalysers()
+     Input                  bool
+     Output                 none
+     Shows or hides the analyser views, which starts or stops their analysis
+     */
+    void showAnalysers(bool shouldShow);
+    
+    /** meters the master output on the audio thread */
+    LoudnessMeter masterMeter;
+    /** highest master true-peak since playback started */
+    float masterTruePeakMax = 0;
 
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
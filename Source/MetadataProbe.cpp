@@ -0,0 +1,578 @@
+/*
+  ==============================================================================
+
+    MetadataProbe.cpp
+    Created: 30 Oct 2026 10:27:15am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "MetadataProbe.h"
+#include <cstring>
+#include <cmath>
+
+constexpr int MetadataProbe::mpegSearchBytes;
+constexpr int MetadataProbe::oggTailBytes;
+constexpr int MetadataProbe::oggHeadBytes;
+constexpr int MetadataProbe::maxTextBytes;
+
+namespace
+{
+    juce::uint32 readBigEndian32(const juce::uint8* p)
+    {
+        return ((juce::uint32)p[0] << 24) | ((juce::uint32)p[1] << 16) | ((juce::uint32)p[2] << 8) | (juce::uint32)p[3];
+    }
+
+    juce::uint32 readLittleEndian32(const juce::uint8* p)
+    {
+        return ((juce::uint32)p[3] << 24) | ((juce::uint32)p[2] << 16) | ((juce::uint32)p[1] << 8) | (juce::uint32)p[0];
+    }
+
+    /** ID3v2.4 sizes keep the top bit of each byte clear */
+    juce::uint32 readSyncSafe32(const juce::uint8* p)
+    {
+        return ((juce::uint32)(p[0] & 0x7f) << 21) | ((juce::uint32)(p[1] & 0x7f) << 14) | ((juce::uint32)(p[2] & 0x7f) << 7) | (juce::uint32)(p[3] & 0x7f);
+    }
+
+    bool hasId(const std::vector<juce::uint8>& data, size_t offset, const char* id)
+    {
+        size_t length = std::strlen(id);
+        return offset + length <= data.size() && std::memcmp(data.data() + offset, id, length) == 0;
+    }
+
+    void appendUTF8(std::string& text, juce::uint32 codePoint)
+    {
+        if (codePoint < 0x80)
+            text += (char)codePoint;
+        else if (codePoint < 0x800)
+        {
+            text += (char)(0xc0 | (codePoint >> 6));
+            text += (char)(0x80 | (codePoint & 0x3f));
+        }
+        else if (codePoint < 0x10000)
+        {
+            text += (char)(0xe0 | (codePoint >> 12));
+            text += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+            text += (char)(0x80 | (codePoint & 0x3f));
+        }
+        else
+        {
+            text += (char)(0xf0 | (codePoint >> 18));
+            text += (char)(0x80 | ((codePoint >> 12) & 0x3f));
+            text += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+            text += (char)(0x80 | (codePoint & 0x3f));
+        }
+    }
+
+    /** one MPEG audio frame header */
+    struct MpegFrame
+    {
+        int     version = 0;            // 1, 2, or 25 for MPEG 2.5
+        int     layer = 0;
+        int     bitrate = 0;            // in bits per second
+        int     sampleRate = 0;
+        int     samplesPerFrame = 0;
+        int     frameBytes = 0;
+        bool    mono = false;
+    };
+
+    bool parseMpegFrame(const juce::uint8* p, MpegFrame& frame)
+    {
+        static const int bitrates[5][16] =
+        {
+            { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },    // MPEG 1 layer I
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },       // MPEG 1 layer II
+            { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },        // MPEG 1 layer III
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },       // MPEG 2 / 2.5 layer I
+            { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }             // MPEG 2 / 2.5 layers II and III
+        };
+        static const int sampleRates[3] = { 44100, 48000, 32000 };
+        if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+            return false;
+        int versionBits = (p[1] >> 3) & 3, layerBits = (p[1] >> 1) & 3;
+        int bitrateIndex = p[2] >> 4, sampleRateIndex = (p[2] >> 2) & 3;
+        if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+            return false;
+        frame.version = versionBits == 3 ? 1 : (versionBits == 2 ? 2 : 25);
+        frame.layer = 4 - layerBits;
+        int table = frame.version == 1 ? frame.layer - 1 : (frame.layer == 1 ? 3 : 4);
+        frame.bitrate = bitrates[table][bitrateIndex] * 1000;
+        frame.sampleRate = sampleRates[sampleRateIndex] / (frame.version == 1 ? 1 : (frame.version == 2 ? 2 : 4));
+        frame.mono = (p[3] >> 6) == 3;
+        int padding = (p[2] >> 1) & 1;
+        if (frame.layer == 1)
+        {
+            frame.samplesPerFrame = 384;
+            frame.frameBytes = (12 * frame.bitrate / frame.sampleRate + padding) * 4;
+        }
+        else
+        {
+            frame.samplesPerFrame = (frame.layer == 3 && frame.version != 1) ? 576 : 1152;
+            frame.frameBytes = frame.samplesPerFrame / 8 * frame.bitrate / frame.sampleRate + padding;
+        }
+        return frame.frameBytes > 4;
+    }
+}
+
+/* ========================= */
+/* ====== dispatching ====== */
+/* ========================= */
+
+bool MetadataProbe::probe(const juce::File& file, Metadata& metadata)
+{
+    juce::FileInputStream stream(file);
+    if (stream.failedToOpen())
+        return false;
+    std::vector<juce::uint8> start = readAt(stream, 0, 12);
+    bool found = false;
+    if (hasId(start, 0, "fLaC"))
+        found = probeFlac(stream, 0, metadata);
+    else if (hasId(start, 0, "OggS"))
+        found = probeOgg(stream, metadata);
+    else if (hasId(start, 0, "RIFF") && hasId(start, 8, "WAVE"))
+        found = probeRiff(stream, metadata);
+    else if (hasId(start, 0, "FORM") && (hasId(start, 8, "AIFF") || hasId(start, 8, "AIFC")))
+        found = probeAiff(stream, metadata);
+    else if (hasId(start, 0, "ID3") || (start.size() >= 2 && start[0] == 0xff && (start[1] & 0xe0) == 0xe0))
+        found = probeMpeg(stream, metadata);
+    metadata.title = clean(metadata.title);
+    metadata.artist = clean(metadata.artist);
+    metadata.album = clean(metadata.album);
+    return found && metadata.length > 0 && metadata.sampleRate > 0;
+}
+
+std::vector<juce::uint8> MetadataProbe::readAt(juce::InputStream& stream, juce::int64 position, int numBytes)
+{
+    std::vector<juce::uint8> data;
+    if (position < 0 || numBytes <= 0 || !stream.setPosition(position))
+        return data;
+    data.resize((size_t)numBytes);
+    int numRead = stream.read(data.data(), numBytes);
+    data.resize((size_t)juce::jmax(0, numRead));
+    return data;
+}
+
+/* ================= */
+/* ====== MP3 ====== */
+/* ================= */
+
+bool MetadataProbe::probeMpeg(juce::InputStream& stream, Metadata& metadata)
+{
+    juce::int64 audioStart = readID3v2(stream, metadata);
+    juce::int64 fileSize = stream.getTotalLength();
+    // a FLAC file can carry an ID3v2 tag in front of it too
+    if (hasId(readAt(stream, audioStart, 4), 0, "fLaC"))
+        return probeFlac(stream, audioStart, metadata);
+
+    // the first frame header whose successor, if it is in reach, is also a header
+    std::vector<juce::uint8> data = readAt(stream, audioStart, mpegSearchBytes);
+    MpegFrame frame;
+    size_t frameStart = 0;
+    bool found = false;
+    for (; frameStart + 4 <= data.size() && !found; ++frameStart)
+    {
+        if (!parseMpegFrame(data.data() + frameStart, frame))
+            continue;
+        MpegFrame next;
+        size_t nextStart = frameStart + (size_t)frame.frameBytes;
+        found = nextStart + 4 > data.size() || parseMpegFrame(data.data() + nextStart, next);
+    }
+    if (!found)
+        return false;
+    --frameStart;
+    metadata.sampleRate = frame.sampleRate;
+    metadata.numChannels = frame.mono ? 1 : 2;
+
+    // a Xing or Info header follows the side information of the first frame, VBRI sits at a fixed offset
+    size_t sideInfoBytes = frame.version == 1 ? (frame.mono ? 17 : 32) : (frame.mono ? 9 : 17);
+    size_t xing = frameStart + 4 + sideInfoBytes;
+    size_t vbri = frameStart + 36;
+    if (hasId(data, xing, "Xing") || hasId(data, xing, "Info"))
+    {
+        if (xing + 8 > data.size())
+            return false;
+        juce::uint32 flags = readBigEndian32(data.data() + xing + 4);
+        size_t field = xing + 8;
+        juce::uint32 numFrames = 0;
+        if ((flags & 1) != 0 && field + 4 <= data.size())
+            numFrames = readBigEndian32(data.data() + field);
+        field += (flags & 1) != 0 ? 4 : 0;
+        field += (flags & 2) != 0 ? 4 : 0;
+        field += (flags & 4) != 0 ? 100 : 0;
+        field += (flags & 8) != 0 ? 4 : 0;
+        if (numFrames > 0)
+        {
+            double numSamples = (double)numFrames * frame.samplesPerFrame;
+            // the LAME extension records the encoder delay and padding, in 12 bits each
+            if ((hasId(data, field, "LAME") || hasId(data, field, "Lavf") || hasId(data, field, "Lavc")) && field + 24 <= data.size())
+            {
+                const juce::uint8* gap = data.data() + field + 21;
+                int delay = (gap[0] << 4) | (gap[1] >> 4);
+                int padding = ((gap[1] & 0x0f) << 8) | gap[2];
+                numSamples = juce::jmax(0.0, numSamples - delay - padding);
+            }
+            metadata.length = numSamples / frame.sampleRate;
+            return true;
+        }
+    }
+    else if (hasId(data, vbri, "VBRI") && vbri + 18 <= data.size())
+    {
+        juce::uint32 numFrames = readBigEndian32(data.data() + vbri + 14);
+        if (numFrames > 0)
+        {
+            metadata.length = (double)numFrames * frame.samplesPerFrame / frame.sampleRate;
+            return true;
+        }
+    }
+
+    // no frame count, so assume a constant bitrate, leaving out an ID3v1 tag at the end
+    juce::int64 audioEnd = fileSize;
+    if (fileSize >= 128 && hasId(readAt(stream, fileSize - 128, 3), 0, "TAG"))
+        audioEnd -= 128;
+    juce::int64 audioBytes = audioEnd - (audioStart + (juce::int64)frameStart);
+    metadata.length = audioBytes > 0 ? (double)audioBytes * 8.0 / frame.bitrate : 0;
+    return true;
+}
+
+juce::int64 MetadataProbe::readID3v2(juce::InputStream& stream, Metadata& metadata)
+{
+    std::vector<juce::uint8> header = readAt(stream, 0, 10);
+    if (!hasId(header, 0, "ID3") || header.size() < 10)
+        return 0;
+    int majorVersion = header[3];
+    juce::uint8 flags = header[5];
+    juce::int64 tagSize = 10 + (juce::int64)readSyncSafe32(header.data() + 6) + ((flags & 0x10) != 0 ? 10 : 0);
+    if (majorVersion < 2 || majorVersion > 4)
+        return tagSize;
+    juce::int64 position = 10;
+    juce::int64 framesEnd = 10 + (juce::int64)readSyncSafe32(header.data() + 6);
+    if ((flags & 0x40) != 0 && majorVersion >= 3)
+    {
+        // skip the extended header, whose size counts itself in v2.4 but not in v2.3
+        std::vector<juce::uint8> extended = readAt(stream, position, 4);
+        if (extended.size() < 4)
+            return tagSize;
+        position += majorVersion == 4 ? readSyncSafe32(extended.data()) : readBigEndian32(extended.data()) + 4;
+    }
+    const int idBytes = majorVersion == 2 ? 3 : 4;
+    const int headerBytes = majorVersion == 2 ? 6 : 10;
+    while (position + headerBytes <= framesEnd)
+    {
+        std::vector<juce::uint8> frameHeader = readAt(stream, position, headerBytes);
+        if ((int)frameHeader.size() < headerBytes || frameHeader[0] == 0)
+            break;      // padding
+        juce::uint32 frameBytes;
+        if (majorVersion == 2)
+            frameBytes = ((juce::uint32)frameHeader[3] << 16) | ((juce::uint32)frameHeader[4] << 8) | frameHeader[5];
+        else if (majorVersion == 3)
+            frameBytes = readBigEndian32(frameHeader.data() + 4);
+        else
+            frameBytes = readSyncSafe32(frameHeader.data() + 4);
+        std::string id(frameHeader.begin(), frameHeader.begin() + idBytes);
+        std::string* field = nullptr;
+        if (id == "TIT2" || id == "TT2")
+            field = &metadata.title;
+        else if (id == "TPE1" || id == "TP1")
+            field = &metadata.artist;
+        else if (id == "TALB" || id == "TAL")
+            field = &metadata.album;
+        // frames that are compressed or encrypted are left alone
+        bool plain = majorVersion < 3 || (frameHeader[9] & (majorVersion == 3 ? 0xc0 : 0x0c)) == 0;
+        if (field != nullptr && plain && frameBytes > 1 && frameBytes <= (juce::uint32)maxTextBytes)
+        {
+            std::vector<juce::uint8> text = readAt(stream, position + headerBytes, (int)frameBytes);
+            *field = decodeID3Text(text.data(), text.size());
+        }
+        position += headerBytes + (juce::int64)frameBytes;
+    }
+    return tagSize;
+}
+
+std::string MetadataProbe::decodeID3Text(const juce::uint8* data, size_t numBytes)
+{
+    std::string text;
+    if (numBytes < 1)
+        return text;
+    int encoding = data[0];
+    const juce::uint8* p = data + 1;
+    const juce::uint8* end = data + numBytes;
+    if (encoding == 1 || encoding == 2)
+    {
+        // UTF-16, with a byte order mark for encoding 1 and big endian for encoding 2
+        bool bigEndian = encoding == 2;
+        if (encoding == 1 && end - p >= 2)
+        {
+            bigEndian = p[0] == 0xfe && p[1] == 0xff;
+            if ((p[0] == 0xfe && p[1] == 0xff) || (p[0] == 0xff && p[1] == 0xfe))
+                p += 2;
+        }
+        while (end - p >= 2)
+        {
+            juce::uint32 unit = bigEndian ? ((juce::uint32)p[0] << 8 | p[1]) : ((juce::uint32)p[1] << 8 | p[0]);
+            p += 2;
+            if (unit == 0)
+                break;
+            if (unit >= 0xd800 && unit < 0xdc00 && end - p >= 2)
+            {
+                juce::uint32 low = bigEndian ? ((juce::uint32)p[0] << 8 | p[1]) : ((juce::uint32)p[1] << 8 | p[0]);
+                if (low >= 0xdc00 && low < 0xe000)
+                {
+                    p += 2;
+                    unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                }
+            }
+            appendUTF8(text, unit);
+        }
+    }
+    else
+    {
+        // ISO-8859-1 for encoding 0, UTF-8 for encoding 3. Values after a null are ignored
+        for (; p < end && *p != 0; ++p)
+        {
+            if (encoding == 3)
+                text += (char)*p;
+            else
+                appendUTF8(text, *p);
+        }
+    }
+    return text;
+}
+
+/* ================================= */
+/* ====== FLAC and Ogg Vorbis ====== */
+/* ================================= */
+
+bool MetadataProbe::probeFlac(juce::InputStream& stream, juce::int64 start, Metadata& metadata)
+{
+    juce::int64 position = start + 4;
+    bool foundStreamInfo = false;
+    for (bool lastBlock = false; !lastBlock; )
+    {
+        std::vector<juce::uint8> blockHeader = readAt(stream, position, 4);
+        if (blockHeader.size() < 4)
+            break;
+        lastBlock = (blockHeader[0] & 0x80) != 0;
+        int type = blockHeader[0] & 0x7f;
+        juce::uint32 blockBytes = ((juce::uint32)blockHeader[1] << 16) | ((juce::uint32)blockHeader[2] << 8) | blockHeader[3];
+        position += 4;
+        if (type == 0 && blockBytes >= 18)
+        {
+            std::vector<juce::uint8> info = readAt(stream, position, 18);
+            if (info.size() < 18)
+                break;
+            // 20 bits of sample rate, 3 of channels - 1, 5 of bits per sample - 1, 36 of total samples
+            juce::uint32 sampleRate = ((juce::uint32)info[10] << 12) | ((juce::uint32)info[11] << 4) | (info[12] >> 4);
+            juce::uint64 totalSamples = ((juce::uint64)(info[13] & 0x0f) << 32) | readBigEndian32(info.data() + 14);
+            metadata.sampleRate = sampleRate;
+            metadata.numChannels = ((info[12] >> 1) & 7) + 1;
+            if (sampleRate > 0)
+                metadata.length = (double)totalSamples / sampleRate;
+            foundStreamInfo = true;
+        }
+        else if (type == 4 && blockBytes <= (juce::uint32)maxTextBytes)
+        {
+            std::vector<juce::uint8> comments = readAt(stream, position, (int)blockBytes);
+            readVorbisComments(comments.data(), comments.size(), metadata);
+        }
+        position += blockBytes;
+    }
+    return foundStreamInfo;
+}
+
+bool MetadataProbe::probeOgg(juce::InputStream& stream, Metadata& metadata)
+{
+    // join the bodies of the first pages, which hold the identification and comment headers
+    std::vector<juce::uint8> head = readAt(stream, 0, oggHeadBytes);
+    std::vector<juce::uint8> packets;
+    for (size_t page = 0; page + 27 <= head.size() && hasId(head, page, "OggS"); )
+    {
+        size_t numSegments = head[page + 26];
+        if (page + 27 + numSegments > head.size())
+            break;
+        size_t bodyBytes = 0;
+        for (size_t segment = 0; segment < numSegments; ++segment)
+            bodyBytes += head[page + 27 + segment];
+        size_t body = page + 27 + numSegments;
+        size_t available = juce::jmin(bodyBytes, head.size() - body);
+        packets.insert(packets.end(), head.begin() + (long)body, head.begin() + (long)(body + available));
+        page = body + bodyBytes;
+    }
+    if (packets.size() < 30 || packets[0] != 1 || !hasId(packets, 1, "vorbis"))
+        return false;
+    metadata.numChannels = packets[11];
+    metadata.sampleRate = readLittleEndian32(packets.data() + 12);
+    for (size_t i = 30; i + 7 <= packets.size(); ++i)
+    {
+        if (packets[i] == 3 && hasId(packets, i + 1, "vorbis"))
+        {
+            readVorbisComments(packets.data() + i + 7, packets.size() - i - 7, metadata);
+            break;
+        }
+    }
+
+    // the granule position of the last page is the number of samples in the stream
+    juce::int64 fileSize = stream.getTotalLength();
+    juce::int64 tailStart = juce::jmax((juce::int64)0, fileSize - oggTailBytes);
+    std::vector<juce::uint8> tail = readAt(stream, tailStart, (int)(fileSize - tailStart));
+    for (size_t page = tail.size() >= 14 ? tail.size() - 14 : 0; page-- > 0; )
+    {
+        if (!hasId(tail, page, "OggS"))
+            continue;
+        juce::uint64 granule = (juce::uint64)readLittleEndian32(tail.data() + page + 6)
+                             | ((juce::uint64)readLittleEndian32(tail.data() + page + 10) << 32);
+        if (metadata.sampleRate > 0 && granule != ~(juce::uint64)0)
+            metadata.length = (double)granule / metadata.sampleRate;
+        break;
+    }
+    return true;
+}
+
+void MetadataProbe::readVorbisComments(const juce::uint8* data, size_t numBytes, Metadata& metadata)
+{
+    // little endian lengths: the vendor string, the number of comments, then each KEY=value comment
+    if (numBytes < 8)
+        return;
+    size_t position = 4 + (size_t)readLittleEndian32(data);
+    if (position + 4 > numBytes)
+        return;
+    juce::uint32 numComments = readLittleEndian32(data + position);
+    position += 4;
+    for (juce::uint32 i = 0; i < numComments && position + 4 <= numBytes; ++i)
+    {
+        size_t commentBytes = readLittleEndian32(data + position);
+        position += 4;
+        if (commentBytes > numBytes - position)
+            break;
+        std::string comment(reinterpret_cast<const char*>(data + position), commentBytes);
+        position += commentBytes;
+        size_t equals = comment.find('=');
+        if (equals == std::string::npos)
+            continue;
+        juce::String key = juce::String(comment.substr(0, equals)).toUpperCase();
+        // the first of a repeated field wins
+        if (key == "TITLE" && metadata.title.empty())
+            metadata.title = comment.substr(equals + 1);
+        else if (key == "ARTIST" && metadata.artist.empty())
+            metadata.artist = comment.substr(equals + 1);
+        else if (key == "ALBUM" && metadata.album.empty())
+            metadata.album = comment.substr(equals + 1);
+    }
+}
+
+/* ========================== */
+/* ====== WAV and AIFF ====== */
+/* ========================== */
+
+bool MetadataProbe::probeRiff(juce::InputStream& stream, Metadata& metadata)
+{
+    juce::int64 fileSize = stream.getTotalLength();
+    juce::uint32 byteRate = 0;
+    juce::int64 dataBytes = -1;
+    for (juce::int64 position = 12; position + 8 <= fileSize; )
+    {
+        std::vector<juce::uint8> chunkHeader = readAt(stream, position, 8);
+        if (chunkHeader.size() < 8)
+            break;
+        juce::uint32 chunkBytes = readLittleEndian32(chunkHeader.data() + 4);
+        juce::int64 body = position + 8;
+        if (hasId(chunkHeader, 0, "fmt ") && chunkBytes >= 16)
+        {
+            std::vector<juce::uint8> format = readAt(stream, body, 16);
+            if (format.size() < 16)
+                break;
+            metadata.numChannels = format[2] | (format[3] << 8);
+            metadata.sampleRate = readLittleEndian32(format.data() + 4);
+            byteRate = readLittleEndian32(format.data() + 8);
+        }
+        else if (hasId(chunkHeader, 0, "data"))
+        {
+            // RF64 and streamed files leave the size at its maximum
+            dataBytes = chunkBytes == 0xffffffff ? -1 : juce::jmin((juce::int64)chunkBytes, fileSize - body);
+        }
+        else if (hasId(chunkHeader, 0, "LIST") && chunkBytes >= 4 && chunkBytes <= (juce::uint32)maxTextBytes)
+        {
+            std::vector<juce::uint8> list = readAt(stream, body, (int)chunkBytes);
+            if (hasId(list, 0, "INFO"))
+            {
+                for (size_t item = 4; item + 8 <= list.size(); )
+                {
+                    size_t itemBytes = readLittleEndian32(list.data() + item + 4);
+                    if (itemBytes > list.size() - item - 8)
+                        break;
+                    // values are null terminated, and taken to be UTF-8
+                    std::string value(reinterpret_cast<const char*>(list.data() + item + 8), itemBytes);
+                    value = value.substr(0, value.find('\0'));
+                    if (hasId(list, item, "INAM"))
+                        metadata.title = value;
+                    else if (hasId(list, item, "IART"))
+                        metadata.artist = value;
+                    else if (hasId(list, item, "IPRD"))
+                        metadata.album = value;
+                    item += 8 + itemBytes + (itemBytes & 1);
+                }
+            }
+        }
+        // chunks are padded to an even size
+        position = body + chunkBytes + (chunkBytes & 1);
+    }
+    if (byteRate == 0 || dataBytes < 0)
+        return false;
+    metadata.length = (double)dataBytes / byteRate;
+    return true;
+}
+
+bool MetadataProbe::probeAiff(juce::InputStream& stream, Metadata& metadata)
+{
+    juce::int64 fileSize = stream.getTotalLength();
+    bool foundCommon = false;
+    for (juce::int64 position = 12; position + 8 <= fileSize; )
+    {
+        std::vector<juce::uint8> chunkHeader = readAt(stream, position, 8);
+        if (chunkHeader.size() < 8)
+            break;
+        juce::uint32 chunkBytes = readBigEndian32(chunkHeader.data() + 4);
+        juce::int64 body = position + 8;
+        if (hasId(chunkHeader, 0, "COMM") && chunkBytes >= 18)
+        {
+            std::vector<juce::uint8> common = readAt(stream, body, 18);
+            if (common.size() < 18)
+                break;
+            metadata.numChannels = (common[0] << 8) | common[1];
+            juce::uint32 numFrames = readBigEndian32(common.data() + 2);
+            // 80 bit IEEE extended sample rate: sign and 15 bit exponent, then a 64 bit mantissa
+            const juce::uint8* rate = common.data() + 8;
+            int exponent = (((rate[0] & 0x7f) << 8) | rate[1]) - 16383 - 63;
+            juce::uint64 mantissa = ((juce::uint64)readBigEndian32(rate + 2) << 32) | readBigEndian32(rate + 6);
+            metadata.sampleRate = std::ldexp((double)mantissa, exponent);
+            if (metadata.sampleRate > 0)
+                metadata.length = numFrames / metadata.sampleRate;
+            foundCommon = true;
+        }
+        else if ((hasId(chunkHeader, 0, "NAME") || hasId(chunkHeader, 0, "AUTH")) && chunkBytes <= (juce::uint32)maxTextBytes)
+        {
+            std::vector<juce::uint8> text = readAt(stream, body, (int)chunkBytes);
+            std::string value(text.begin(), text.end());
+            (hasId(chunkHeader, 0, "NAME") ? metadata.title : metadata.artist) = value.substr(0, value.find('\0'));
+        }
+        position = body + chunkBytes + (chunkBytes & 1);
+    }
+    return foundCommon;
+}
+
+/* ======================= */
+/* ====== utilities ====== */
+/* ======================= */
+
+std::string MetadataProbe::clean(const std::string& text)
+{
+    std::string cleaned = text;
+    for (char& c : cleaned)
+        if (c == '\t' || c == '\n' || c == '\r')
+            c = ' ';
+    size_t first = cleaned.find_first_not_of(' ');
+    if (first == std::string::npos)
+        return std::string();
+    size_t last = cleaned.find_last_not_of(' ');
+    return cleaned.substr(first, last - first + 1);
+}
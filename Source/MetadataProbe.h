@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    MetadataProbe.h
+    Created: 30 Oct 2026 10:27:15am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <vector>
+
+//==============================================================================
+/*
+ Reads tags and duration from the headers of an audio file without decoding it
+ MP3 tags come from ID3v2 and the duration from a Xing / Info (with LAME
+ delay and padding) or VBRI header, or the bitrate of a constant bitrate file
+ FLAC and Ogg Vorbis tags come from their Vorbis comments, the duration from
+ FLAC's STREAMINFO or the granule position of the last Ogg page
+ WAV tags come from a LIST INFO chunk and AIFF tags from NAME and AUTH chunks,
+ the duration from the size of the sample data
+ Each probe is a few small reads at the start of the file, and for Ogg and
+ ID3v1 detection one at the end
+*/
+class MetadataProbe
+{
+public:
+    /** what a probe found, strings are UTF-8 with tabs and line breaks replaced by spaces */
+    struct Metadata
+    {
+        std::string     title, artist, album;
+        double          length = 0;         // in seconds
+        double          sampleRate = 0;
+        int             numChannels = 0;
+    };
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     MetadataProbe::probe()
+     Input                  juce::File, Metadata
+     Output                 bool
+     Fills in whatever the file's headers hold
+     Returns false if the file isn't a format the probe knows, or its duration couldn't be found,
+     in which case the file should be opened with an AudioFormatReader instead
+     Safe to call from any thread
+     */
+    static bool probe(const juce::File& file, Metadata& metadata);
+
+private:
+    /** MetadataProbe::readAt() reads up to numBytes from a position in the stream, returning what was read */
+    static std::vector<juce::uint8> readAt(juce::InputStream& stream, juce::int64 position, int numBytes);
+
+    /** one per container, each reads from the start of the file */
+    static bool probeMpeg(juce::InputStream& stream, Metadata& metadata);
+    static bool probeFlac(juce::InputStream& stream, juce::int64 start, Metadata& metadata);
+    static bool probeOgg(juce::InputStream& stream, Metadata& metadata);
+    static bool probeRiff(juce::InputStream& stream, Metadata& metadata);
+    static bool probeAiff(juce::InputStream& stream, Metadata& metadata);
+
+    /**
+     MetadataProbe::readID3v2()
+     Input                  juce::InputStream, Metadata
+     Output                 juce::int64
+     Reads the title, artist and album frames of an ID3v2 tag at the start of the stream,
+     skipping every other frame. Returns the size of the tag, 0 if there is none
+     */
+    static juce::int64 readID3v2(juce::InputStream& stream, Metadata& metadata);
+
+    /** MetadataProbe::decodeID3Text() converts an ID3v2 text frame in any of its encodings to UTF-8 */
+    static std::string decodeID3Text(const juce::uint8* data, size_t numBytes);
+
+    /** MetadataProbe::readVorbisComments() reads TITLE, ARTIST and ALBUM from a Vorbis comment block */
+    static void readVorbisComments(const juce::uint8* data, size_t numBytes, Metadata& metadata);
+
+    /** MetadataProbe::clean() replaces tabs and line breaks, which would split a library line, and trims */
+    static std::string clean(const std::string& text);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    /** most bytes searched for the first MPEG frame after a tag */
+    static constexpr int mpegSearchBytes = 16384;
+    /** most bytes read from the end of an Ogg file to find the last page */
+    static constexpr int oggTailBytes = 65536;
+    /** most bytes read from the start of an Ogg file to find the comment header */
+    static constexpr int oggHeadBytes = 65536;
+    /** largest tag frame or chunk read, bigger ones are skipped */
+    static constexpr int maxTextBytes = 65536;
+};
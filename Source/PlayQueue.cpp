@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    PlayQueue.cpp
+    Created: 28 Oct 2026 11:06:52am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "PlayQueue.h"
+#include "LibraryJournal.h"
+#include <fstream>
+#include <string>
+
+constexpr long int PlayQueue::noTrack;
+
+PlayQueue::PlayQueue() : slots(16, noTrack)
+{
+}
+
+PlayQueue::~PlayQueue()
+{
+}
+
+void PlayQueue::push(long int libraryId)
+{
+    if (count == slots.size())
+        grow();
+    slots[(head + count) & (slots.size() - 1)] = libraryId;
+    ++count;
+}
+
+void PlayQueue::pushFront(long int libraryId)
+{
+    if (count == slots.size())
+        grow();
+    head = (head + slots.size() - 1) & (slots.size() - 1);
+    slots[head] = libraryId;
+    ++count;
+}
+
+long int PlayQueue::pop()
+{
+    if (count == 0)
+        return noTrack;
+    long int libraryId = slots[head];
+    head = (head + 1) & (slots.size() - 1);
+    --count;
+    return libraryId;
+}
+
+long int PlayQueue::peek(int index) const
+{
+    if (index < 0 || (size_t)index >= count)
+        return noTrack;
+    return slots[slotFor(index)];
+}
+
+void PlayQueue::swap(int first, int second)
+{
+    if (first < 0 || second < 0 || (size_t)first >= count || (size_t)second >= count)
+        return;
+    std::swap(slots[slotFor(first)], slots[slotFor(second)]);
+}
+
+void PlayQueue::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+int PlayQueue::size() const
+{
+    return (int)count;
+}
+
+bool PlayQueue::isEmpty() const
+{
+    return count == 0;
+}
+
+int PlayQueue::getLibraryPosition() const
+{
+    return libraryPosition;
+}
+
+void PlayQueue::setLibraryPosition(int position)
+{
+    libraryPosition = juce::jmax(0, position);
+}
+
+bool PlayQueue::load(const juce::File& file)
+{
+    clear();
+    std::ifstream queueFile(file.getFullPathName().toStdString());
+    if (!queueFile.is_open())
+        return false;
+    std::string line;
+    try
+    {
+        if (std::getline(queueFile, line))
+            setLibraryPosition(std::stoi(line));
+        while (std::getline(queueFile, line))
+            if (!line.empty())
+                push(std::stol(line));
+    }
+    catch (const std::exception&)
+    {
+        std::cout << "PlayQueue::load: " << file.getFullPathName() << " is damaged, starting an empty queue" << std::endl;
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool PlayQueue::save(const juce::File& file) const
+{
+    std::string contents = std::to_string(libraryPosition) + "\n";
+    for (int i = 0; i < size(); ++i)
+        contents += std::to_string(peek(i)) + "\n";
+    return LibraryJournal::writeFileDurably(file, contents);
+}
+
+size_t PlayQueue::slotFor(int index) const
+{
+    return (head + (size_t)index) & (slots.size() - 1);
+}
+
+void PlayQueue::grow()
+{
+    std::vector<long int> grown(slots.size() * 2, noTrack);
+    for (size_t i = 0; i < count; ++i)
+        grown[i] = slots[(head + i) & (slots.size() - 1)];
+    slots.swap(grown);
+    head = 0;
+}
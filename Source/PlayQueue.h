@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    PlayQueue.h
+    Created: 28 Oct 2026 11:06:52am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+/*
+ The tracks autoplay will load next, held apart from the library so playing
+ through them never reorders it
+ Tracks are referenced by library id in a ring buffer, so taking the next
+ track, queueing one at either end and swapping two are all constant time
+ Once the queue runs dry autoplay carries on through the library from a
+ saved position. The queue is saved to its own small text file
+*/
+class PlayQueue
+{
+public:
+    PlayQueue();
+    ~PlayQueue();
+
+    /** returned when the queue is empty */
+    static constexpr long int noTrack = -1;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /** PlayQueue::push() queues a track to play after everything already queued */
+    void push(long int libraryId);
+
+    /** PlayQueue::pushFront() queues a track to play next */
+    void pushFront(long int libraryId);
+
+    /** PlayQueue::pop() takes the next track off the queue, or returns noTrack */
+    long int pop();
+
+    /** PlayQueue::peek() returns the track at a position in the queue without taking it, or noTrack */
+    long int peek(int index = 0) const;
+
+    /** PlayQueue::swap() swaps the tracks at two positions in the queue */
+    void swap(int first, int second);
+
+    /** PlayQueue::clear() empties the queue, keeping the library position */
+    void clear();
+
+    int size() const;
+    bool isEmpty() const;
+
+    /** PlayQueue::getLibraryPosition() returns where autoplay carries on in the library once the queue is empty */
+    int getLibraryPosition() const;
+    void setLibraryPosition(int position);
+
+    /**
+     PlayQueue::load()
+     Input                  juce::File
+     Output                 bool
+     Replaces the queue with one saved by PlayQueue::save()
+     Returns false, leaving the queue empty, if the file is missing or damaged
+     */
+    bool load(const juce::File& file);
+
+    /**
+     PlayQueue::save()
+     Input                  juce::File
+     Output                 bool
+     Writes the library position, then one library id per line in queue order
+     */
+    bool save(const juce::File& file) const;
+
+private:
+    /** PlayQueue::slotFor() returns the slot holding a position in the queue */
+    size_t slotFor(int index) const;
+    /** PlayQueue::grow() doubles the ring, unwrapping the queue to start at slot 0 */
+    void grow();
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    /** ring of library ids, its size always a power of 2 */
+    std::vector<long int> slots;
+    /** slot of the next track, and the number of tracks queued */
+    size_t head = 0, count = 0;
+    /** next library position for autoplay */
+    int libraryPosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayQueue)
+};
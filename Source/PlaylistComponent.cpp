@@ -10,51 +10,167 @@
 
 #include <JuceHeader.h>
 #include <iterator>
+#include <algorithm>
 #include <sstream>
-#include <regex>
+#include <set>
+#include <cmath>
 #include "PlaylistComponent.h"
+#include "LibraryQuery.h"
+#include "AnalysisStages.h"
+#include "ThumbnailDiskCache.h"
 
 //==============================================================================
 PlaylistComponent::PlaylistComponent(juce::AudioFormatManager &formatManagerToUse,
+                                     FrameScheduler &_frameScheduler,
+                                     const juce::File &_thumbnailFolder,
                                      DJAudioPlayer &_player1,
                                      DeckGUI* &_deckGUI1,
                                      DJAudioPlayer &_player2,
                                      DeckGUI* &_deckGUI2) :
                                         formatManager(&formatManagerToUse),
+                                        frameScheduler(&_frameScheduler),
                                         player1 (&_player1),
-                                        player2 (&_player2)
+                                        player2 (&_player2),
+                                        thumbnailFolder (_thumbnailFolder)
 {
     // initialise settings
     nextLibraryId = 0;
-    musicLibPath = "musicLib.txt";
+    musicLibPath = "musicLib.bin";
+    musicLibImportPath = "musicLib.txt";
+    musicLibJournalPath = "musicLib.journal";
+    playQueuePath = "playQueue.txt";
     loadMusicLib();
-    tracksToDisplay = musicLib;
+    playQueue.load(juce::File::getCurrentWorkingDirectory().getChildFile(playQueuePath));
+    tracksToDisplay = musicLib.getOrder();
     crossfade.setName(juce::String("crossfade"));
     crossfadeTime.setName(juce::String("crossfade time"));
+    targetLoudness.setName(juce::String("target loudness"));
     autoCrossfadeToggle = true;
     autoplayToggle = false;
+    lastCrossfadeFrameMs = -1;
     
     deckGUIs.push_back(_deckGUI1);
     deckGUIs.push_back(_deckGUI2);
     
-    tableComponent.getHeader().addColumn("Track Title", 1, 400);
-    tableComponent.getHeader().addColumn("Length", 2, 100);
-    tableComponent.getHeader().addColumn("Load To Player 1", 3, 100);
-    tableComponent.getHeader().addColumn("Load To Player 2", 4, 100);
-    tableComponent.getHeader().addColumn("Remove", 5, 100);
+    // ids 1 - 5 are kept from before the sortable columns were added, buttons can't be sorted by
+    const int buttonColumnFlags = juce::TableHeaderComponent::defaultFlags & ~juce::TableHeaderComponent::sortable;
+    tableComponent.getHeader().addColumn("Track Title", 1, 300);
+    tableComponent.getHeader().addColumn("Artist", 10, 160);
+    tableComponent.getHeader().addColumn("Album", 11, 160);
+    tableComponent.getHeader().addColumn("Length", 2, 70);
+    tableComponent.getHeader().addColumn("BPM", 6, 60);
+    tableComponent.getHeader().addColumn("Key", 7, 50);
+    tableComponent.getHeader().addColumn("Added", 8, 90);
+    tableComponent.getHeader().addColumn("Plays", 9, 50);
+    tableComponent.getHeader().addColumn("Load To Player 1", 3, 100, 30, -1, buttonColumnFlags);
+    tableComponent.getHeader().addColumn("Load To Player 2", 4, 100, 30, -1, buttonColumnFlags);
+    tableComponent.getHeader().addColumn("Remove", 5, 100, 30, -1, buttonColumnFlags);
     
     tableComponent.setModel(this);
+    tableComponent.setMultipleSelectionEnabled(true);
     
     addAndMakeVisible(searchInput);
     searchInput.addListener(this);
-    searchInput.setTextToShowWhenEmpty("search playlist by title", warningTextColour);
+    searchInput.setTextToShowWhenEmpty("search playlist, e.g. bpm:120-128 key:8A len:<6m techno", warningTextColour);
     searchInput.setIndents(4, 8);
     
+    addAndMakeVisible(searchMode);
+    // item ids are SearchWorker::Mode + 1
+    searchMode.addItem("contains", SearchWorker::contains + 1);
+    searchMode.addItem("fuzzy", SearchWorker::fuzzy + 1);
+    searchMode.addItem("regex", SearchWorker::regex + 1);
+    searchMode.setSelectedId(SearchWorker::contains + 1, juce::dontSendNotification);
+    searchMode.onChange = [this]
+    {
+        // fuzzy results come ranked by relevance, which a column sort would undo until a column is clicked again
+        if (searchMode.getSelectedId() == SearchWorker::fuzzy + 1 && !sortKeys.empty())
+        {
+            sortKeys.clear();
+            tableComponent.getHeader().setSortColumnId(0, true);
+        }
+        filterTracksToDisplayByTitle(searchInput.getText().toStdString());
+    };
+    searchWorker.onResults = [this] (const SearchWorker::Results& results) { showSearchResults(results); };
+    
+    addChildComponent(importProgress);
+    addChildComponent(cancelImport);
+    cancelImport.onClick = [this] { libraryImporter.cancel(); };
+    libraryImporter.onTracks = [this] (std::vector<TrackStore::TrackInfo>& tracks) { addImportedTracks(tracks); };
+    libraryImporter.onFinished = [this] (bool wasCancelled) { finishImport(wasCancelled); };
+    libraryWatcher.getKnownTracks = [this] ()
+    {
+        std::vector<LibraryWatcher::KnownTrack> knownTracks;
+        knownTracks.reserve(musicLib.getOrder().size());
+        for (juce::uint32 row : musicLib.getOrder())
+            knownTracks.push_back({ musicLib.getLibraryId(row), musicLib.getURLString(row), musicLib.getSignature(row) });
+        return knownTracks;
+    };
+    libraryWatcher.onChanges = [this] (std::vector<LibraryWatcher::Change>& changes) { applyLibraryChanges(changes); };
+    // catch up with whatever happened to the watched folders while the app was closed
+    libraryWatcher.scanAll();
+    trackValidator.onUnplayable = [this] (std::vector<long int>& trackIds)
+    {
+        {
+            const SearchWorker::ScopedLibraryChange change(searchWorker);
+            for (long int libraryId : trackIds)
+            {
+                juce::uint32 row = musicLib.findRow(libraryId);
+                if (row != TrackStore::noRow)
+                    musicLib.setPlayable(row, false);
+            }
+        }
+        tableComponent.repaint();
+        // the change dropped any search under way or showing
+        if (searchInput.getText().isNotEmpty())
+            filterTracksToDisplayByTitle(searchInput.getText().toStdString(), false);
+    };
+    trackValidator.onFinished = [] (int numChecked, int numUnplayable)
+    {
+        if (numUnplayable > 0)
+            std::cout << "PlaylistComponent: " << numUnplayable << " of " << numChecked << " tracks can't be played" << std::endl;
+    };
+    std::vector<TrackValidator::Track> tracksToValidate;
+    tracksToValidate.reserve(musicLib.getOrder().size());
+    for (juce::uint32 row : musicLib.getOrder())
+        tracksToValidate.push_back({ (long int)musicLib.getLibraryId(row), musicLib.getURLString(row) });
+    trackValidator.validate(tracksToValidate);
+    // the beat grid refines the tempo, so follows it, and the mix points are phrases of the grid
+    trackAnalyser.addStage([this] { return std::make_unique<ThumbnailStage>(*formatManager, thumbcache, thumbnailFolder); });
+    trackAnalyser.addStage([] { return std::make_unique<TempoStage>(); });
+    trackAnalyser.addStage([] { return std::make_unique<BeatGridStage>(); });
+    trackAnalyser.addStage([] { return std::make_unique<MixPointStage>(); });
+    trackAnalyser.addStage([] { return std::make_unique<KeyStage>(); });
+    trackAnalyser.addStage([] { return std::make_unique<LoudnessStage>(); });
+    trackAnalyser.addStage([] { return std::make_unique<FingerprintStage>(); });
+    // the playheads are published lock-free by the audio thread, so can be read from the analyser's
+    trackAnalyser.isAudioPlaying = [this] { return player1->getPlayhead().playing || player2->getPlayhead().playing; };
+    trackAnalyser.onAnalysed = [this] (std::vector<TrackAnalyser::Analysis>& analyses) { applyAnalyses(analyses); };
+    trackAnalyser.onFinished = [this] { findDuplicates(); };
+    analyseNewTracks();
+    duplicateFinder.onGroups = [this] (std::vector<std::vector<long int>>& groups) { setDuplicateGroups(groups); };
+    duplicateFinder.onMissing = [this] (std::vector<long int>& trackIds)
+    {
+        // a fingerprint lost with the file it was kept in is taken again, tracks not yet analysed are already queued
+        std::vector<TrackAnalyser::Track> tracks;
+        for (long int libraryId : trackIds)
+        {
+            juce::uint32 row = musicLib.findRow(libraryId);
+            if (row != TrackStore::noRow && musicLib.isAnalysed(row))
+                tracks.push_back({ libraryId, musicLib.getURLString(row), musicLib.getSignature(row) });
+        }
+        trackAnalyser.analyse(tracks);
+    };
+    findDuplicates();
+    
     addAndMakeVisible(autoPlay);
     addAndMakeVisible(autoCrossfade);
     addAndMakeVisible(crossfadeTime);
+    addAndMakeVisible(targetLoudness);
     addAndMakeVisible(loadToPlaylist);
     addAndMakeVisible(clearPlaylist);
+    addAndMakeVisible(exportPlaylist);
+    addAndMakeVisible(bpmPool);
+    addAndMakeVisible(duplicates);
     
     autoPlay.onClick = [this] { engageAutoplay(); };
     autoPlay.setClickingTogglesState(true);
@@ -65,6 +181,13 @@ PlaylistComponent::PlaylistComponent(juce::AudioFormatManager &formatManagerToUs
     
     clearPlaylist.onClick = [this] { emptyPlaylist(); };
     
+    exportPlaylist.onClick = [this] { openExportBrowser(); };
+    
+    bpmPool.onClick = [this] { showBpmPool(); };
+    
+    duplicates.setClickingTogglesState(true);
+    duplicates.onClick = [this] { filterTracksToDisplayByTitle(searchInput.getText().toStdString()); };
+    
     deckGUIs[0]->addChangeListener(this);
     deckGUIs[1]->addChangeListener(this);
     
@@ -72,6 +195,12 @@ PlaylistComponent::PlaylistComponent(juce::AudioFormatManager &formatManagerToUs
     crossfade.setTextBoxIsEditable(false);
     crossfade.setNumDecimalPlacesToDisplay(0);
     crossfade.onValueChange = [this] { setCrossfade(); };
+    // taking hold of the crossfader stops an auto crossfade under way
+    crossfade.onDragStart = [this]
+    {
+        autoCrossfadeToggle = false;
+        lastCrossfadeFrameMs = -1;
+    };
     crossfade.setRange(0.0, 1.0);
     // display position as minutes and seconds */
     crossfade.textFromValueFunction = [](double value)
@@ -90,6 +219,28 @@ PlaylistComponent::PlaylistComponent(juce::AudioFormatManager &formatManagerToUs
     crossfadeTime.setTextValueSuffix("ms");
     crossfadeTime.setNumDecimalPlacesToDisplay(0);
     crossfadeTime.setDoubleClickReturnValue(true, 1000);
+    // the hand-off has to start earlier for a longer crossfade to finish before the sound does
+    crossfadeTime.onValueChange = [this]
+    {
+        for (DeckGUI* dG : deckGUIs)
+            if (dG->currentLibraryId != -1)
+                setDeckMixPoints(dG, musicLib.findRow(dG->currentLibraryId));
+    };
+    
+    // analysed tracks are normalised to this as they are loaded
+    targetLoudness.setSliderStyle(juce::Slider::LinearBar);
+    targetLoudness.setRange(-24, -6, 0.5);
+    targetLoudness.setValue(-14);
+    targetLoudness.setTextValueSuffix(" LUFS");
+    targetLoudness.setNumDecimalPlacesToDisplay(1);
+    targetLoudness.setDoubleClickReturnValue(true, -14);
+    targetLoudness.onValueChange = [this]
+    {
+        player1->setTargetLoudness((float)targetLoudness.getValue());
+        player2->setTargetLoudness((float)targetLoudness.getValue());
+    };
+    player1->setTargetLoudness((float)targetLoudness.getValue());
+    player2->setTargetLoudness((float)targetLoudness.getValue());
 
     addAndMakeVisible(tableComponent);
     addAndMakeVisible(crossfade);
@@ -97,13 +248,15 @@ PlaylistComponent::PlaylistComponent(juce::AudioFormatManager &formatManagerToUs
     addAndMakeVisible(deckGUIs[1]);
 
     autoCrossfadeInc = crossfade.getRange().getLength()/(crossfadeTime.getValue()/10) * -1;
-    startTimer(10);
-
+    frameScheduler->addClient(this);
+    frameScheduler->wake();
 }
 
 PlaylistComponent::~PlaylistComponent()
 {
-    stopTimer();
+    frameScheduler->removeClient(this);
+    // autoplay only moves the queue on in memory, it is written out here and when tracks are queued
+    playQueue.save(juce::File::getCurrentWorkingDirectory().getChildFile(playQueuePath));
 }
 
 void PlaylistComponent::paint (juce::Graphics& g)
@@ -118,15 +271,22 @@ void PlaylistComponent::resized()
     rowH = (getHeight() - guiIndent) / 16;
     colW = (getWidth() - guiIndent) / 5;
     searchInput.setBounds(guiIndent, guiIndent, colW, rowH - (guiIndent * 2));
+    searchMode.setBounds(colW + guiIndent, guiIndent, colW / 2, rowH - (guiIndent * 2));
+    duplicates.setBounds(colW * 1.5 + guiIndent * 2, guiIndent, colW / 2 - (guiIndent * 3), rowH - (guiIndent * 2));
+    bpmPool.setBounds(colW * 2, guiIndent, colW, rowH - (guiIndent * 2));
+    exportPlaylist.setBounds(colW * 3, guiIndent, colW, rowH - (guiIndent * 2));
     clearPlaylist.setBounds(colW * 4, guiIndent, colW, rowH - (guiIndent * 2));
     tableComponent.autoSizeColumn(3);
     tableComponent.autoSizeColumn(4);
     tableComponent.autoSizeColumn(5);
     tableComponent.setBounds(guiIndent, rowH, colW*5, rowH*6);
+    importProgress.setBounds(guiIndent, rowH*6, colW*4, rowH);
+    cancelImport.setBounds(colW*4, rowH*6, colW, rowH);
     loadToPlaylist.setBounds(guiIndent, rowH*7 + guiIndent, colW, rowH);
     autoPlay.setBounds(colW, rowH*7 + guiIndent, colW, rowH);
     autoCrossfade.setBounds(colW*3, rowH*7 + guiIndent, colW, rowH);
-    crossfadeTime.setBounds(colW*4, rowH*7 + guiIndent, colW, rowH);
+    crossfadeTime.setBounds(colW*4, rowH*7 + guiIndent, colW / 2, rowH);
+    targetLoudness.setBounds(colW*4.5, rowH*7 + guiIndent, colW / 2, rowH);
     crossfade.setBounds(colW*2, rowH*7 + guiIndent, colW, rowH);
     deckGUIs[0]->setBounds(guiIndent, (getHeight()/2) + guiIndent, getWidth()/2 - (guiIndent * 2), getHeight()/2 - (guiIndent * 2));
     deckGUIs[1]->setBounds(getWidth()/2 + guiIndent, (getHeight()/2) + guiIndent, getWidth()/2 - (guiIndent * 2), getHeight()/2 - (guiIndent * 2));
@@ -155,7 +315,9 @@ void PlaylistComponent::paintRowBackground(Graphics & g,
                                            int height,
                                            bool rowIsSelected)
 {
-    const float alpha = (rowNumber % 2 == 0 ? 1.0f : 0.5f);
+    // duplicates are shaded by group rather than by row
+    const bool showingGroups = duplicates.getToggleState() && rowNumber >= 0 && rowNumber < (int)displayGroups.size();
+    const float alpha = ((showingGroups ? displayGroups[(size_t)rowNumber] : (size_t)rowNumber) % 2 == 0 ? 1.0f : 0.5f);
     if (rowIsSelected)
     {
         g.fillAll(controllerIndicator);
@@ -174,10 +336,28 @@ void PlaylistComponent::paintCell (Graphics & g,
 {
     g.setColour(infoTextColour);
     float controlIndent = 2.0f;
+    if (rowNumber >= tracksToDisplay.size())
+        return;
+    juce::uint32 row = tracksToDisplay[rowNumber];
+    // missing or damaged files stand out so they aren't loaded mid set
+    if (!musicLib.isPlayable(row))
+        g.setColour(warningTextColour);
     if (columnId == 1)
-        g.drawText (tracksToDisplay[rowNumber].title, 2, 0, width - 4, height, Justification::centredLeft, true);
+        g.drawText (musicLib.getTitle(row), 2, 0, width - 4, height, Justification::centredLeft, true);
+    if (columnId == 10)
+        g.drawText (musicLib.getArtist(row), 2, 0, width - 4, height, Justification::centredLeft, true);
+    if (columnId == 11)
+        g.drawText (musicLib.getAlbum(row), 2, 0, width - 4, height, Justification::centredLeft, true);
     if (columnId == 2)
-        g.drawText (lengthToMinutesAndSeconds(tracksToDisplay[rowNumber].length), 2, 0, width - 4, height, Justification::centred, false);
+        g.drawText (lengthToMinutesAndSeconds(musicLib.getLength(row)), 2, 0, width - 4, height, Justification::centred, false);
+    if (columnId == 6 && musicLib.hasBpm(row))
+        g.drawText (juce::String(musicLib.getBpm(row), 1), 2, 0, width - 4, height, Justification::centred, false);
+    if (columnId == 7 && musicLib.hasKey(row))
+        g.drawText (getCamelotKey(row), 2, 0, width - 4, height, Justification::centred, false);
+    if (columnId == 8 && musicLib.getDateAdded(row) > 0)
+        g.drawText (juce::Time(musicLib.getDateAdded(row)).formatted("%d %b %Y"), 2, 0, width - 4, height, Justification::centred, false);
+    if (columnId == 9)
+        g.drawText (juce::String(musicLib.getPlayCount(row)), 2, 0, width - 4, height, Justification::centred, false);
     if (columnId == 3 || columnId == 4)
     {
         g.setColour(controllerBody);
@@ -208,17 +388,21 @@ Component* PlaylistComponent::refreshComponentForCell (int rowNumber,
 /* ====== listeners and event lambdas ====== */
 /* ========================================= */
 
-void PlaylistComponent::cellClicked(int rowNumber, int columnId, const MouseEvent&)
+void PlaylistComponent::cellClicked(int rowNumber, int columnId, const MouseEvent& mEv)
 {
-    if (columnId == 3 || columnId == 4)
+    if (rowNumber < 0 || rowNumber >= tracksToDisplay.size())
+        return;
+    if (mEv.mods.isPopupMenu())
     {
-        deckGUIs[columnId - 3]->currentTrackName = tracksToDisplay[rowNumber].title;
-        deckGUIs[columnId - 3]->loadFile(tracksToDisplay[rowNumber].trackURL);
+        showSelectionMenu(rowNumber);
+        return;
     }
+    juce::uint32 row = tracksToDisplay[rowNumber];
+    if (columnId == 3 || columnId == 4)
+        loadToDeck(deckGUIs[columnId - 3], row);
     if (columnId == 5)
     {
-        long int libraryIdToRemove = tracksToDisplay[rowNumber].libraryId;
-        removeFromLibrary(libraryIdToRemove);
+        removeFromLibrary({ (long int)musicLib.getLibraryId(row) });
     }
 }
 
@@ -233,8 +417,37 @@ void PlaylistComponent::returnKeyPressed(int lastRowSelected)
 }
 void PlaylistComponent::deleteKeyPressed(int lastRowSelected)
 {
-    long int libraryIdToRemove = tracksToDisplay[lastRowSelected].libraryId;
-    removeFromLibrary(libraryIdToRemove);
+    if (lastRowSelected < 0 || lastRowSelected >= tracksToDisplay.size())
+        return;
+    removeFromLibrary(getSelectedTrackIds());
+}
+
+void PlaylistComponent::sortOrderChanged(int newSortColumnId, bool isForwards)
+{
+    RowSorter::SortKey sortKey;
+    switch (newSortColumnId)
+    {
+        case 1: sortKey.column = RowSorter::title; break;
+        case 2: sortKey.column = RowSorter::length; break;
+        case 6: sortKey.column = RowSorter::bpm; break;
+        case 7: sortKey.column = RowSorter::key; break;
+        case 8: sortKey.column = RowSorter::dateAdded; break;
+        case 9: sortKey.column = RowSorter::playCount; break;
+        case 10: sortKey.column = RowSorter::artist; break;
+        case 11: sortKey.column = RowSorter::album; break;
+        default: return;
+    }
+    sortKey.forwards = isForwards;
+    // the clicked column leads, earlier clicks break its ties
+    sortKeys.erase(std::remove_if(sortKeys.begin(), sortKeys.end(),
+                                  [&sortKey] (const RowSorter::SortKey& existing) { return existing.column == sortKey.column; }),
+                   sortKeys.end());
+    sortKeys.insert(sortKeys.begin(), sortKey);
+    if (sortKeys.size() > (size_t)RowSorter::maxKeys)
+        sortKeys.resize((size_t)RowSorter::maxKeys);
+    applySort();
+    tableComponent.updateContent();
+    repaint();
 }
 
 void PlaylistComponent::setCrossfade()
@@ -259,16 +472,16 @@ void PlaylistComponent::changeListenerCallback(juce::ChangeBroadcaster* source)
                     otherDG->play();
                 autoCrossfadeInc = crossfade.getRange().getLength()/(crossfadeTime.getValue()/10) * (1 - (2 * i));
                 autoCrossfadeToggle = true;
+                lastCrossfadeFrameMs = -1;
+                frameScheduler->wake();
+                // the deck's later change messages don't start the crossfade again
+                dG->streamNearlyEnded = false;
             }
             else if (source == dG && dG->streamEnded)
             {
-                Track temp = musicLib[0];
-                dG->loadFile(temp.trackURL);
-                dG->currentTrackName = temp.title;
-                musicLib.erase(musicLib.begin());
-                musicLib.push_back(temp);
-                saveMusicLib();
-                filterTracksToDisplayByTitle(searchInput.getText().toStdString());
+                juce::uint32 next = takeNextTrack();
+                if (next != TrackStore::noRow)
+                    loadToDeck(dG, next);
                 dG->streamEnded = false;
                 dG->streamNearlyEnded = false;
                 dG->toTrackStart();
@@ -282,11 +495,14 @@ void PlaylistComponent::changeListenerCallback(juce::ChangeBroadcaster* source)
     }
 }
 
-void PlaylistComponent::timerCallback()
+bool PlaylistComponent::frameCallback(double frameTimeMs)
 {
     if (autoCrossfadeToggle && crossfade.getValue() <= crossfade.getRange().getEnd() && crossfade.getValue() >= crossfade.getRange().getStart())
     {
-        crossfade.setValue(crossfade.getValue() + autoCrossfadeInc);
+        // autoCrossfadeInc is per 10ms, scale it by the time since the last frame
+        double elapsedTicks = lastCrossfadeFrameMs < 0 ? 1.0 : (frameTimeMs - lastCrossfadeFrameMs) / 10;
+        lastCrossfadeFrameMs = frameTimeMs;
+        crossfade.setValue(crossfade.getValue() + autoCrossfadeInc * elapsedTicks);
         if (crossfade.getValue() >= crossfade.getRange().getEnd())
             crossfade.setValue(crossfade.getRange().getEnd());
         else if (crossfade.getValue() <= crossfade.getRange().getStart())
@@ -295,19 +511,24 @@ void PlaylistComponent::timerCallback()
     if (autoCrossfadeToggle && (crossfade.getValue() == crossfade.getRange().getEnd() || crossfade.getValue() == crossfade.getRange().getStart()))
     {
         autoCrossfadeToggle = false;
+        lastCrossfadeFrameMs = -1;
     }
+    return autoCrossfadeToggle;
 }
 
 void PlaylistComponent::textEditorTextChanged(TextEditor& textEditor)
 {
+    // a search replaces the duplicates
+    duplicates.setToggleState(false, juce::dontSendNotification);
     if (textEditor.getText() == "")
     {
-        tracksToDisplay = musicLib;
+        tracksToDisplay = musicLib.getOrder();
+        applySort();
         tableComponent.updateContent();
         repaint();
     }
     else
-        filterTracksToDisplayByTitle(textEditor.getText().toStdString());
+        filterTracksToDisplayByTitle(textEditor.getText().toStdString(), true);
 }
 
 /* ================================================ */
@@ -322,10 +543,17 @@ void PlaylistComponent::filesDropped (const StringArray &files, int x, int y)
 {
     if (files.size() >= 1)
     {
+        juce::StringArray audioPaths;
         for (auto file : files)
         {
-            loadFileToMusicLib(file);
+            // tab delineated library files are imported, anything else is treated as audio or a folder of audio
+            if (juce::File(file).hasFileExtension("txt;tsv"))
+                importMusicLib(juce::File(file));
+            else
+                audioPaths.add(file);
         }
+        if (!audioPaths.isEmpty())
+            startImport(audioPaths);
     }
 }
 
@@ -348,43 +576,340 @@ void PlaylistComponent::openFileBrowser()
 }
 
 void PlaylistComponent::loadMusicLib()
+{
+    const SearchWorker::ScopedLibraryChange change(searchWorker);
+    juce::File workingDirectory = juce::File::getCurrentWorkingDirectory();
+    std::shared_ptr<LibraryIndex> index = std::make_shared<LibraryIndex>();
+    bool needsRewrite = false;
+    juce::uint64 journalSequence = 0;
+    if (index->open(workingDirectory.getChildFile(musicLibPath)))
+    {
+        // the library keeps the index mapped and reads the strings from it
+        for (int i = 0; i < index->getNumTracks(); ++i)
+        {
+            juce::uint32 row = musicLib.addFromIndex(index, i);
+            if (musicLib.getLibraryId(row) >= nextLibraryId)
+                nextLibraryId = (long int)musicLib.getLibraryId(row) + 1;
+        }
+        needsRewrite = !index->isCurrentVersion();
+        journalSequence = index->getJournalSequence();
+    }
+    else if (workingDirectory.getChildFile(musicLibPath).existsAsFile())
+    {
+        // the journal only makes sense on top of the file it was written against, so the unreadable index and
+        // its journal are kept together out of the way instead of being replayed onto the import and compacted over
+        std::cout << "PlaylistComponent::loadMusicLib: " << musicLibPath << " is damaged or from an unknown version, moving it aside and importing " << musicLibImportPath << std::endl;
+        if (!setAsideMusicLib(workingDirectory))
+        {
+            std::cout << "PlaylistComponent::loadMusicLib: unable to move " << musicLibPath << " aside, quitting" << std::endl;
+            // nothing may be written next to the files that couldn't be moved, the journal only gets a scratch folder
+            juce::File scratch = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("musicLib", "");
+            scratch.createDirectory();
+            musicLibJournal = std::make_unique<LibraryJournal>(scratch.getChildFile(musicLibPath),
+                                                               scratch.getChildFile(musicLibJournalPath));
+            juce::JUCEApplicationBase::quit();
+            return;
+        }
+        needsRewrite = importMusicLib(workingDirectory.getChildFile(musicLibImportPath));
+    }
+    else
+        needsRewrite = importMusicLib(workingDirectory.getChildFile(musicLibImportPath));
+    // replay changes made since the file was last written
+    musicLibJournal = std::make_unique<LibraryJournal>(workingDirectory.getChildFile(musicLibPath),
+                                                       workingDirectory.getChildFile(musicLibJournalPath));
+    musicLibJournal->replay(journalSequence, [this] (const LibraryJournal::Record& record) { applyJournalRecord(record); });
+    titleIndex.rebuild(musicLib);
+    // an imported or older library is written straight out as a current index so the conversion only happens once
+    if (needsRewrite)
+        compactMusicLib();
+    else
+        compactMusicLibIfNeeded();
+}
+
+bool PlaylistComponent::setAsideMusicLib(const juce::File& workingDirectory)
+{
+    const juce::String suffix = ".damaged-" + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S");
+    for (const juce::String& path : { juce::String(musicLibPath), juce::String(musicLibJournalPath), juce::String(musicLibJournalPath) + ".compacting" })
+    {
+        juce::File file = workingDirectory.getChildFile(path);
+        if (file.existsAsFile() && !file.moveFileTo(file.getSiblingFile(file.getFileName() + suffix)))
+            return false;
+    }
+    return true;
+}
+
+bool PlaylistComponent::importMusicLib(const juce::File& file)
 {
     std::ifstream musicLibFile;
-    musicLibFile.open(musicLibPath);
-    if (musicLibFile.is_open())
+    musicLibFile.open(file.getFullPathName().toStdString());
+    if (!musicLibFile.is_open())
+        return false;
+    const SearchWorker::ScopedLibraryChange change(searchWorker);
+    std::set<juce::int64> takenIds;
+    for (juce::uint32 row : musicLib.getOrder())
+        takenIds.insert(musicLib.getLibraryId(row));
+    int skippedLines = 0;
+    std::vector<long int> addedIds;
+    for ( std::string line; getline(musicLibFile, line); )
     {
-        for ( std::string line; getline(musicLibFile, line); )
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+        TrackStore::TrackInfo track;
+        if (!tokeniseMusicLibLine(line, track))
+        {
+            ++skippedLines;
+            continue;
+        }
+        if (takenIds.count(track.libraryId) > 0)
+            track.libraryId = nextLibraryId;
+        takenIds.insert(track.libraryId);
+        if (track.libraryId >= nextLibraryId)
+            nextLibraryId = (long int)track.libraryId + 1;
+        juce::uint32 row = musicLib.add(track);
+        addedIds.push_back((long int)track.libraryId);
+        // the journal and index only exist once the library has been loaded
+        if (musicLibJournal != nullptr)
         {
-            Track track = tokeniseMusicLibLine(line);
-            if (track.libraryId > nextLibraryId)
-                nextLibraryId = track.libraryId + 1;
-            musicLib.push_back(track);
+            musicLibJournal->appendAdd(trackToMusicLibLine(track));
+            titleIndex.add(musicLib, row);
         }
     }
     musicLibFile.close();
+    if (skippedLines > 0)
+        std::cout << "PlaylistComponent::importMusicLib: skipped " << skippedLines << " lines of "
+                  << file.getFullPathName() << " that aren't library tracks" << std::endl;
+    if (musicLibJournal != nullptr)
+    {
+        compactMusicLibIfNeeded();
+        analyseTracks(addedIds);
+        tableComponent.updateContent();
+        filterTracksToDisplayByTitle(searchInput.getText().toStdString());
+    }
+    return true;
+}
+
+bool PlaylistComponent::exportMusicLib(const juce::File& file)
+{
+    std::string writeString = "";
+    for (juce::uint32 row : musicLib.getOrder())
+        writeString += trackToMusicLibLine(musicLib.getInfo(row)) + "\n";
+    return LibraryJournal::writeFileDurably(file, writeString);
 }
 
-void PlaylistComponent::saveMusicLib()
+void PlaylistComponent::openExportBrowser()
 {
-    // erases and re-writes the whole file each time to account for order changes etc.
-    std::ofstream musicLibFile;
-    musicLibFile.open(musicLibPath, std::ofstream::trunc);
-    if (musicLibFile.is_open())
+    juce::FileChooser chooser("Export playlist...", juce::File::getCurrentWorkingDirectory(), "*.txt");
+    if (chooser.browseForFileToSave(true))
+    {
+        if (!exportMusicLib(chooser.getResult()))
+            std::cout << "PlaylistComponent::openExportBrowser: could not write " << chooser.getResult().getFullPathName() << std::endl;
+    }
+}
+
+void PlaylistComponent::applyJournalRecord(const LibraryJournal::Record& record)
+{
+    juce::uint32 row = musicLib.findRow(record.libraryId);
+    TrackStore::TrackInfo track;
+    switch (record.type)
+    {
+        case LibraryJournal::Record::add:
+            // records can be replayed twice if a compaction was interrupted
+            if (row != TrackStore::noRow)
+                break;
+            if (!tokeniseMusicLibLine(record.payload, track))
+            {
+                std::cout << "PlaylistComponent::applyJournalRecord: skipped a damaged add of track " << record.libraryId << std::endl;
+                break;
+            }
+            musicLib.add(track);
+            if (record.libraryId >= nextLibraryId)
+                nextLibraryId = record.libraryId + 1;
+            break;
+        case LibraryJournal::Record::remove:
+            if (row != TrackStore::noRow)
+                musicLib.remove(row);
+            break;
+        case LibraryJournal::Record::move:
+            if (row != TrackStore::noRow)
+                musicLib.move(row, record.index);
+            break;
+        case LibraryJournal::Record::set:
+            if (row == TrackStore::noRow)
+                break;
+            if (record.field == "plays")
+            {
+                try
+                {
+                    musicLib.setPlayCount(row, (juce::uint32)std::stoul(record.payload));
+                }
+                catch (const std::exception&)
+                {
+                    std::cout << "PlaylistComponent::applyJournalRecord: skipped a damaged play count of track " << record.libraryId << std::endl;
+                }
+            }
+            // a whole line, for a track whose file changed or moved
+            else if (record.field == "track" || record.field == "file")
+            {
+                if (!tokeniseMusicLibLine(record.payload, track))
+                {
+                    std::cout << "PlaylistComponent::applyJournalRecord: skipped a damaged change to track " << record.libraryId << std::endl;
+                    break;
+                }
+                musicLib.update(row, track);
+            }
+            if (record.field == "track")
+                musicLib.clearAnalysis(row);
+            else if (record.field == "analysis")
+                applyAnalysisJournalValue(row, record.payload);
+            break;
+        case LibraryJournal::Record::clear:
+            musicLib.clear();
+            break;
+    }
+}
+
+void PlaylistComponent::compactMusicLibIfNeeded()
+{
+    if (musicLibJournal->needsCompaction((int)musicLib.size()))
+        compactMusicLib();
+}
+
+void PlaylistComponent::compactMusicLib()
+{
+    // strings of removed and retitled tracks are only released here, before the copy so it doesn't carry them
+    // a mapped file can't be replaced on Windows, so the library lets go of the index it was loaded from first
+    bool releaseIndex = false;
+   #if JUCE_WINDOWS
+    releaseIndex = true;
+   #endif
+    if (releaseIndex || musicLib.hasUnusedStrings())
     {
-        std::string writeString = "";
-        for (Track track : musicLib)
         {
-            std::string writeLine = std::to_string(track.libraryId) + "\t" + track.title.toStdString() + "\t" + std::to_string(track.length) + "\t" + track.trackURL.toString(false).toStdString() + "\n";
-            writeString += writeLine;
+            const SearchWorker::ScopedLibraryChange change(searchWorker);
+            if (releaseIndex)
+                musicLib.releaseIndex();
+            if (musicLib.hasUnusedStrings())
+                musicLib.compactStrings();
         }
-        musicLibFile << writeString;
+        if (searchInput.getText().isNotEmpty())
+            filterTracksToDisplayByTitle(searchInput.getText().toStdString(), false);
     }
-    musicLibFile.close();
+    // the journal thread serialises its own copy, so the library can keep changing
+    TrackStore snapshot = musicLib;
+    musicLibJournal->compact([snapshot] (juce::uint64 journalSequence)
+    {
+        LibraryIndex::Writer writer;
+        writer.setJournalSequence(journalSequence);
+        for (juce::uint32 row : snapshot.getOrder())
+        {
+            TrackStore::TrackInfo track = snapshot.getInfo(row);
+            LibraryIndex::Record record;
+            record.libraryId = track.libraryId;
+            record.dateAdded = track.dateAdded;
+            record.length = track.length;
+            record.bpm = snapshot.getBpm(row);
+            record.loudness = snapshot.getLoudness(row);
+            record.truePeak = snapshot.getTruePeak(row);
+            record.playCount = track.playCount;
+            record.key = snapshot.hasKey(row) ? (juce::uint8)snapshot.getKey(row) : LibraryIndex::noKey;
+            record.analysed = snapshot.isAnalysed(row) ? 1 : 0;
+            record.firstBeat = snapshot.getFirstBeat(row);
+            const TrackStore::MixPoints& mixPoints = snapshot.getMixPoints(row);
+            record.soundStart = mixPoints.soundStart;
+            record.introEnd = mixPoints.introEnd;
+            record.outroStart = mixPoints.outroStart;
+            record.soundEnd = mixPoints.soundEnd;
+            record.fileModified = track.signature.modified;
+            record.fileSize = track.signature.size;
+            record.fileId = track.signature.fileId;
+            writer.addTrack(record, track.title, track.url, track.artist, track.album);
+        }
+        return writer.finish();
+    });
 }
 
-PlaylistComponent::Track PlaylistComponent::tokeniseMusicLibLine(std::string line)
+std::string PlaylistComponent::analysisToJournalValue(juce::uint32 row)
+{
+    std::string value = (musicLib.hasBpm(row) ? std::to_string(musicLib.getBpm(row)) : "-")
+                      + "\t" + (musicLib.hasBeatGrid(row) ? std::to_string(musicLib.getFirstBeat(row)) : "-")
+                      + "\t" + (musicLib.hasKey(row) ? std::to_string(musicLib.getKey(row)) : "-")
+                      + "\t" + (musicLib.hasLoudness(row) ? std::to_string(musicLib.getLoudness(row)) : "-");
+    if (!musicLib.hasMixPoints(row))
+    {
+        value += "\t-\t-\t-\t-";
+    }
+    else
+    {
+        const TrackStore::MixPoints& points = musicLib.getMixPoints(row);
+        value += "\t" + std::to_string(points.soundStart) + "\t" + std::to_string(points.introEnd)
+               + "\t" + std::to_string(points.outroStart) + "\t" + std::to_string(points.soundEnd);
+    }
+    return value + "\t" + (musicLib.hasTruePeak(row) ? std::to_string(musicLib.getTruePeak(row)) : "-");
+}
+
+void PlaylistComponent::applyAnalysisJournalValue(juce::uint32 row, const std::string& value)
+{
+    std::vector<std::string> tokens;
+    std::istringstream iss(value);
+    std::string token;
+    while (std::getline(iss, token, '\t'))
+        tokens.push_back(token);
+    // fields are only ever added to the end, so a record written before a field existed leaves it unknown,
+    // and the track unanalysed so the field is found
+    // every field is read before any is set, so a damaged value leaves the track as it was
+    const float unknownValue = std::numeric_limits<float>::quiet_NaN();
+    float bpm = unknownValue, firstBeat = unknownValue, loudness = unknownValue, truePeak = unknownValue;
+    int key = -1;
+    TrackStore::MixPoints mixPoints;
+    try
+    {
+        if (tokens.size() > 0 && tokens[0] != "-")
+            bpm = std::stof(tokens[0]);
+        if (tokens.size() > 1 && tokens[1] != "-")
+            firstBeat = std::stof(tokens[1]);
+        if (tokens.size() > 2 && tokens[2] != "-")
+            key = std::stoi(tokens[2]);
+        if (tokens.size() > 3 && tokens[3] != "-")
+            loudness = std::stof(tokens[3]);
+        if (tokens.size() > 7 && tokens[4] != "-")
+            mixPoints = { std::stof(tokens[4]), std::stof(tokens[5]), std::stof(tokens[6]), std::stof(tokens[7]) };
+        if (tokens.size() > 8 && tokens[8] != "-")
+            truePeak = std::stof(tokens[8]);
+    }
+    catch (const std::exception&)
+    {
+        std::cout << "PlaylistComponent::applyAnalysisJournalValue: skipped a damaged analysis of track " << musicLib.getLibraryId(row) << std::endl;
+        return;
+    }
+    if (!std::isnan(bpm))
+        musicLib.setBpm(row, bpm);
+    if (!std::isnan(firstBeat))
+        musicLib.setFirstBeat(row, firstBeat);
+    if (key >= 0 && key < 24)
+        musicLib.setKey(row, key);
+    if (!std::isnan(loudness))
+        musicLib.setLoudness(row, loudness);
+    if (!std::isnan(mixPoints.soundStart))
+        musicLib.setMixPoints(row, mixPoints);
+    if (!std::isnan(truePeak))
+        musicLib.setTruePeak(row, truePeak);
+    if (tokens.size() > 8)
+        musicLib.setAnalysed(row);
+}
+
+std::string PlaylistComponent::trackToMusicLibLine(const TrackStore::TrackInfo& track)
+{
+    return std::to_string(track.libraryId) + "\t" + track.title + "\t" + std::to_string(track.length) + "\t" + track.url
+         + "\t" + std::to_string(track.dateAdded) + "\t" + std::to_string(track.playCount)
+         + "\t" + track.artist + "\t" + track.album
+         + "\t" + std::to_string(track.signature.modified) + "\t" + std::to_string(track.signature.size)
+         + "\t" + std::to_string(track.signature.fileId);
+}
+
+bool PlaylistComponent::tokeniseMusicLibLine(const std::string& line, TrackStore::TrackInfo& trackFromLine)
 {
-    Track trackFromLine;
     std::vector<std::string> tokens;
     std::istringstream iss(line);
     std::string token;
@@ -392,32 +917,199 @@ PlaylistComponent::Track PlaylistComponent::tokeniseMusicLibLine(std::string lin
     {
         tokens.push_back(token);
     }
-    trackFromLine.libraryId = std::stol(tokens[0]);
-    trackFromLine.title = juce::String(tokens[1]);
-    trackFromLine.length = std::stof(tokens[2]);
-    trackFromLine.trackURL = juce::URL(tokens[3]);
-    return trackFromLine;
+    // every line has at least an id, title, length and url
+    if (tokens.size() < 4)
+        return false;
+    try
+    {
+        trackFromLine.libraryId = std::stol(tokens[0]);
+        trackFromLine.title = tokens[1];
+        trackFromLine.length = std::stof(tokens[2]);
+        trackFromLine.url = tokens[3];
+        // the fields after the url were added later, older files stop at the url or the play count
+        if (tokens.size() > 4)
+            trackFromLine.dateAdded = std::stoll(tokens[4]);
+        if (tokens.size() > 5)
+            trackFromLine.playCount = (juce::uint32)std::stoul(tokens[5]);
+        if (tokens.size() > 6)
+            trackFromLine.artist = tokens[6];
+        if (tokens.size() > 7)
+            trackFromLine.album = tokens[7];
+        if (tokens.size() > 10)
+        {
+            trackFromLine.signature.modified = std::stoll(tokens[8]);
+            trackFromLine.signature.size = std::stoll(tokens[9]);
+            trackFromLine.signature.fileId = std::stoull(tokens[10]);
+        }
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return true;
 }
 
 void PlaylistComponent::loadFileToMusicLib(juce::File file)
 {
-    auto* testReader = formatManager->createReaderFor(file);
-    if (testReader != nullptr)
+    TrackStore::TrackInfo track;
+    if (LibraryImporter::probe(file, *formatManager, track))
     {
-        juce::File fileToAdd = File{file};
-        Track track;
         track.libraryId = nextLibraryId;
-        track.title = fileToAdd.getFileName();
-        track.trackURL = URL{File{file}};
-        track.length = testReader->lengthInSamples / testReader->sampleRate;
-        musicLib.push_back(track);
+        {
+            const SearchWorker::ScopedLibraryChange change(searchWorker);
+            titleIndex.add(musicLib, musicLib.add(track));
+        }
         tableComponent.updateContent();
         repaint();
-        saveMusicLib();
+        musicLibJournal->appendAdd(trackToMusicLibLine(track));
+        compactMusicLibIfNeeded();
         ++nextLibraryId;
+        analyseTracks({ (long int)track.libraryId });
         filterTracksToDisplayByTitle(searchInput.getText().toStdString());
     }
-    delete testReader;
+}
+
+void PlaylistComponent::startImport(const juce::StringArray& paths)
+{
+    std::vector<std::string> knownURLs;
+    knownURLs.reserve(musicLib.getOrder().size());
+    for (juce::uint32 row : musicLib.getOrder())
+        knownURLs.push_back(musicLib.getURLString(row));
+    libraryImporter.import(paths, knownURLs);
+    // dropped folders are watched from now on, dropped files are only imported
+    for (const juce::String& path : paths)
+        if (juce::File(path).isDirectory())
+            libraryWatcher.watch(juce::File(path));
+    importProgressValue = -1.0;
+    importProgress.setTextToDisplay("finding audio files...");
+    importProgress.setVisible(true);
+    cancelImport.setVisible(true);
+}
+
+void PlaylistComponent::addImportedTracks(std::vector<TrackStore::TrackInfo>& tracks)
+{
+    std::vector<std::string> lines;
+    std::vector<long int> addedIds;
+    {
+        const SearchWorker::ScopedLibraryChange change(searchWorker);
+        for (TrackStore::TrackInfo& track : tracks)
+        {
+            track.libraryId = nextLibraryId++;
+            titleIndex.add(musicLib, musicLib.add(track));
+            lines.push_back(trackToMusicLibLine(track));
+            addedIds.push_back((long int)track.libraryId);
+        }
+    }
+    musicLibJournal->appendAdd(lines);
+    // each batch is queued as it arrives, the analyser holds bulk tracks back until the app has started
+    analyseTracks(addedIds);
+    importProgressValue = libraryImporter.getProgress();
+    importProgress.setTextToDisplay("imported " + juce::String(libraryImporter.getNumProbed()) + " of " + juce::String(libraryImporter.getNumFound()));
+    tableComponent.updateContent();
+    filterTracksToDisplayByTitle(searchInput.getText().toStdString());
+}
+
+void PlaylistComponent::finishImport(bool wasCancelled)
+{
+    if (wasCancelled)
+        std::cout << "PlaylistComponent::finishImport: import cancelled after " << libraryImporter.getNumProbed() << " of " << libraryImporter.getNumFound() << " files" << std::endl;
+    importProgress.setVisible(false);
+    cancelImport.setVisible(false);
+    // the journal already holds every batch, writing the index now leaves it empty again
+    compactMusicLib();
+}
+
+void PlaylistComponent::applyLibraryChanges(std::vector<LibraryWatcher::Change>& changes)
+{
+    std::vector<std::string> addedLines;
+    std::vector<long int> addedIds, removedIds;
+    // changed and moved tracks are journalled as whole lines, field "track" or "file"
+    std::vector<long int> setIds;
+    std::vector<std::string> setFields, setLines;
+    {
+        const SearchWorker::ScopedLibraryChange change(searchWorker);
+        // a folder that was just dropped can be scanned while it is still being imported
+        std::set<std::string> knownURLs;
+        for (const LibraryWatcher::Change& libraryChange : changes)
+        {
+            if (libraryChange.type == LibraryWatcher::Change::added)
+            {
+                for (juce::uint32 row : musicLib.getOrder())
+                    knownURLs.insert(musicLib.getURLString(row));
+                break;
+            }
+        }
+        std::vector<juce::uint32> retitledRows;
+        for (LibraryWatcher::Change& libraryChange : changes)
+        {
+            TrackStore::TrackInfo& track = libraryChange.track;
+            if (libraryChange.type == LibraryWatcher::Change::added)
+            {
+                if (!knownURLs.insert(track.url).second)
+                    continue;
+                track.libraryId = nextLibraryId++;
+                titleIndex.add(musicLib, musicLib.add(track));
+                addedLines.push_back(trackToMusicLibLine(track));
+                addedIds.push_back(track.libraryId);
+                continue;
+            }
+            // the track may have been removed since the scan started
+            juce::uint32 row = musicLib.findRow(track.libraryId);
+            if (row == TrackStore::noRow)
+                continue;
+            if (libraryChange.type == LibraryWatcher::Change::removed)
+            {
+                removedIds.push_back(track.libraryId);
+                continue;
+            }
+            TrackStore::TrackInfo current = musicLib.getInfo(row);
+            if (libraryChange.type == LibraryWatcher::Change::changed)
+            {
+                // new tags and length, but the same track to the library
+                track.dateAdded = current.dateAdded;
+                track.playCount = current.playCount;
+                musicLib.update(row, track);
+                musicLib.clearAnalysis(row);
+                setFields.push_back("track");
+                setLines.push_back(trackToMusicLibLine(track));
+                if (track.title != current.title)
+                    retitledRows.push_back(row);
+            }
+            else
+            {
+                current.url = track.url;
+                current.signature = track.signature;
+                musicLib.update(row, current);
+                setFields.push_back("file");
+                setLines.push_back(trackToMusicLibLine(current));
+            }
+            setIds.push_back(track.libraryId);
+        }
+        if (!retitledRows.empty())
+        {
+            titleIndex.remove(retitledRows);
+            for (juce::uint32 row : retitledRows)
+                titleIndex.add(musicLib, row);
+        }
+    }
+    if (!addedLines.empty())
+        musicLibJournal->appendAdd(addedLines);
+    for (size_t i = 0; i < setIds.size(); ++i)
+        musicLibJournal->appendSet(setIds[i], setFields[i], setLines[i]);
+    // removing refreshes the display and search itself
+    // new and changed files need analysing, and a moved one waiting to be is queued again with its new url
+    // removed tracks drop out of their groups when shown
+    addedIds.insert(addedIds.end(), setIds.begin(), setIds.end());
+    if (!addedIds.empty())
+        analyseTracks(addedIds);
+    if (!removedIds.empty())
+    {
+        removeFromLibrary(removedIds);
+        return;
+    }
+    compactMusicLibIfNeeded();
+    tableComponent.updateContent();
+    filterTracksToDisplayByTitle(searchInput.getText().toStdString());
 }
 
 /* ========================================== */
@@ -442,16 +1134,9 @@ void PlaylistComponent::engageAutoplay()
             for (int i = 0; i < deckGUIs.size(); ++i)
             {
                 DeckGUI* dG = deckGUIs[i];
-                if (!dG->fileLoaded)
-                {
-                    Track temp = musicLib[0];
-                    dG->loadFile(temp.trackURL);
-                    dG->currentTrackName = temp.title;
-                    musicLib.erase(musicLib.begin());
-                    musicLib.push_back(temp);
-                    saveMusicLib();
-                    filterTracksToDisplayByTitle(searchInput.getText().toStdString());
-                }
+                juce::uint32 next = dG->fileLoaded ? TrackStore::noRow : takeNextTrack();
+                if (next != TrackStore::noRow)
+                    loadToDeck(dG, next);
             }
             if (!deckGUIs[0]->isPlaying() && !deckGUIs[1]->isPlaying())
                 deckGUIs[0]->play();
@@ -461,10 +1146,54 @@ void PlaylistComponent::engageAutoplay()
         autoPlay.setToggleState(false, juce::NotificationType::dontSendNotification);
 }
 
+juce::uint32 PlaylistComponent::takeNextTrack()
+{
+    while (!playQueue.isEmpty())
+    {
+        juce::uint32 row = musicLib.findRow(playQueue.pop());
+        if (row != TrackStore::noRow && musicLib.isPlayable(row))
+            return row;
+    }
+    // at most once round the library, in case nothing in it can be played
+    juce::uint32 repeat = TrackStore::noRow;
+    for (int tried = 0; tried < musicLib.size(); ++tried)
+    {
+        int position = playQueue.getLibraryPosition() % musicLib.size();
+        playQueue.setLibraryPosition(position + 1);
+        juce::uint32 row = musicLib.rowAt(position);
+        if (!musicLib.isPlayable(row))
+            continue;
+        if (!isRepeat(row))
+            return row;
+        if (repeat == TrackStore::noRow)
+            repeat = row;
+    }
+    return repeat;
+}
+
+void PlaylistComponent::queueTracks(const std::vector<long int>& trackIds, bool playNext)
+{
+    if (playNext)
+    {
+        // pushed to the front last first, so they play in the order given
+        for (auto libraryId = trackIds.rbegin(); libraryId != trackIds.rend(); ++libraryId)
+            playQueue.pushFront(*libraryId);
+    }
+    else
+    {
+        for (long int libraryId : trackIds)
+            playQueue.push(libraryId);
+    }
+    playQueue.save(juce::File::getCurrentWorkingDirectory().getChildFile(playQueuePath));
+    analyseTracks(trackIds, TrackAnalyser::queued);
+}
+
 void PlaylistComponent::triggerAutoCrossfade()
 {
     autoCrossfadeInc = crossfade.getRange().getLength()/(crossfadeTime.getValue()/10) * (1 - (2 * std::round(crossfade.getValue())));
     autoCrossfadeToggle = true;
+    lastCrossfadeFrameMs = -1;
+    frameScheduler->wake();
     for (DeckGUI* dg : deckGUIs)
         if (!dg->isPlaying()) {dg->play();}
 }
@@ -490,28 +1219,226 @@ juce::String PlaylistComponent::lengthToMinutesAndSeconds(float length)
     return minAndSec;
 }
 
-void PlaylistComponent::filterTracksToDisplayByTitle(std::string searchTerm)
+void PlaylistComponent::filterTracksToDisplayByTitle(std::string searchTerm, bool debounce)
 {
-    if (searchTerm == "")
+    if (duplicates.getToggleState())
     {
-        tracksToDisplay.clear();
-        tracksToDisplay = musicLib;
+        searchWorker.cancel();
+        showDuplicates();
+    }
+    else if (searchTerm == "")
+    {
+        searchWorker.cancel();
+        tracksToDisplay = musicLib.getOrder();
+        applySort();
+        tableComponent.updateContent();
+        repaint();
     }
     else
+        searchWorker.request(searchTerm, (SearchWorker::Mode)(searchMode.getSelectedId() - 1), debounce);
+}
+
+void PlaylistComponent::showBpmPool()
+{
+    DeckGUI* source = nullptr;
+    for (DeckGUI* dg : deckGUIs)
+        if (dg->fileLoaded && dg->bpm > 0 && (source == nullptr || dg->isPlaying()))
+            source = dg;
+    if (source == nullptr)
+        return;
+    // +/- 3% is about as far as a track can be pitched without sounding off
+    juce::String pool = "bpm:" + juce::String(source->bpm * 0.97, 1) + "-" + juce::String(source->bpm * 1.03, 1);
+    searchMode.setSelectedId(SearchWorker::contains + 1, juce::dontSendNotification);
+    duplicates.setToggleState(false, juce::dontSendNotification);
+    searchInput.setText(pool, false);
+    filterTracksToDisplayByTitle(pool.toStdString());
+}
+
+void PlaylistComponent::showSearchResults(const SearchWorker::Results& results)
+{
+    if (results.generation != musicLib.getGeneration() || duplicates.getToggleState())
+        return;
+    tracksToDisplay = results.rows;
+    applySort();
+    tableComponent.updateContent();
+    repaint();
+}
+
+void PlaylistComponent::applySort()
+{
+    if (!sortKeys.empty() && !duplicates.getToggleState())
+        rowSorter.sort(tracksToDisplay, sortKeys, musicLib, titleIndex);
+}
+
+void PlaylistComponent::analyseNewTracks()
+{
+    std::vector<TrackAnalyser::Track> tracks;
+    for (juce::uint32 row : musicLib.getOrder())
+        if (!musicLib.isAnalysed(row))
+            tracks.push_back({ (long int)musicLib.getLibraryId(row), musicLib.getURLString(row), musicLib.getSignature(row) });
+    trackAnalyser.analyse(tracks);
+}
+
+void PlaylistComponent::analyseTracks(const std::vector<long int>& trackIds, TrackAnalyser::Priority priority)
+{
+    std::vector<TrackAnalyser::Track> tracks;
+    for (long int libraryId : trackIds)
     {
-        tracksToDisplay.clear();
-        std::regex regexSearchTerm(searchTerm, std::regex_constants::icase);
-        // perform linear search on tracks vector testing for match
-        for (Track track : musicLib)
+        juce::uint32 row = musicLib.findRow(libraryId);
+        if (row != TrackStore::noRow && !musicLib.isAnalysed(row))
+            tracks.push_back({ libraryId, musicLib.getURLString(row), musicLib.getSignature(row) });
+    }
+    if (!tracks.empty())
+        trackAnalyser.analyse(tracks, priority);
+}
+
+void PlaylistComponent::applyAnalyses(std::vector<TrackAnalyser::Analysis>& analyses)
+{
+    std::vector<long int> analysedIds;
+    std::vector<std::string> values;
+    {
+        const SearchWorker::ScopedLibraryChange change(searchWorker);
+        for (TrackAnalyser::Analysis& analysis : analyses)
+        {
+            juce::uint32 row = musicLib.findRow(analysis.libraryId);
+            if (row == TrackStore::noRow || musicLib.getSignature(row) != analysis.signature)
+                continue;
+            // an unreadable file is kept without a fingerprint, and analysed again the next time the app starts
+            duplicateFinder.addFingerprint(analysis.libraryId, analysis.signature, std::move(analysis.fingerprint));
+            if (!analysis.decoded)
+                continue;
+            if (!std::isnan(analysis.bpm))
+                musicLib.setBpm(row, analysis.bpm);
+            if (!std::isnan(analysis.firstBeat))
+                musicLib.setFirstBeat(row, analysis.firstBeat);
+            if (analysis.key >= 0)
+                musicLib.setKey(row, analysis.key);
+            if (!std::isnan(analysis.loudness))
+                musicLib.setLoudness(row, analysis.loudness);
+            if (!std::isnan(analysis.truePeak))
+                musicLib.setTruePeak(row, analysis.truePeak);
+            if (!std::isnan(analysis.mixPoints.soundStart))
+                musicLib.setMixPoints(row, analysis.mixPoints);
+            musicLib.setAnalysed(row);
+            analysedIds.push_back(analysis.libraryId);
+            values.push_back(analysisToJournalValue(row));
+        }
+    }
+    for (size_t i = 0; i < analysedIds.size(); ++i)
+        musicLibJournal->appendSet(analysedIds[i], "analysis", values[i]);
+    compactMusicLibIfNeeded();
+    tableComponent.repaint();
+    // the change dropped any search under way or showing, and a bpm or key filter may now match more tracks
+    if (searchInput.getText().isNotEmpty())
+        filterTracksToDisplayByTitle(searchInput.getText().toStdString(), false);
+    // a track loaded before it was analysed shows its key and hands off at its outro as soon as they are known,
+    // and is normalised if it hasn't started, a playing track isn't changed in level under the DJ
+    for (DeckGUI* dG : deckGUIs)
+    {
+        if (std::find(analysedIds.begin(), analysedIds.end(), dG->currentLibraryId) == analysedIds.end())
+            continue;
+        juce::uint32 row = musicLib.findRow(dG->currentLibraryId);
+        dG->currentTrackKey = getCamelotKey(row);
+        setDeckMixPoints(dG, row);
+        if (!dG->isPlaying())
+            dG->setTrackLoudness(musicLib.getLoudness(row), musicLib.getTruePeak(row));
+        dG->repaint();
+    }
+}
+
+void PlaylistComponent::findDuplicates()
+{
+    std::vector<DuplicateFinder::Track> tracks;
+    tracks.reserve(musicLib.getOrder().size());
+    for (juce::uint32 row : musicLib.getOrder())
+        tracks.push_back({ (long int)musicLib.getLibraryId(row), musicLib.getSignature(row) });
+    duplicateFinder.findDuplicates(tracks);
+}
+
+void PlaylistComponent::setDuplicateGroups(std::vector<std::vector<long int>>& groups)
+{
+    duplicateGroups.swap(groups);
+    duplicateGroupOf.clear();
+    for (size_t group = 0; group < duplicateGroups.size(); ++group)
+        for (long int libraryId : duplicateGroups[group])
+            duplicateGroupOf[libraryId] = group;
+    if (duplicates.getToggleState())
+        showDuplicates();
+}
+
+void PlaylistComponent::showDuplicates()
+{
+    tracksToDisplay.clear();
+    displayGroups.clear();
+    size_t shownGroups = 0;
+    for (const std::vector<long int>& group : duplicateGroups)
+    {
+        std::vector<juce::uint32> rows;
+        for (long int libraryId : group)
         {
-            if (std::regex_search(track.title.toStdString(), regexSearchTerm))
-                tracksToDisplay.push_back(track);
+            juce::uint32 row = musicLib.findRow(libraryId);
+            if (row != TrackStore::noRow)
+                rows.push_back(row);
         }
+        if (rows.size() < 2)
+            continue;
+        tracksToDisplay.insert(tracksToDisplay.end(), rows.begin(), rows.end());
+        displayGroups.insert(displayGroups.end(), rows.size(), shownGroups++);
     }
     tableComponent.updateContent();
     repaint();
 }
 
+bool PlaylistComponent::isRepeat(juce::uint32 row)
+{
+    long int libraryId = (long int)musicLib.getLibraryId(row);
+    auto group = duplicateGroupOf.find(libraryId);
+    if (group == duplicateGroupOf.end())
+        return false;
+    for (long int duplicateId : duplicateGroups[group->second])
+        if (duplicateId != libraryId && playedThisSession.count(duplicateId) > 0)
+            return true;
+    return false;
+}
+
+juce::String PlaylistComponent::getCamelotKey(juce::uint32 row)
+{
+    if (row == TrackStore::noRow || !musicLib.hasKey(row))
+        return {};
+    return juce::String(LibraryQuery::keyToCamelot(musicLib.getKey(row))) + (musicLib.getKey(row) < 12 ? "B" : "A");
+}
+
+void PlaylistComponent::loadToDeck(DeckGUI* deck, juce::uint32 row)
+{
+    deck->loadFile(musicLib.getURL(row), musicLib.getLoudness(row), musicLib.getTruePeak(row));
+    deck->currentTrackName = musicLib.getTitle(row);
+    deck->currentLibraryId = (long int)musicLib.getLibraryId(row);
+    deck->currentTrackKey = getCamelotKey(row);
+    setDeckMixPoints(deck, row);
+    deck->toTrackStart();
+    countPlay(row);
+}
+
+void PlaylistComponent::setDeckMixPoints(DeckGUI* deck, juce::uint32 row)
+{
+    if (row == TrackStore::noRow || !musicLib.hasMixPoints(row))
+        return;
+    const TrackStore::MixPoints& points = musicLib.getMixPoints(row);
+    const double crossfadeSeconds = crossfadeTime.getValue() / 1000;
+    deck->setMixPoints(points.soundStart, juce::jmin((double)points.outroStart, points.soundEnd - crossfadeSeconds));
+}
+
+void PlaylistComponent::countPlay(juce::uint32 row)
+{
+    // play counts don't change the rows or their order, so searches under way are left to finish
+    musicLib.setPlayCount(row, musicLib.getPlayCount(row) + 1);
+    playedThisSession.insert((long int)musicLib.getLibraryId(row));
+    musicLibJournal->appendSet((long int)musicLib.getLibraryId(row), "plays", std::to_string(musicLib.getPlayCount(row)));
+    compactMusicLibIfNeeded();
+    tableComponent.repaint();
+    analyseTracks({ (long int)musicLib.getLibraryId(row) }, TrackAnalyser::loaded);
+}
+
 void PlaylistComponent::loadIfNotPlaying(int index)
 {
     // if track double clicked, load to a player if it's not playing
@@ -521,30 +1448,157 @@ void PlaylistComponent::loadIfNotPlaying(int index)
     else if (!deckGUIs[1]->isPlaying())
         playerTarget = 1;
     if (playerTarget > -1)
+        loadToDeck(deckGUIs[playerTarget], tracksToDisplay[index]);
+}
+
+void PlaylistComponent::removeFromLibrary(const std::vector<long int>& trackIds)
+{
+    std::vector<juce::uint32> rows;
+    std::vector<long int> removedIds;
+    std::vector<juce::int64> thumbnailHashes;
+    for (long int libraryId : trackIds)
+    {
+        juce::uint32 row = musicLib.findRow(libraryId);
+        if (row != TrackStore::noRow)
+        {
+            rows.push_back(row);
+            removedIds.push_back(libraryId);
+            thumbnailHashes.push_back(ThumbnailDiskCache::getHash(musicLib.getURL(row)));
+        }
+    }
+    if (!rows.empty())
+    {
+        {
+            const SearchWorker::ScopedLibraryChange change(searchWorker);
+            titleIndex.remove(rows);
+            musicLib.remove(rows);
+        }
+        // the rows can be reused, so they go from the display now rather than when the search returns
+        std::set<juce::uint32> removedRows(rows.begin(), rows.end());
+        tracksToDisplay.erase(std::remove_if(tracksToDisplay.begin(), tracksToDisplay.end(),
+                                             [&removedRows] (juce::uint32 row) { return removedRows.count(row) > 0; }),
+                              tracksToDisplay.end());
+        tableComponent.deselectAllRows();
+        tableComponent.updateContent();
+        musicLibJournal->appendRemove(removedIds);
+        compactMusicLibIfNeeded();
+        // the thumbnails would otherwise be kept for files the library no longer has
+        for (juce::int64 hash : thumbnailHashes)
+            ThumbnailDiskCache::deleteThumbnail(thumbnailFolder, hash);
+    }
+    filterTracksToDisplayByTitle(searchInput.getText().toStdString());
+}
+
+void PlaylistComponent::moveInLibrary(const std::vector<long int>& trackIds, int index)
+{
+    std::vector<juce::uint32> rows;
+    for (long int libraryId : trackIds)
+    {
+        juce::uint32 row = musicLib.findRow(libraryId);
+        if (row != TrackStore::noRow)
+            rows.push_back(row);
+    }
+    if (rows.empty())
+        return;
     {
-        deckGUIs[playerTarget]->currentTrackName = tracksToDisplay[index].title;
-        deckGUIs[playerTarget]->loadFile(tracksToDisplay[index].trackURL);
+        const SearchWorker::ScopedLibraryChange change(searchWorker);
+        musicLib.move(rows, index);
     }
+    // journal the block in its new library order, which is where it now starts
+    std::set<juce::uint32> movedRows(rows.begin(), rows.end());
+    std::vector<long int> movedIds;
+    int firstPosition = -1;
+    const std::vector<juce::uint32>& order = musicLib.getOrder();
+    for (size_t position = 0; position < order.size(); ++position)
+    {
+        if (movedRows.count(order[position]) == 0)
+            continue;
+        if (firstPosition < 0)
+            firstPosition = (int)position;
+        movedIds.push_back((long int)musicLib.getLibraryId(order[position]));
+    }
+    musicLibJournal->appendMove(movedIds, firstPosition);
+    compactMusicLibIfNeeded();
+    filterTracksToDisplayByTitle(searchInput.getText().toStdString());
 }
 
-void PlaylistComponent::removeFromLibrary(long int libraryIdToRemove)
+void PlaylistComponent::resetPlayCounts(const std::vector<long int>& trackIds)
 {
-    // linear search through musicLib, remove track with this unique id
-    for (int i = 0; i < musicLib.size(); ++i)
+    std::vector<long int> resetIds;
+    for (long int libraryId : trackIds)
     {
-        if (musicLib[i].libraryId == libraryIdToRemove)
+        juce::uint32 row = musicLib.findRow(libraryId);
+        if (row != TrackStore::noRow)
         {
-            musicLib.erase(musicLib.begin() + i);
-            break;
+            musicLib.setPlayCount(row, 0);
+            resetIds.push_back(libraryId);
         }
     }
-    saveMusicLib();
-    filterTracksToDisplayByTitle(searchInput.getText().toStdString());
+    if (resetIds.empty())
+        return;
+    musicLibJournal->appendSet(resetIds, "plays", "0");
+    compactMusicLibIfNeeded();
+    applySort();
+    tableComponent.updateContent();
+    repaint();
+}
+
+std::vector<long int> PlaylistComponent::getSelectedTrackIds()
+{
+    std::vector<long int> trackIds;
+    juce::SparseSet<int> selected = tableComponent.getSelectedRows();
+    for (int i = 0; i < selected.getNumRanges(); ++i)
+    {
+        juce::Range<int> range = selected.getRange(i);
+        for (int rowNumber = range.getStart(); rowNumber < range.getEnd(); ++rowNumber)
+            if (rowNumber >= 0 && rowNumber < (int)tracksToDisplay.size())
+                trackIds.push_back((long int)musicLib.getLibraryId(tracksToDisplay[rowNumber]));
+    }
+    return trackIds;
+}
+
+void PlaylistComponent::showSelectionMenu(int rowNumber)
+{
+    if (!tableComponent.isRowSelected(rowNumber))
+        tableComponent.selectRow(rowNumber);
+    std::vector<long int> trackIds = getSelectedTrackIds();
+    juce::String tracks = trackIds.size() == 1 ? "track" : juce::String((int)trackIds.size()) + " tracks";
+    juce::PopupMenu menu;
+    menu.addItem(5, "Play " + tracks + " next");
+    menu.addItem(6, "Add " + tracks + " to play queue");
+    menu.addSeparator();
+    menu.addItem(1, "Move " + tracks + " to top of library");
+    menu.addItem(2, "Move " + tracks + " to end of library");
+    menu.addItem(3, "Reset play count of " + tracks);
+    menu.addSeparator();
+    menu.addItem(4, "Remove " + tracks);
+    menu.showMenuAsync(juce::PopupMenu::Options(), [this, trackIds] (int result)
+    {
+        if (result == 1)
+            moveInLibrary(trackIds, 0);
+        else if (result == 2)
+            moveInLibrary(trackIds, musicLib.size());
+        else if (result == 3)
+            resetPlayCounts(trackIds);
+        else if (result == 4)
+            removeFromLibrary(trackIds);
+        else if (result == 5 || result == 6)
+            queueTracks(trackIds, result == 5);
+    });
 }
 
 void PlaylistComponent::emptyPlaylist()
 {
-    musicLib.clear();
-    saveMusicLib();
+    {
+        const SearchWorker::ScopedLibraryChange change(searchWorker);
+        titleIndex.clear();
+        musicLib.clear();
+    }
+    musicLibJournal->appendClear();
+    compactMusicLibIfNeeded();
+    // the folders would only fill the library again as files in them change
+    libraryWatcher.unwatchAll();
+    trackAnalyser.cancel();
+    findDuplicates();
     filterTracksToDisplayByTitle("");
 }
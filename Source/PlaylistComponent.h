@@ -14,8 +14,23 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <unordered_map>
+#include <unordered_set>
 #include "DJAudioPlayer.h"
 #include "DeckGUI.h"
+#include "FrameScheduler.h"
+#include "LibraryJournal.h"
+#include "LibraryIndex.h"
+#include "TrackStore.h"
+#include "TitleSearchIndex.h"
+#include "SearchWorker.h"
+#include "RowSorter.h"
+#include "PlayQueue.h"
+#include "LibraryImporter.h"
+#include "LibraryWatcher.h"
+#include "TrackValidator.h"
+#include "TrackAnalyser.h"
+#include "DuplicateFinder.h"
 
 //==============================================================================
 /*
@@ -25,10 +40,12 @@ class PlaylistComponent  :  public juce::Component,
                             public juce::FileDragAndDropTarget,
                             public juce::TextEditor::Listener,
                             public juce::ChangeListener,
-                            public juce::Timer
+                            public FrameScheduler::Client
 {
 public:
     PlaylistComponent(juce::AudioFormatManager &formatManagerToUse,
+                      FrameScheduler &_frameScheduler,
+                      const juce::File &_thumbnailFolder,
                       DJAudioPlayer &_player1,
                       DeckGUI* &_deckGUI1,
                       DJAudioPlayer &_player2,
@@ -78,15 +95,24 @@ private:
     void returnKeyPressed(int lastRowSelected) override;
     void deleteKeyPressed(int lastRowSelected) override;
     void backgroundClicked(const MouseEvent &mEv) override; // enable file load when clicking on empty playlist
+    // adds the clicked column to the front of PlaylistComponent::sortKeys and re-sorts the playlist
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override;
     // TextEditor::Listener virtual methods */
     void textEditorTextChanged (juce::TextEditor &) override;
-    // Timer pure virtual methods */
-    void timerCallback() override;
+    // FrameScheduler::Client pure virtual methods */
+    /**
+     PlaylistComponent::frameCallback()
+     Input                  double frame time in ms
+     Output                 bool
+     Advances the auto crossfade by the time elapsed since the last frame
+     Returns true while an auto crossfade is in progress
+     */
+    bool frameCallback(double frameTimeMs) override;
     // ChangeListener pure virtual methods */
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     // FileDragAndDropTarget pure virtual methods */
     bool isInterestedInFileDrag (const StringArray &files) override;
-    // passes dropped files to PlaylistComponent::loadFileToMusicLib
+    // passes dropped files and folders to PlaylistComponent::startImport, or PlaylistComponent::importMusicLib for library files
     void filesDropped (const StringArray &files, int x, int y) override;
     
     /* ======================== */
@@ -96,14 +122,21 @@ private:
     // juce derived properties */
     /** manage audio formats */
     juce::AudioFormatManager* formatManager;
-    /** cache for waveform display */
-    juce::AudioThumbnailCache thumbcache{100};
+    /** app frame tick, drives the auto crossfade */
+    FrameScheduler* frameScheduler;
+    /** made with every analysis pipeline's thumbnail, so the pipelines don't each start a cache thread */
+    juce::AudioThumbnailCache thumbcache{1};
     /** table model for playlist */
     juce::TableListBox tableComponent;
     // playlist GUI element components */
-    juce::Slider crossfade, crossfadeTime{juce::Slider::Rotary, juce::Slider::TextBoxLeft};
-    juce::TextButton autoPlay{"auto play"}, autoCrossfade{"auto crossfade"}, loadToPlaylist{"add to playlist"}, clearPlaylist{"clear playlist"};
+    juce::Slider crossfade, crossfadeTime{juce::Slider::Rotary, juce::Slider::TextBoxLeft}, targetLoudness{juce::Slider::Rotary, juce::Slider::TextBoxLeft};
+    juce::TextButton autoPlay{"auto play"}, autoCrossfade{"auto crossfade"}, loadToPlaylist{"add to playlist"}, clearPlaylist{"clear playlist"}, exportPlaylist{"export playlist"}, bpmPool{"bpm pool"}, duplicates{"duplicates"};
     juce::TextEditor searchInput;
+    juce::ComboBox searchMode;
+    /** progress of a folder import, -1 while folders are being walked, shown over the foot of the table */
+    double importProgressValue = -1.0;
+    juce::ProgressBar importProgress{importProgressValue};
+    juce::TextButton cancelImport{"cancel import"};
     
     /* ===== native properties ===== */
     
@@ -111,19 +144,37 @@ private:
     juce::Colour controllerBackground, controllerBody, controllerIndicator, infoTextColour, warningTextColour;
     
   /* ===== music library ===== */
-    /** structure for storing tracks in music library */
-    struct Track
-    {
-    public:
-        long int        libraryId;
-        juce::URL       trackURL;
-        juce::String    title;
-        float           length;     //in seconds
-    };
-    /** vector of all tracks in music library */
-    std::vector<Track> musicLib;
-    /** vector of tracks to be displayed in the playlist */
-    std::vector<Track> tracksToDisplay;
+    /** all tracks in music library */
+    TrackStore musicLib;
+    /** TrackStore rows of the tracks to be displayed in the playlist */
+    std::vector<juce::uint32> tracksToDisplay;
+    /** search index over the titles in musicLib, kept in step with every add and remove */
+    TitleSearchIndex titleIndex;
+    /** runs searches of musicLib in the background, changes to musicLib and titleIndex go through its lock */
+    SearchWorker searchWorker{musicLib, titleIndex};
+    /** orders PlaylistComponent::tracksToDisplay by the columns in PlaylistComponent::sortKeys */
+    RowSorter rowSorter;
+    /** columns the playlist is sorted by, the most recently clicked first, empty for library order */
+    std::vector<RowSorter::SortKey> sortKeys;
+    /** probes dropped files and folders in the background */
+    LibraryImporter libraryImporter{*formatManager};
+    /** keeps the library in step with the folders dropped on the playlist */
+    LibraryWatcher libraryWatcher{*formatManager, juce::File::getCurrentWorkingDirectory().getChildFile("watchedFolders.txt")};
+    /** checks at startup that every track can still be played, so autoplay can skip the ones that can't */
+    TrackValidator trackValidator{*formatManager};
+    /** decodes each track once in the background for its waveform thumbnail, tempo, beat grid and fingerprint */
+    TrackAnalyser trackAnalyser{*formatManager};
+    /** groups tracks whose fingerprints show they are the same recording */
+    DuplicateFinder duplicateFinder{juce::File::getCurrentWorkingDirectory().getChildFile("fingerprints.bin")};
+    /** library ids of the tracks in each group of duplicates, and the group each of them is in */
+    std::vector<std::vector<long int>> duplicateGroups;
+    std::unordered_map<long int, size_t> duplicateGroupOf;
+    /** group of each row of PlaylistComponent::tracksToDisplay while PlaylistComponent::duplicates is toggled on */
+    std::vector<size_t> displayGroups;
+    /** library ids of the tracks loaded to a deck since the app started */
+    std::unordered_set<long int> playedThisSession;
+    /** tracks for autoplay to load next, then where it carries on in the library */
+    PlayQueue playQueue;
     /** next unique library Id for insert */
     long int nextLibraryId;
 
@@ -144,11 +195,23 @@ private:
     bool autoplayToggle;
     /** store autoCrossfade status */
     bool autoCrossfadeToggle;
-    /** increment for auto crossfade, controls direction (-/+) and speed */
+    /** increment for auto crossfade per 10ms, controls direction (-/+) and speed */
     double autoCrossfadeInc;
+    /** frame time of the last auto crossfade step, -1 if the crossfade has just started */
+    double lastCrossfadeFrameMs;
     
-    /** path to musicLib file - tab delineated representation of Track structs in PlaylistComponent::musicLib */
+    /** path to musicLib file - binary LibraryIndex of the tracks in PlaylistComponent::musicLib */
     std::string musicLibPath;
+    /** path to the tab delineated musicLib file written by earlier versions, imported if there is no musicLib file */
+    std::string musicLibImportPath;
+    /** path to the journal of library changes made since musicLib file was last written */
+    std::string musicLibJournalPath;
+    /** journal of library changes, created once the library has been loaded */
+    std::unique_ptr<LibraryJournal> musicLibJournal;
+    /** path to PlaylistComponent::playQueue's file */
+    std::string playQueuePath;
+    /** folder of waveform thumbnails the analysis pipeline writes, the one MainComponent's ThumbnailDiskCache reads */
+    juce::File thumbnailFolder;
     
     /** class scope layout properties - initialised and updated in resize() */
     double rowH, colW;
@@ -186,23 +249,106 @@ private:
      PlaylistComponent::loadMusicLib()
      Input                  none
      Output                 none
-     Called in constructor, opens file pointed to by musicLibPath
-     Reads line by line, uses PlaylistComponent::tokeniseMusicLibLine()
-     To convert line to a PlaylistComponent::Track struct
-     Stores in PlaylistComponent::musicLib vector
+     Called in constructor, memory maps the LibraryIndex at musicLibPath
+     Copies each record's fixed width fields into the PlaylistComponent::musicLib TrackStore, which
+     keeps the index mapped and reads titles, urls, artists and albums from it
+     If there is no valid index, imports the tab delineated file at musicLibImportPath instead
+     Then replays the changes in the journal at musicLibJournalPath on top
+     An index that exists but can't be read is set aside with its journal first, and the app quits if that fails
      */
     void loadMusicLib();
     
     /**
-     PlaylistComponent::saveMusicLib()
+     PlaylistComponent::setAsideMusicLib()
+     Input                  juce::File
+     Output                 bool
+     Renames the index at musicLibPath, the journal and an unfinished compaction's journal in workingDirectory
+     with a .damaged suffix and the current time, so a fresh library can be written without losing them
+     Returns false if any of them could not be moved
+     */
+    bool setAsideMusicLib(const juce::File& workingDirectory);
+    
+    /**
+     PlaylistComponent::importMusicLib()
+     Input                  juce::File
+     Output                 bool
+     Reads a tab delineated library file line by line, uses PlaylistComponent::tokeniseMusicLibLine()
+     to convert each line to a TrackStore::TrackInfo struct and adds it to PlaylistComponent::musicLib
+     Tracks keep their library ids unless the id is already taken. Lines that aren't tracks are skipped and counted
+     Returns false if the file could not be opened
+     */
+    bool importMusicLib(const juce::File& file);
+    
+    /**
+     PlaylistComponent::exportMusicLib()
+     Input                  juce::File
+     Output                 bool
+     Writes PlaylistComponent::musicLib to the file as tab delineated lines
+     */
+    bool exportMusicLib(const juce::File& file);
+    
+    /**
+     PlaylistComponent::openExportBrowser()
+     Input                  none
+     Output                 none
+     Called as lambda function by onClick method of PlaylistComponent::exportPlaylist component
+     Invokes juce::FileChooser and passes the chosen file to PlaylistComponent::exportMusicLib
+     */
+    void openExportBrowser();
+    
+    /**
+     PlaylistComponent::applyJournalRecord()
+     Input                  LibraryJournal::Record
+     Output                 none
+     Applies one replayed library change to PlaylistComponent::musicLib, a damaged record is skipped
+     */
+    void applyJournalRecord(const LibraryJournal::Record& record);
+    
+    /**
+     PlaylistComponent::compactMusicLibIfNeeded()
      Input                  none
      Output                 none
-     When called opens file pointed to by musicLibPath
-     Iterates through PlaylistComponent::musicLib
-     Converts PlaylistComponent::Track struct to tab delineated string
-     Writes to open file
+     Called after each journalled change. Once the journal is large compared to the library,
+     calls PlaylistComponent::compactMusicLib
+     */
+    void compactMusicLibIfNeeded();
+    
+    /**
+     PlaylistComponent::compactMusicLib()
+     Input                  none
+     Output                 none
+     Copies PlaylistComponent::musicLib and has the journal rewrite the LibraryIndex at musicLibPath
+     from the copy in the background. First rebuilds the library's string pool if it is mostly unused
+     */
+    void compactMusicLib();
+    
+    /**
+     PlaylistComponent::analysisToJournalValue()
+     Input                  juce::uint32 TrackStore row
+     Output                 std::string
+     Converts the analysis of a track to the tab delineated value of an "analysis" journal record,
+     with - for anything unknown
+     */
+    std::string analysisToJournalValue(juce::uint32 row);
+    
+    /**
+     PlaylistComponent::applyAnalysisJournalValue()
+     Input                  juce::uint32 TrackStore row, std::string
+     Output                 none
+     Sets the analysis of a track from the value of an "analysis" journal record, and marks it analysed
+     if the record has every field, so a track journalled before a field was added is analysed again
+     A damaged value changes nothing, so the track is analysed again
      */
-    void saveMusicLib();
+    void applyAnalysisJournalValue(juce::uint32 row, const std::string& value);
+    
+    /**
+     PlaylistComponent::trackToMusicLibLine()
+     Input                  TrackStore::TrackInfo struct
+     Output                 std::string
+     Converts a TrackStore::TrackInfo struct to a tab delineated line, without a newline
+     Used for journal records and for exporting the library
+     */
+    static std::string trackToMusicLibLine(const TrackStore::TrackInfo& track);
     
     /**
      PlaylistComponent::openFileBrowser()
@@ -214,14 +360,14 @@ private:
     void openFileBrowser();
     /**
      PlaylistComponent::tokeniseMusicLibLine
-     Input                  std::string line
-     Output                 Track struct
-     @param line            a tab-delineated line from the musicLib file
-     Called as a lambda by onClick method of PlaylistComponent::loadToPlaylist component
-     Takes a tab-delineated line from the file pointed to by musicLibPath
-     Returns a PlaylistComponent::Track struct populate with the information in the line
+     Input                  std::string line, TrackStore::TrackInfo
+     Output                 bool
+     @param line            a tab-delineated line from an imported library file or journal record
+     @param track           filled in with the information in the line
+     Takes a tab-delineated line from an imported library file or journal record
+     Returns false if the line is too short or a number in it can't be read, when track is left incomplete
      */
-    Track tokeniseMusicLibLine(std::string line);
+    static bool tokeniseMusicLibLine(const std::string& line, TrackStore::TrackInfo& track);
     
     /**
      PlaylistComponent::loadFileToMusicLib
@@ -232,6 +378,44 @@ private:
      and the music library file is update
      */
     void loadFileToMusicLib(juce::File);
+    
+    /**
+     PlaylistComponent::startImport()
+     Input                  juce::StringArray paths of files and folders
+     Output                 none
+     Hands the paths to PlaylistComponent::libraryImporter, along with the urls already in the library
+     so they are skipped, and shows the import progress
+     */
+    void startImport(const juce::StringArray& paths);
+    
+    /**
+     PlaylistComponent::addImportedTracks()
+     Input                  std::vector<TrackStore::TrackInfo>
+     Output                 none
+     Called with each batch of tracks from PlaylistComponent::libraryImporter
+     Gives them library ids and adds them to PlaylistComponent::musicLib and the search index
+     under one lock, journals them with one write, queues them for analysis and refreshes the display once
+     */
+    void addImportedTracks(std::vector<TrackStore::TrackInfo>& tracks);
+    
+    /**
+     PlaylistComponent::finishImport()
+     Input                  bool
+     Output                 none
+     Called when PlaylistComponent::libraryImporter is done, hides the progress
+     and writes the library out once with PlaylistComponent::compactMusicLib
+     */
+    void finishImport(bool wasCancelled);
+    
+    /**
+     PlaylistComponent::applyLibraryChanges()
+     Input                  std::vector<LibraryWatcher::Change>
+     Output                 none
+     Called with what a scan of the watched folders found. Adds new files, refreshes changed ones and
+     forgets their analysis, points moved tracks at their new files and removes tracks whose files have gone
+     Library ids, play counts and dates added are kept for changed and moved tracks
+     */
+    void applyLibraryChanges(std::vector<LibraryWatcher::Change>& changes);
 
     /* ========================================== */
     /* ====== state reporters and updaters ====== */
@@ -242,12 +426,33 @@ private:
      Input                  none
      Output                 none
      When triggered, checks if players have audio files loaded
-     If either doesn't, loads the next Track from musicLib
-     Moves any loaded tracks to the end of the musicLib
+     If either doesn't, loads the next track from PlaylistComponent::takeNextTrack
      If neither player is playing, starts player 1
      */
     void engageAutoplay();
     
+    /**
+     PlaylistComponent::takeNextTrack()
+     Input                  none
+     Output                 juce::uint32 TrackStore row, or TrackStore::noRow if no track can be played
+     Takes the next track off PlaylistComponent::playQueue, skipping tracks removed since they were queued
+     Once the queue is empty, steps through the library order from the queue's library position,
+     wrapping round at the end. The library itself is never reordered
+     Tracks PlaylistComponent::trackValidator found unplayable are skipped, and in the library so are
+     duplicates of tracks already played, unless every playable track is one
+     */
+    juce::uint32 takeNextTrack();
+    
+    /**
+     PlaylistComponent::queueTracks()
+     Input                  std::vector<long int> unique library ids of tracks, bool
+     Output                 none
+     @param playNext        true to queue the tracks ahead of everything already queued
+     Adds tracks to PlaylistComponent::playQueue, keeping their order, and saves the queue
+     Tracks not yet analysed are analysed ahead of the rest of the library
+     */
+    void queueTracks(const std::vector<long int>& trackIds, bool playNext);
+    
     /**
      PlaylistComponent::triggerAutoCrossfade
      Input                  none
@@ -272,15 +477,141 @@ private:
     
     /**
      PlaylistComponent::filterTracksToDisplayByTitle()
-     Input                  std::string to search for
+     Input                  std::string to search for, bool
      Output                 none
      @param searchTerm      a std::string, usually passed from PlaylistComponent::searchInput
+     @param debounce        true while typing, so the search waits for a pause
      Takes a string as input
-     If string is empty copies PlaylistComponent::musicLib to PlaylistComponent::tracksToBeDisplayed
-     Otherwise populates PlaylistComponent::tracksToBeDisplayed
-     from PlaylistComponent::musicLib depending on the output of a regex match
+     If string is empty copies the library order of PlaylistComponent::musicLib to PlaylistComponent::tracksToDisplay
+     Otherwise has PlaylistComponent::searchWorker find the rows of PlaylistComponent::musicLib
+     whose title contains the string, closely matches it, or matches it as a regex,
+     depending on PlaylistComponent::searchMode
+     A "contains" search may also filter on bpm, key, length and loudness, see LibraryQuery
+     The table keeps showing the previous results until PlaylistComponent::showSearchResults is called
+     While PlaylistComponent::duplicates is toggled on, shows the groups of duplicates instead
+     */
+    void filterTracksToDisplayByTitle(std::string searchTerm, bool debounce = false);
+    
+    /**
+     PlaylistComponent::showBpmPool()
+     Input                  none
+     Output                 none
+     Called as lambda function by onClick method of PlaylistComponent::bpmPool component
+     Searches for tracks within a few percent of the bpm of the playing deck, or the first loaded one
      */
-    void filterTracksToDisplayByTitle(std::string searchTerm);
+    void showBpmPool();
+    
+    /**
+     PlaylistComponent::showSearchResults()
+     Input                  SearchWorker::Results
+     Output                 none
+     Swaps finished search results into PlaylistComponent::tracksToDisplay
+     Results from before the library last changed are dropped, a newer search is already on its way
+     */
+    void showSearchResults(const SearchWorker::Results& results);
+    
+    /**
+     PlaylistComponent::applySort()
+     Input                  none
+     Output                 none
+     Sorts PlaylistComponent::tracksToDisplay by PlaylistComponent::sortKeys, if there are any
+     and the duplicates aren't showing, as they are kept in their groups
+     Called whenever tracksToDisplay is refilled
+     */
+    void applySort();
+    
+    /**
+     PlaylistComponent::analyseNewTracks()
+     Input                  none
+     Output                 none
+     Queues every track in the library that hasn't been analysed with PlaylistComponent::trackAnalyser
+     Called once the library is loaded, tracks added or changed after that are queued with PlaylistComponent::analyseTracks()
+     */
+    void analyseNewTracks();
+    
+    /**
+     PlaylistComponent::analyseTracks()
+     Input                  std::vector<long int>, TrackAnalyser::Priority
+     Output                 none
+     @param trackIds        library ids of tracks just added, changed, loaded or queued to play
+     Has PlaylistComponent::trackAnalyser analyse those of the tracks it hasn't yet, loaded and queued tracks ahead of the rest of the library
+     */
+    void analyseTracks(const std::vector<long int>& trackIds, TrackAnalyser::Priority priority = TrackAnalyser::bulk);
+    
+    /**
+     PlaylistComponent::applyAnalyses()
+     Input                  std::vector<TrackAnalyser::Analysis>
+     Output                 none
+     Writes each track's analysis into PlaylistComponent::musicLib and journals it, and hands its
+     fingerprint to PlaylistComponent::duplicateFinder. Analyses of files that have changed
+     or left the library since they were queued are dropped
+     */
+    void applyAnalyses(std::vector<TrackAnalyser::Analysis>& analyses);
+    
+    /**
+     PlaylistComponent::findDuplicates()
+     Input                  none
+     Output                 none
+     Hands every track in the library to PlaylistComponent::duplicateFinder, which matches
+     their fingerprints and calls PlaylistComponent::setDuplicateGroups with what it finds
+     Called whenever PlaylistComponent::trackAnalyser has finished the tracks queued with it
+     */
+    void findDuplicates();
+    
+    /**
+     PlaylistComponent::setDuplicateGroups()
+     Input                  std::vector<std::vector<long int>>
+     Output                 none
+     Keeps the groups of duplicates for autoplay and PlaylistComponent::showDuplicates,
+     refreshing the table if they are showing
+     */
+    void setDuplicateGroups(std::vector<std::vector<long int>>& groups);
+    
+    /**
+     PlaylistComponent::showDuplicates()
+     Input                  none
+     Output                 none
+     Called while PlaylistComponent::duplicates is toggled on. Fills PlaylistComponent::tracksToDisplay
+     with each group of duplicates in turn, leaving out tracks that have been removed and groups left with one track
+     */
+    void showDuplicates();
+    
+    /**
+     PlaylistComponent::isRepeat()
+     Input                  juce::uint32 TrackStore row
+     Output                 bool
+     Returns true if another recording of the track has been loaded to a deck since the app started
+     */
+    bool isRepeat(juce::uint32 row);
+    
+    /** PlaylistComponent::getCamelotKey() returns a track's key as "8A", or an empty string if it isn't known */
+    juce::String getCamelotKey(juce::uint32 row);
+    
+    /**
+     PlaylistComponent::loadToDeck()
+     Input                  DeckGUI*, juce::uint32 TrackStore row
+     Output                 none
+     Loads a library track to a deck with its title, key and mix points, cued where its sound starts, and counts the play
+     */
+    void loadToDeck(DeckGUI* deck, juce::uint32 row);
+    
+    /**
+     PlaylistComponent::setDeckMixPoints()
+     Input                  DeckGUI*, juce::uint32 TrackStore row
+     Output                 none
+     Gives a deck the mix points of the library track loaded to it, if they are known. The hand-off
+     to the other deck starts at the outro, or soon enough for the crossfade to end with the sound
+     */
+    void setDeckMixPoints(DeckGUI* deck, juce::uint32 row);
+    
+    /**
+     PlaylistComponent::countPlay()
+     Input                  juce::uint32 TrackStore row
+     Output                 none
+     Called when a track is loaded to a deck, adds one to its play count and journals it,
+     and has it analysed straight away if it hasn't been
+     */
+    void countPlay(juce::uint32 row);
     
     /**
      PlaylistComponent::loadIfNotPlaying()
@@ -292,11 +623,46 @@ private:
     
     /**
      PlaylistComponent::removeFromLibrary()
-     Input                  long int unique library id of track
+     Input                  std::vector<long int> unique library ids of tracks
+     Output                 none
+     Removes the tracks with the given ids from the library in one batch,
+     journals them with one write and updates the display once
+     */
+    void removeFromLibrary(const std::vector<long int>& trackIds);
+    
+    /**
+     PlaylistComponent::moveInLibrary()
+     Input                  std::vector<long int> unique library ids of tracks, int
+     Output                 none
+     @param index           library position of the first moved track, clamped to the end
+     Moves the tracks with the given ids together to a position in the library in one batch
+     */
+    void moveInLibrary(const std::vector<long int>& trackIds, int index);
+    
+    /**
+     PlaylistComponent::resetPlayCounts()
+     Input                  std::vector<long int> unique library ids of tracks
+     Output                 none
+     Sets the play count of the tracks with the given ids back to 0 in one batch
+     */
+    void resetPlayCounts(const std::vector<long int>& trackIds);
+    
+    /**
+     PlaylistComponent::getSelectedTrackIds()
+     Input                  none
+     Output                 std::vector<long int>
+     Returns the library ids of the tracks selected in the playlist, in display order
+     */
+    std::vector<long int> getSelectedTrackIds();
+    
+    /**
+     PlaylistComponent::showSelectionMenu()
+     Input                  int row of the playlist that was right clicked
      Output                 none
-     Removes the track with the given id from the library, saves and updates the display
+     Selects the row if it isn't already part of the selection, then offers
+     to queue, move, remove or reset the play counts of every selected track
      */
-    void removeFromLibrary(long int trackId);
+    void showSelectionMenu(int rowNumber);
     
     /**
      PlaylistComponent::emptyPlaylist()
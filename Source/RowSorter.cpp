@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    RowSorter.cpp
+    Created: 27 Oct 2026 9:41:17am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "RowSorter.h"
+#include "LibraryQuery.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cmath>
+#include <functional>
+
+constexpr int RowSorter::maxKeys;
+constexpr juce::uint32 RowSorter::unknownKey;
+constexpr size_t RowSorter::minRowsPerChunk;
+
+RowSorter::RowSorter() : pool(juce::jmax(1, juce::SystemStats::getNumCpus() - 1)),
+                         numChunks(juce::jmax(1, juce::SystemStats::getNumCpus()))
+{
+}
+
+RowSorter::~RowSorter()
+{
+    pool.removeAllJobs(true, 2000);
+}
+
+void RowSorter::sort(std::vector<juce::uint32>& rows, const std::vector<SortKey>& keys,
+                     const TrackStore& tracks, const TitleSearchIndex& index)
+{
+    int numKeys = juce::jmin((int)keys.size(), maxKeys);
+    if (numKeys == 0 || rows.size() < 2)
+        return;
+    for (int k = 0; k < numKeys; ++k)
+    {
+        if (keys[(size_t)k].column == title)
+            updateTitleRanks(tracks, index);
+        else if (keys[(size_t)k].column == artist)
+            updateTextRanks(artist, tracks, artistRanks);
+        else if (keys[(size_t)k].column == album)
+            updateTextRanks(album, tracks, albumRanks);
+    }
+
+    std::vector<Entry> entries(rows.size());
+    for (size_t position = 0; position < rows.size(); ++position)
+    {
+        Entry& entry = entries[position];
+        for (int k = 0; k < maxKeys; ++k)
+            entry.keys[k] = k < numKeys ? collationKey(keys[(size_t)k], rows[position], tracks) : 0;
+        entry.position = (juce::uint32)position;
+    }
+
+    // sort equal chunks side by side, then merge neighbouring runs until one is left
+    size_t chunks = juce::jlimit((size_t)1, (size_t)numChunks, entries.size() / minRowsPerChunk);
+    std::vector<size_t> bounds;
+    for (size_t chunk = 0; chunk <= chunks; ++chunk)
+        bounds.push_back(entries.size() * chunk / chunks);
+    std::vector<Entry> merged(entries.size());
+    auto runInParallel = [this] (size_t numJobs, const std::function<void(size_t)>& job)
+    {
+        std::atomic<size_t> jobsLeft {numJobs};
+        juce::WaitableEvent allDone;
+        for (size_t i = 1; i < numJobs; ++i)
+            pool.addJob([&job, &jobsLeft, &allDone, i] { job(i); if (--jobsLeft == 0) allDone.signal(); });
+        job(0);
+        if (--jobsLeft == 0)
+            allDone.signal();
+        allDone.wait();
+    };
+    runInParallel(chunks, [&] (size_t chunk)
+    {
+        // positions make every entry unique, so an unstable sort still keeps ties in view order
+        std::sort(entries.begin() + (long)bounds[chunk], entries.begin() + (long)bounds[chunk + 1], comesBefore);
+    });
+    while (bounds.size() > 2)
+    {
+        std::vector<size_t> mergedBounds;
+        size_t numRuns = bounds.size() - 1;
+        runInParallel((numRuns + 1) / 2, [&] (size_t pair)
+        {
+            size_t begin = bounds[pair * 2], middle = bounds[juce::jmin(pair * 2 + 1, numRuns)], end = bounds[juce::jmin(pair * 2 + 2, numRuns)];
+            std::merge(entries.begin() + (long)begin, entries.begin() + (long)middle,
+                       entries.begin() + (long)middle, entries.begin() + (long)end,
+                       merged.begin() + (long)begin, comesBefore);
+        });
+        for (size_t run = 0; run < numRuns; run += 2)
+            mergedBounds.push_back(bounds[run]);
+        mergedBounds.push_back(bounds.back());
+        entries.swap(merged);
+        bounds.swap(mergedBounds);
+    }
+
+    std::vector<juce::uint32> sorted(rows.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+        sorted[i] = rows[entries[i].position];
+    rows.swap(sorted);
+}
+
+void RowSorter::updateTitleRanks(const TrackStore& tracks, const TitleSearchIndex& index)
+{
+    if (titleRanksValid && titleRanksGeneration == tracks.getGeneration())
+        return;
+    std::vector<juce::uint32> byTitle = tracks.getOrder();
+    std::sort(byTitle.begin(), byTitle.end(), [&index] (juce::uint32 a, juce::uint32 b)
+    {
+        return index.getNormalisedTitle(a) < index.getNormalisedTitle(b);
+    });
+    titleRanks.assign(tracks.getNumRows(), unknownKey);
+    juce::uint32 rank = 0;
+    for (size_t i = 0; i < byTitle.size(); ++i)
+    {
+        // titles that only differ in case share a rank, and keep their view order
+        if (i > 0 && index.getNormalisedTitle(byTitle[i]) != index.getNormalisedTitle(byTitle[i - 1]))
+            ++rank;
+        titleRanks[byTitle[i]] = rank;
+    }
+    titleRanksGeneration = tracks.getGeneration();
+    titleRanksValid = true;
+}
+
+void RowSorter::updateTextRanks(Column column, const TrackStore& tracks, StringRanks& textRanks)
+{
+    if (textRanks.valid && textRanks.generation == tracks.getGeneration())
+        return;
+    std::vector<std::string> texts(tracks.getNumRows());
+    std::vector<juce::uint32> byText;
+    for (juce::uint32 row : tracks.getOrder())
+    {
+        juce::String text = column == artist ? tracks.getArtist(row) : tracks.getAlbum(row);
+        if (text.isEmpty())
+            continue;
+        texts[row] = text.toLowerCase().toStdString();
+        byText.push_back(row);
+    }
+    std::sort(byText.begin(), byText.end(), [&texts] (juce::uint32 a, juce::uint32 b) { return texts[a] < texts[b]; });
+    textRanks.ranks.assign(tracks.getNumRows(), unknownKey);
+    juce::uint32 rank = 0;
+    for (size_t i = 0; i < byText.size(); ++i)
+    {
+        if (i > 0 && texts[byText[i]] != texts[byText[i - 1]])
+            ++rank;
+        textRanks.ranks[byText[i]] = rank;
+    }
+    textRanks.generation = tracks.getGeneration();
+    textRanks.valid = true;
+}
+
+juce::uint32 RowSorter::collationKey(const SortKey& sortKey, juce::uint32 row, const TrackStore& tracks) const
+{
+    juce::uint32 value = unknownKey;
+    switch (sortKey.column)
+    {
+        case title:
+            value = titleRanks[row];
+            break;
+        case length:
+            value = floatKey(tracks.getLength(row));
+            break;
+        case bpm:
+            if (tracks.hasBpm(row))
+                value = floatKey(tracks.getBpm(row));
+            break;
+        case key:
+            // round the Camelot wheel, 1A 1B 2A 2B ...
+            if (tracks.hasKey(row))
+                value = (juce::uint32)(LibraryQuery::keyToCamelot(tracks.getKey(row)) - 1) * 2 + (tracks.getKey(row) < 12 ? 1 : 0);
+            break;
+        case dateAdded:
+            // seconds hold until 2106
+            if (tracks.getDateAdded(row) > 0)
+                value = (juce::uint32)juce::jmin(tracks.getDateAdded(row) / 1000, (juce::int64)unknownKey - 1);
+            break;
+        case playCount:
+            value = juce::jmin(tracks.getPlayCount(row), unknownKey - 1);
+            break;
+        case artist:
+            value = artistRanks.ranks[row];
+            break;
+        case album:
+            value = albumRanks.ranks[row];
+            break;
+    }
+    if (value == unknownKey)
+        return unknownKey;
+    // backwards keys are flipped, bar unknown ones which stay last
+    return sortKey.forwards ? value : juce::jmin(~value, unknownKey - 1);
+}
+
+juce::uint32 RowSorter::floatKey(float value)
+{
+    if (std::isnan(value))
+        return unknownKey;
+    // flip negative floats entirely and set the sign bit of positive ones, so the bits sort as the values do
+    juce::uint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    juce::uint32 ordered = (bits & 0x80000000) != 0 ? ~bits : (bits | 0x80000000);
+    return juce::jmin(ordered, unknownKey - 1);
+}
+
+bool RowSorter::comesBefore(const Entry& a, const Entry& b)
+{
+    for (int k = 0; k < maxKeys; ++k)
+        if (a.keys[k] != b.keys[k])
+            return a.keys[k] < b.keys[k];
+    return a.position < b.position;
+}
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    RowSorter.h
+    Created: 27 Oct 2026 9:41:17am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "TrackStore.h"
+#include "TitleSearchIndex.h"
+
+//==============================================================================
+/*
+ Orders a view of the library by up to three columns
+ Each row's columns are first turned into 32 bit collation keys, so the sort
+ compares small fixed size entries instead of strings and floats. Titles are
+ collated by their rank among all the library's titles, and artists and albums
+ likewise, each worked out once per library change. The entries are sorted in chunks across a thread pool, then
+ the chunks are merged. Ties keep their order in the view, so the sort is stable
+ Only the view's row numbers move, the TrackStore is untouched
+*/
+class RowSorter
+{
+public:
+    RowSorter();
+    ~RowSorter();
+
+    /** the columns a view can be sorted by */
+    enum Column { title, length, bpm, key, dateAdded, playCount, artist, album };
+    /** one column of a multi column sort, the first key is compared first */
+    struct SortKey
+    {
+        Column          column;
+        bool            forwards = true;
+    };
+    /** most columns compared by a sort */
+    static constexpr int maxKeys = 3;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     RowSorter::sort()
+     Input                  std::vector<juce::uint32>, std::vector<SortKey>, TrackStore, TitleSearchIndex
+     Output                 none
+     @param rows            TrackStore rows of the view, reordered in place
+     @param keys            columns to sort by, only the first maxKeys are used
+     @param index           supplies the normalised titles the title column is collated by
+     Sorts the rows of a view. Tracks with an unknown value sort last whichever way the column is sorted
+     */
+    void sort(std::vector<juce::uint32>& rows, const std::vector<SortKey>& keys,
+              const TrackStore& tracks, const TitleSearchIndex& index);
+
+private:
+    /** one row of the view with its collation keys, position is its place in the view before sorting */
+    struct Entry
+    {
+        juce::uint32    keys[maxKeys];
+        juce::uint32    position;
+    };
+
+    /** ranks of the strings in one column, indexed by row, and the library generation they were worked out at */
+    struct StringRanks
+    {
+        std::vector<juce::uint32>   ranks;
+        juce::uint32                generation = 0;
+        bool                        valid = false;
+    };
+
+    /** RowSorter::updateTitleRanks() ranks every title in the library, if the library has changed since they were last ranked */
+    void updateTitleRanks(const TrackStore& tracks, const TitleSearchIndex& index);
+
+    /**
+     RowSorter::updateTextRanks()
+     Input                  Column, TrackStore, StringRanks
+     Output                 none
+     Ranks every artist or album in the library ignoring case, if the library has changed since they were
+     last ranked. Empty ones are ranked unknownKey
+     */
+    void updateTextRanks(Column column, const TrackStore& tracks, StringRanks& textRanks);
+
+    /**
+     RowSorter::collationKey()
+     Input                  SortKey, juce::uint32, TrackStore
+     Output                 juce::uint32
+     Returns a key that orders the rows as the column should be sorted, unknownKey for an unknown value
+     */
+    juce::uint32 collationKey(const SortKey& sortKey, juce::uint32 row, const TrackStore& tracks) const;
+
+    /** RowSorter::floatKey() maps a float to an unsigned key in the same order */
+    static juce::uint32 floatKey(float value);
+
+    /** RowSorter::comesBefore() compares entries key by key, then by position */
+    static bool comesBefore(const Entry& a, const Entry& b);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    /** collation key of an unknown value, after every known one */
+    static constexpr juce::uint32 unknownKey = 0xffffffff;
+    /** views shorter than this are sorted on the calling thread alone */
+    static constexpr size_t minRowsPerChunk = 8192;
+    /** rank of each row's title among all the titles, indexed by row */
+    std::vector<juce::uint32> titleRanks;
+    /** library generation the titles were ranked at */
+    juce::uint32 titleRanksGeneration = 0;
+    bool titleRanksValid = false;
+    StringRanks artistRanks, albumRanks;
+    /** workers for sorting chunks, the calling thread sorts one chunk itself */
+    juce::ThreadPool pool;
+    int numChunks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RowSorter)
+};
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    SearchWorker.cpp
+    Created: 24 Oct 2026 11:26:10am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "SearchWorker.h"
+#include <regex>
+
+constexpr int SearchWorker::debounceMs;
+
+SearchWorker::SearchWorker(const TrackStore& _tracks, TitleSearchIndex& _index) :
+                            juce::Thread("playlist search"),
+                            tracks(_tracks),
+                            index(_index)
+{
+    startThread(4);
+}
+
+SearchWorker::~SearchWorker()
+{
+    cancelPendingUpdate();
+    ++latestRequest;
+    stopThread(2000);
+}
+
+/* ================================= */
+/* ====== message thread side ====== */
+/* ================================= */
+
+void SearchWorker::request(const std::string& query, Mode mode, bool debounce)
+{
+    const juce::ScopedLock sl(requestLock);
+    pendingQuery = query;
+    pendingMode = mode;
+    hasPending = true;
+    // a request that isn't debounced is treated as if typing stopped long ago
+    pendingTimeMs = juce::Time::getMillisecondCounter() - (debounce ? 0 : (juce::uint32)debounceMs);
+    ++latestRequest;
+    notify();
+}
+
+void SearchWorker::cancel()
+{
+    const juce::ScopedLock sl(requestLock);
+    hasPending = false;
+    ++latestRequest;
+}
+
+void SearchWorker::handleAsyncUpdate()
+{
+    std::shared_ptr<const Results> results = std::atomic_exchange(&published, std::shared_ptr<const Results>());
+    // results for a request that has since been replaced are dropped
+    if (results != nullptr && results->requestId == latestRequest.load() && onResults)
+        onResults(*results);
+}
+
+SearchWorker::ScopedLibraryChange::ScopedLibraryChange(SearchWorker& _worker) : worker(_worker)
+{
+    ++worker.latestRequest;
+    worker.libraryLock.enter();
+}
+
+SearchWorker::ScopedLibraryChange::~ScopedLibraryChange()
+{
+    worker.libraryLock.exit();
+}
+
+/* ================================ */
+/* ====== worker thread side ====== */
+/* ================================ */
+
+void SearchWorker::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+        std::string query;
+        Mode mode = contains;
+        juce::uint32 requestId = 0;
+        // wait for typing to pause, a new keystroke pushes the start back
+        for (;;)
+        {
+            int remainingMs;
+            {
+                const juce::ScopedLock sl(requestLock);
+                if (!hasPending)
+                    break;
+                remainingMs = debounceMs - (int)(juce::Time::getMillisecondCounter() - pendingTimeMs);
+                if (remainingMs <= 0)
+                {
+                    query = pendingQuery;
+                    mode = pendingMode;
+                    requestId = latestRequest.load();
+                    hasPending = false;
+                    break;
+                }
+            }
+            wait(remainingMs);
+            if (threadShouldExit())
+                return;
+        }
+        if (requestId != 0)
+            runSearch(query, mode, requestId);
+    }
+}
+
+void SearchWorker::runSearch(const std::string& query, Mode mode, juce::uint32 requestId)
+{
+    auto shouldCancel = [this, requestId] { return latestRequest.load() != requestId || threadShouldExit(); };
+    auto results = std::make_shared<Results>();
+    results->requestId = requestId;
+    {
+        const juce::ScopedLock sl(libraryLock);
+        if (shouldCancel())
+            return;
+        results->generation = tracks.getGeneration();
+        bool completed = false;
+        if (mode == regex)
+            completed = searchRegex(query, results->rows, shouldCancel);
+        else if (mode == fuzzy)
+            completed = fuzzyMatcher.search(query, tracks, index, results->rows, shouldCancel);
+        else
+        {
+            LibraryQuery structured = LibraryQuery::parse(query);
+            completed = structured.hasFilters() ? structured.run(tracks, index, results->rows, shouldCancel)
+                                                : index.search(query, tracks, results->rows, shouldCancel);
+        }
+        if (!completed)
+            return;
+    }
+    std::atomic_store(&published, std::shared_ptr<const Results>(results));
+    triggerAsyncUpdate();
+}
+
+bool SearchWorker::searchRegex(const std::string& query, std::vector<juce::uint32>& rows, const std::function<bool()>& shouldCancel)
+{
+    std::regex regexSearchTerm;
+    try
+    {
+        regexSearchTerm = std::regex(query, std::regex_constants::icase);
+    }
+    catch (const std::regex_error&)
+    {
+        // most likely half typed, the previous results stay up
+        return false;
+    }
+    // perform linear search on the title column testing for match
+    const std::vector<juce::uint32>& order = tracks.getOrder();
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        int numBytes;
+        const char* title = tracks.getTitleData(order[i], numBytes);
+        if (std::regex_search(title, title + numBytes, regexSearchTerm))
+            rows.push_back(order[i]);
+        if (i % 256 == 255 && shouldCancel())
+            return false;
+    }
+    return true;
+}
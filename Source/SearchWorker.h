@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    SearchWorker.h
+    Created: 24 Oct 2026 11:26:10am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "TrackStore.h"
+#include "TitleSearchIndex.h"
+#include "FuzzyMatcher.h"
+#include "LibraryQuery.h"
+
+//==============================================================================
+/*
+ Background thread that runs playlist searches
+ Requests are debounced while the user is typing, and each new request cancels
+ the one in flight. Finished results are published by atomically swapping in a
+ shared pointer, then handed to onResults on the message thread
+ The library and its index may only be changed inside a ScopedLibraryChange
+*/
+class SearchWorker  : private juce::Thread,
+                      private juce::AsyncUpdater
+{
+public:
+    SearchWorker(const TrackStore& _tracks, TitleSearchIndex& _index);
+    ~SearchWorker() override;
+
+    /** how a query is matched against the library */
+    enum Mode { contains, fuzzy, regex };
+    
+    /** one finished search */
+    struct Results
+    {
+        std::vector<juce::uint32>   rows;
+        juce::uint32                generation = 0;     // TrackStore generation searched
+        juce::uint32                requestId = 0;
+    };
+    
+    /** called on the message thread with the results of the latest request */
+    std::function<void(const Results&)> onResults;
+    
+    /** time after the last keystroke before a debounced search starts */
+    static constexpr int debounceMs = 120;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     SearchWorker::request()
+     Input                  std::string, Mode, bool
+     Output                 none
+     @param query           search text, must not be empty
+     @param mode            substring search through the index, ranked fuzzy search, or regex
+                            substring searches may include LibraryQuery field terms
+     @param debounce        wait for typing to pause before searching
+     Replaces any pending request and cancels the search in flight
+     */
+    void request(const std::string& query, Mode mode, bool debounce);
+    
+    /** SearchWorker::cancel() drops the pending request and cancels the search in flight */
+    void cancel();
+    
+    //==============================================================================
+    /* Holds the library lock for a change to the TrackStore or its index, cancelling
+       any search first so the change doesn't wait for it to finish
+       The change must be followed by a new request if a search is showing */
+    class ScopedLibraryChange
+    {
+    public:
+        ScopedLibraryChange(SearchWorker& _worker);
+        ~ScopedLibraryChange();
+    private:
+        SearchWorker& worker;
+        JUCE_DECLARE_NON_COPYABLE (ScopedLibraryChange)
+    };
+
+private:
+    // implement Thread
+    void run() override;
+    // implement AsyncUpdater
+    void handleAsyncUpdate() override;
+    
+    /**
+     SearchWorker::runSearch()
+     Input                  std::string, Mode, juce::uint32
+     Output                 none
+     Searches under the library lock, publishing the results unless the request is superseded
+     */
+    void runSearch(const std::string& query, Mode mode, juce::uint32 requestId);
+    
+    /** SearchWorker::searchRegex() linear regex scan of the titles, returns false if cancelled or the regex is invalid */
+    bool searchRegex(const std::string& query, std::vector<juce::uint32>& rows, const std::function<bool()>& shouldCancel);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** library being searched, owned by the caller */
+    const TrackStore& tracks;
+    TitleSearchIndex& index;
+    /** scores fuzzy searches across a pool of threads */
+    FuzzyMatcher fuzzyMatcher;
+    /** held while searching and while changing the library */
+    juce::CriticalSection libraryLock;
+    
+    /** pending request, guarded by requestLock */
+    juce::CriticalSection requestLock;
+    std::string pendingQuery;
+    Mode pendingMode = contains;
+    bool hasPending = false;
+    juce::uint32 pendingTimeMs = 0;
+    /** id of the newest request, a search stops as soon as it no longer matches */
+    std::atomic<juce::uint32> latestRequest {0};
+    
+    /** latest finished results, swapped in by the worker and out by the message thread */
+    std::shared_ptr<const Results> published;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SearchWorker)
+};
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.cpp
+    Created: 18 Oct 2026 2:40:53pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyser.h"
+#include <cstring>
+
+SpectrumAnalyser::SpectrumAnalyser(AudioTap& _tap) :
+                                    juce::Thread("spectrum analyser"),
+                                    tap(_tap)
+{
+    // allocate everything up front so the worker never allocates
+    windowL.assign(fftSize, 0.0f);
+    windowR.assign(fftSize, 0.0f);
+    hopL.assign(hopSize, 0.0f);
+    hopR.assign(hopSize, 0.0f);
+    fftData.assign(fftSize * 2, 0.0f);
+    workingSpectrum.assign(fftSize / 2, (float)minDecibels);
+    workingScope.assign(numScopePoints, {});
+    publishedSpectrum = workingSpectrum;
+    publishedScope = workingScope;
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    setActive(false);
+}
+
+void SpectrumAnalyser::setActive(bool shouldBeActive)
+{
+    if (shouldBeActive && !isThreadRunning())
+    {
+        tap.setEnabled(true);
+        startThread(3);
+    }
+    else if (!shouldBeActive && isThreadRunning())
+    {
+        tap.setEnabled(false);
+        stopThread(500);
+    }
+}
+
+double SpectrumAnalyser::getSampleRate()
+{
+    return tap.getSampleRate();
+}
+
+bool SpectrumAnalyser::getLatest(std::vector<float>& spectrumOut, std::vector<juce::Point<float>>& scopeOut, juce::uint32& generation)
+{
+    const juce::SpinLock::ScopedLockType lock(publishLock);
+    if (generation == publishedGeneration)
+        return false;
+    spectrumOut = publishedSpectrum;
+    scopeOut = publishedScope;
+    generation = publishedGeneration;
+    return true;
+}
+
+void SpectrumAnalyser::run()
+{
+    // anything left in the tap is from the last time the view was open
+    tap.discardPending();
+    hopFill = 0;
+    while (!threadShouldExit())
+    {
+        hopFill += tap.pull(hopL.data() + hopFill, hopR.data() + hopFill, hopSize - hopFill);
+        if (hopFill < hopSize)
+        {
+            // roughly one hop at 44.1kHz
+            wait(10);
+            continue;
+        }
+        hopFill = 0;
+        // slide the window along by one hop
+        std::memmove(windowL.data(), windowL.data() + hopSize, (fftSize - hopSize) * sizeof(float));
+        std::memmove(windowR.data(), windowR.data() + hopSize, (fftSize - hopSize) * sizeof(float));
+        std::memcpy(windowL.data() + fftSize - hopSize, hopL.data(), hopSize * sizeof(float));
+        std::memcpy(windowR.data() + fftSize - hopSize, hopR.data(), hopSize * sizeof(float));
+        analyseWindow();
+    }
+}
+
+void SpectrumAnalyser::analyseWindow()
+{
+    // spectrum of the mono sum
+    for (int i = 0; i < fftSize; ++i)
+        fftData[i] = (windowL[i] + windowR[i]) * 0.5f;
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.0f);
+    window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+    for (int bin = 0; bin < fftSize / 2; ++bin)
+    {
+        float level = juce::Decibels::gainToDecibels(fftData[bin] / (fftSize / 4), minDecibels);
+        // peaks jump up and fall back slowly so the display doesn't flicker
+        workingSpectrum[bin] = juce::jmax(level, workingSpectrum[bin] - spectrumFalloff);
+    }
+    // goniometer points from the most recent samples, rotated 45 degrees so mono is vertical
+    int offset = fftSize - numScopePoints;
+    for (int i = 0; i < numScopePoints; ++i)
+    {
+        float left = windowL[offset + i], right = windowR[offset + i];
+        workingScope[i] = {(right - left) * juce::MathConstants<float>::sqrt2 * 0.5f,
+                           (left + right) * juce::MathConstants<float>::sqrt2 * 0.5f};
+    }
+    const juce::SpinLock::ScopedLockType lock(publishLock);
+    std::copy(workingSpectrum.begin(), workingSpectrum.end(), publishedSpectrum.begin());
+    std::copy(workingScope.begin(), workingScope.end(), publishedScope.begin());
+    ++publishedGeneration;
+}
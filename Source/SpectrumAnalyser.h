@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.h
+    Created: 18 Oct 2026 2:40:53pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "AudioTap.h"
+
+//==============================================================================
+/*
+ Worker thread that reads an AudioTap, performs windowed FFTs
+ and collects goniometer points, publishing both for an AnalyserView to draw
+ Only runs while its view is showing
+*/
+class SpectrumAnalyser  : public juce::Thread
+{
+public:
+    SpectrumAnalyser(AudioTap& _tap);
+    ~SpectrumAnalyser() override;
+
+    /** FFT size is 2 ^ fftOrder */
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    /** a new spectrum is calculated every hopSize samples */
+    static constexpr int hopSize = fftSize / 4;
+    /** number of L / R pairs published for the goniometer */
+    static constexpr int numScopePoints = 512;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     SpectrumAnalyser::setActive()
+     Input                  bool
+     Output                 none
+     Starts or stops the worker thread and the tap that feeds it
+     */
+    void setActive(bool shouldBeActive);
+    
+    /**
+     SpectrumAnalyser::getLatest()
+     Input                  std::vector<float>&, std::vector<juce::Point<float>>&, juce::uint32&
+     Output                 bool
+     @param spectrumOut     filled with the smoothed spectrum in dB, one value per bin
+     @param scopeOut        filled with goniometer points (side, mid) in the range -1 - 1
+     @param generation      the generation the caller last drew, updated on return
+     Copies the latest results if they are newer than generation, returns true if it did
+     */
+    bool getLatest(std::vector<float>& spectrumOut, std::vector<juce::Point<float>>& scopeOut, juce::uint32& generation);
+    
+    /** SpectrumAnalyser::getSampleRate() returns the sample rate of the analysed stream */
+    double getSampleRate();
+
+private:
+    // implement Thread
+    void run() override;
+    
+    /**
+     SpectrumAnalyser::analyseWindow()
+     Input                  none
+     Output                 none
+     Windows and transforms the current analysis window, updates the goniometer points
+     and publishes both
+     */
+    void analyseWindow();
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** source of the samples */
+    AudioTap& tap;
+    /** fft engine and window */
+    juce::dsp::FFT fft{fftOrder};
+    juce::dsp::WindowingFunction<float> window{(size_t)fftSize, juce::dsp::WindowingFunction<float>::hann};
+    /** sliding analysis window for each channel */
+    std::vector<float> windowL, windowR;
+    /** samples collected towards the next hop */
+    std::vector<float> hopL, hopR;
+    int hopFill = 0;
+    /** fft working buffer, twice fftSize as juce::dsp::FFT requires */
+    std::vector<float> fftData;
+    /** results being built by the worker */
+    std::vector<float> workingSpectrum;
+    std::vector<juce::Point<float>> workingScope;
+    
+    /** results published for the renderer, guarded by publishLock */
+    juce::SpinLock publishLock;
+    std::vector<float> publishedSpectrum;
+    std::vector<juce::Point<float>> publishedScope;
+    juce::uint32 publishedGeneration = 0;
+    
+    /** dB floor of the spectrum and how fast peaks fall back per hop */
+    static constexpr float minDecibels = -100.0f;
+    static constexpr float spectrumFalloff = 1.5f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyser)
+};
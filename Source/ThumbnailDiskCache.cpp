@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    ThumbnailDiskCache.cpp
+    Created: 3 Nov 2026 4:12:30pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "ThumbnailDiskCache.h"
+
+ThumbnailDiskCache::ThumbnailDiskCache(int maxThumbsInMemory, const juce::File& _folder) :
+                                    juce::AudioThumbnailCache(maxThumbsInMemory),
+                                    folder(_folder)
+{
+}
+
+ThumbnailDiskCache::~ThumbnailDiskCache()
+{
+}
+
+juce::int64 ThumbnailDiskCache::getHash(const juce::URL& url)
+{
+    // as juce::URLInputSource::hashCode(), which WaveformDisplay's thumbnail is looked up by
+    return url.toString(true).hashCode64();
+}
+
+bool ThumbnailDiskCache::saveThumbnail(const juce::File& folder, juce::int64 hash, const juce::AudioThumbnailBase& thumbnail)
+{
+    if (!folder.isDirectory() && folder.createDirectory().failed())
+        return false;
+    // written beside the old file and renamed over it, so a deck never reads half a thumbnail
+    juce::TemporaryFile temporaryFile(getThumbnailFile(folder, hash));
+    {
+        juce::FileOutputStream out(temporaryFile.getFile());
+        if (!out.openedOk())
+            return false;
+        thumbnail.saveTo(out);
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+    return temporaryFile.overwriteTargetFileWithTemporary();
+}
+
+bool ThumbnailDiskCache::deleteThumbnail(const juce::File& folder, juce::int64 hash)
+{
+    return getThumbnailFile(folder, hash).deleteFile();
+}
+
+bool ThumbnailDiskCache::loadNewThumb(juce::AudioThumbnailBase& thumbnail, juce::int64 hash)
+{
+    juce::FileInputStream in(getThumbnailFile(folder, hash));
+    return in.openedOk() && thumbnail.loadFrom(in);
+}
+
+void ThumbnailDiskCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumbnail, juce::int64 hash)
+{
+    if (!saveThumbnail(folder, hash, thumbnail))
+        std::cout << "ThumbnailDiskCache::saveNewlyFinishedThumbnail: could not write to " << folder.getFullPathName() << std::endl;
+}
+
+juce::File ThumbnailDiskCache::getThumbnailFile(const juce::File& folder, juce::int64 hash)
+{
+    return folder.getChildFile(juce::String::toHexString(hash) + ".thumb");
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    ThumbnailDiskCache.h
+    Created: 3 Nov 2026 4:12:30pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+ Thumbnail cache that keeps every finished waveform thumbnail in a folder, one
+ file per url, as well as the most recent ones in memory
+ The analysis pipeline writes a thumbnail for each library track as it decodes it,
+ so loading a track to a deck shows its waveform straight away without a second decode
+*/
+class ThumbnailDiskCache  : public juce::AudioThumbnailCache
+{
+public:
+    /**
+     ThumbnailDiskCache::ThumbnailDiskCache()
+     @param maxThumbsInMemory   thumbnails kept in memory as well as on disk
+     @param _folder             where the thumbnail files are kept, created when the first is saved
+     */
+    ThumbnailDiskCache(int maxThumbsInMemory, const juce::File& _folder);
+    ~ThumbnailDiskCache() override;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /** ThumbnailDiskCache::getHash() returns the hash a juce::AudioThumbnail loaded from a url is cached under */
+    static juce::int64 getHash(const juce::URL& url);
+
+    /**
+     ThumbnailDiskCache::saveThumbnail()
+     Input                  juce::File, juce::int64, juce::AudioThumbnailBase
+     Output                 bool
+     Writes a thumbnail to its file in a folder, replacing any older one whole. Returns false on failure
+     Safe to call from any thread
+     */
+    static bool saveThumbnail(const juce::File& folder, juce::int64 hash, const juce::AudioThumbnailBase& thumbnail);
+
+    /**
+     ThumbnailDiskCache::deleteThumbnail()
+     Input                  juce::File, juce::int64
+     Output                 bool
+     Deletes a thumbnail's file from a folder, for a track that has left the library. Returns false if it is still there
+     Safe to call from any thread
+     */
+    static bool deleteThumbnail(const juce::File& folder, juce::int64 hash);
+
+private:
+    // implement AudioThumbnailCache
+    bool loadNewThumb(juce::AudioThumbnailBase& thumbnail, juce::int64 hash) override;
+    void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumbnail, juce::int64 hash) override;
+
+    /** ThumbnailDiskCache::getThumbnailFile() returns the file a thumbnail is kept in */
+    static juce::File getThumbnailFile(const juce::File& folder, juce::int64 hash);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    juce::File folder;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThumbnailDiskCache)
+};
@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    TitleSearchIndex.cpp
+    Created: 23 Oct 2026 2:07:45pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "TitleSearchIndex.h"
+#include <algorithm>
+#include <iterator>
+#include <cctype>
+
+constexpr size_t TitleSearchIndex::minSubstringQuery;
+constexpr int TitleSearchIndex::rowsPerCancelCheck;
+
+TitleSearchIndex::TitleSearchIndex()
+{
+}
+
+TitleSearchIndex::~TitleSearchIndex()
+{
+}
+
+/* ============================= */
+/* ====== keeping in step ====== */
+/* ============================= */
+
+void TitleSearchIndex::rebuild(const TrackStore& tracks)
+{
+    clear();
+    titles.resize(tracks.getNumRows());
+    fileNames.resize(tracks.getNumRows());
+    // indexing rows in ascending order lets every row list be appended to
+    std::vector<juce::uint32> rows = tracks.getOrder();
+    std::sort(rows.begin(), rows.end());
+    for (juce::uint32 row : rows)
+        index(tracks, row);
+}
+
+void TitleSearchIndex::add(const TrackStore& tracks, juce::uint32 row)
+{
+    if (row >= titles.size())
+    {
+        titles.resize(row + 1);
+        fileNames.resize(row + 1);
+    }
+    index(tracks, row);
+    hasLastResults = false;
+}
+
+void TitleSearchIndex::remove(juce::uint32 row)
+{
+    if (row >= titles.size())
+        return;
+    forEachKey(titles[row], [this, row] (juce::uint32 key, bool isTrigram)
+    {
+        auto& table = isTrigram ? trigramRows : prefixRows;
+        auto entry = table.find(key);
+        if (entry == table.end())
+            return;
+        std::vector<juce::uint32>& rows = entry->second;
+        auto position = std::lower_bound(rows.begin(), rows.end(), row);
+        if (position != rows.end() && *position == row)
+            rows.erase(position);
+        if (rows.empty())
+            table.erase(entry);
+    });
+    titles[row].clear();
+    fileNames[row].clear();
+    hasLastResults = false;
+}
+
+void TitleSearchIndex::remove(const std::vector<juce::uint32>& rows)
+{
+    std::vector<juce::uint8> removing(titles.size(), 0);
+    std::vector<juce::uint32> trigramKeys, prefixKeys;
+    for (juce::uint32 row : rows)
+    {
+        if (row >= titles.size() || removing[row] != 0)
+            continue;
+        removing[row] = 1;
+        forEachKey(titles[row], [&trigramKeys, &prefixKeys] (juce::uint32 key, bool isTrigram)
+        {
+            (isTrigram ? trigramKeys : prefixKeys).push_back(key);
+        });
+    }
+    auto removeFrom = [&removing] (std::unordered_map<juce::uint32, std::vector<juce::uint32>>& table, std::vector<juce::uint32>& keys)
+    {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (juce::uint32 key : keys)
+        {
+            auto entry = table.find(key);
+            if (entry == table.end())
+                continue;
+            std::vector<juce::uint32>& keyRows = entry->second;
+            keyRows.erase(std::remove_if(keyRows.begin(), keyRows.end(),
+                                         [&removing] (juce::uint32 row) { return row < removing.size() && removing[row] != 0; }),
+                          keyRows.end());
+            if (keyRows.empty())
+                table.erase(entry);
+        }
+    };
+    removeFrom(trigramRows, trigramKeys);
+    removeFrom(prefixRows, prefixKeys);
+    for (juce::uint32 row = 0; row < (juce::uint32)removing.size(); ++row)
+    {
+        if (removing[row] != 0)
+        {
+            titles[row].clear();
+            fileNames[row].clear();
+        }
+    }
+    hasLastResults = false;
+}
+
+void TitleSearchIndex::clear()
+{
+    titles.clear();
+    fileNames.clear();
+    trigramRows.clear();
+    prefixRows.clear();
+    lastQuery.clear();
+    lastResults.clear();
+    hasLastResults = false;
+}
+
+void TitleSearchIndex::index(const TrackStore& tracks, juce::uint32 row)
+{
+    int numBytes;
+    const char* title = tracks.getTitleData(row, numBytes);
+    titles[row] = normalise(title, numBytes);
+    const char* fileName = tracks.getFileNameData(row, numBytes);
+    juce::String unescaped = juce::URL::removeEscapeChars(juce::String::fromUTF8(fileName, numBytes));
+    fileNames[row] = unescaped.toLowerCase().toStdString();
+    forEachKey(titles[row], [this, row] (juce::uint32 key, bool isTrigram)
+    {
+        std::vector<juce::uint32>& rows = (isTrigram ? trigramRows : prefixRows)[key];
+        // rebuilds index rows in ascending order, so most rows go on the end
+        if (rows.empty() || rows.back() < row)
+        {
+            rows.push_back(row);
+            return;
+        }
+        // a key repeated in one title is only listed once
+        auto position = std::lower_bound(rows.begin(), rows.end(), row);
+        if (*position != row)
+            rows.insert(position, row);
+    });
+}
+
+void TitleSearchIndex::forEachKey(const std::string& text, std::function<void(juce::uint32 key, bool isTrigram)> callback)
+{
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (i + 3 <= text.size())
+            callback(trigramAt(text, i), true);
+        if (isWordStart(text, i))
+        {
+            callback(prefixAt(text, i, 1), false);
+            if (i + 2 <= text.size())
+                callback(prefixAt(text, i, 2), false);
+        }
+    }
+}
+
+/* ======================= */
+/* ====== searching ====== */
+/* ======================= */
+
+bool TitleSearchIndex::search(const std::string& query, const TrackStore& tracks, std::vector<juce::uint32>& results,
+                              const std::function<bool()>& shouldCancel)
+{
+    std::string normalisedQuery = normalise(query.data(), (int)query.size());
+    bool substringMode = normalisedQuery.size() >= minSubstringQuery;
+    bool lastSubstringMode = lastQuery.size() >= minSubstringQuery;
+    // a longer query can only match a subset of what the shorter one did, in the same order
+    bool refine = hasLastResults
+               && lastGeneration == tracks.getGeneration()
+               && substringMode == lastSubstringMode
+               && !lastQuery.empty()
+               && (substringMode ? normalisedQuery.find(lastQuery) != std::string::npos
+                                 : normalisedQuery.compare(0, lastQuery.size(), lastQuery) == 0);
+    results.clear();
+    bool completed = true;
+    if (normalisedQuery.empty())
+        results = tracks.getOrder();
+    else if (refine)
+    {
+        for (size_t i = 0; i < lastResults.size() && completed; ++i)
+        {
+            juce::uint32 row = lastResults[i];
+            if (matches(normalisedQuery, row))
+                results.push_back(row);
+            if (shouldCancel && i % rowsPerCancelCheck == rowsPerCancelCheck - 1)
+                completed = !shouldCancel();
+        }
+    }
+    else if (substringMode)
+        completed = searchSubstring(normalisedQuery, tracks, results, shouldCancel);
+    else
+        completed = searchWordPrefix(normalisedQuery, tracks, results);
+    // a cancelled search mustn't be refined from
+    if (!completed)
+    {
+        hasLastResults = false;
+        return false;
+    }
+    lastQuery = normalisedQuery;
+    lastResults = results;
+    lastGeneration = tracks.getGeneration();
+    hasLastResults = true;
+    return true;
+}
+
+bool TitleSearchIndex::searchSubstring(const std::string& query, const TrackStore& tracks, std::vector<juce::uint32>& results,
+                                       const std::function<bool()>& shouldCancel)
+{
+    // gather the row list of every trigram, a missing trigram means no matches
+    std::vector<const std::vector<juce::uint32>*> lists;
+    for (size_t i = 0; i + 3 <= query.size(); ++i)
+    {
+        auto entry = trigramRows.find(trigramAt(query, i));
+        if (entry == trigramRows.end())
+            return true;
+        lists.push_back(&entry->second);
+    }
+    // intersect starting from the shortest list
+    std::sort(lists.begin(), lists.end(),
+              [] (const std::vector<juce::uint32>* a, const std::vector<juce::uint32>* b) { return a->size() < b->size(); });
+    std::vector<juce::uint32> candidates = *lists[0], survivors;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+    {
+        survivors.clear();
+        std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                              std::back_inserter(survivors));
+        candidates.swap(survivors);
+    }
+    // trigrams can all be present without the whole query being, so check each candidate
+    matched.assign(titles.size(), 0);
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        juce::uint32 row = candidates[i];
+        if (titles[row].find(query) != std::string::npos)
+            matched[row] = 1;
+        if (shouldCancel && i % rowsPerCancelCheck == rowsPerCancelCheck - 1 && shouldCancel())
+            return false;
+    }
+    for (juce::uint32 row : tracks.getOrder())
+        if (row < matched.size() && matched[row])
+            results.push_back(row);
+    return true;
+}
+
+bool TitleSearchIndex::searchWordPrefix(const std::string& query, const TrackStore& tracks, std::vector<juce::uint32>& results)
+{
+    auto entry = prefixRows.find(prefixAt(query, 0, query.size()));
+    if (entry == prefixRows.end())
+        return true;
+    matched.assign(titles.size(), 0);
+    for (juce::uint32 row : entry->second)
+        matched[row] = 1;
+    for (juce::uint32 row : tracks.getOrder())
+        if (row < matched.size() && matched[row])
+            results.push_back(row);
+    return true;
+}
+
+bool TitleSearchIndex::matches(const std::string& normalisedQuery, juce::uint32 row) const
+{
+    if (normalisedQuery.size() >= minSubstringQuery)
+        return titles[row].find(normalisedQuery) != std::string::npos;
+    return hasWordStartingWith(titles[row], normalisedQuery);
+}
+
+/* ======================= */
+/* ====== utilities ====== */
+/* ======================= */
+
+std::string TitleSearchIndex::normalise(const char* data, int numBytes)
+{
+    return juce::String::fromUTF8(data, numBytes).toLowerCase().toStdString();
+}
+
+const std::string& TitleSearchIndex::getNormalisedTitle(juce::uint32 row) const
+{
+    return titles[row];
+}
+
+const std::string& TitleSearchIndex::getNormalisedFileName(juce::uint32 row) const
+{
+    return fileNames[row];
+}
+
+juce::uint32 TitleSearchIndex::trigramAt(const std::string& text, size_t position)
+{
+    return ((juce::uint32)(juce::uint8)text[position] << 16)
+         | ((juce::uint32)(juce::uint8)text[position + 1] << 8)
+         | (juce::uint32)(juce::uint8)text[position + 2];
+}
+
+juce::uint32 TitleSearchIndex::prefixAt(const std::string& text, size_t position, size_t length)
+{
+    // the length goes in the top byte so "a" and "a\0" can't collide
+    juce::uint32 key = (juce::uint32)length << 24;
+    for (size_t i = 0; i < length; ++i)
+        key |= (juce::uint32)(juce::uint8)text[position + i] << (8 * (length - 1 - i));
+    return key;
+}
+
+bool TitleSearchIndex::isWordStart(const std::string& text, size_t position)
+{
+    auto isWordByte = [] (char c) { return (juce::uint8)c >= 0x80 || std::isalnum((juce::uint8)c); };
+    return isWordByte(text[position]) && (position == 0 || !isWordByte(text[position - 1]));
+}
+
+bool TitleSearchIndex::hasWordStartingWith(const std::string& text, const std::string& prefix)
+{
+    for (size_t position = text.find(prefix); position != std::string::npos; position = text.find(prefix, position + 1))
+        if (isWordStart(text, position))
+            return true;
+    return false;
+}
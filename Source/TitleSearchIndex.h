@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    TitleSearchIndex.h
+    Created: 23 Oct 2026 2:07:45pm
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include "TrackStore.h"
+
+//==============================================================================
+/*
+ Search index over the lower cased titles in a TrackStore
+ Queries of three bytes or more match anywhere in a title, found by intersecting
+ the rows of each trigram in the query and checking the few that survive
+ Shorter queries match the start of any word, found from the rows listed under
+ the first one and two bytes of every word
+ When a query extends the previous one, only the previous results are checked again
+*/
+class TitleSearchIndex
+{
+public:
+    TitleSearchIndex();
+    ~TitleSearchIndex();
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /** TitleSearchIndex::rebuild() indexes every track in the store, replacing what was there */
+    void rebuild(const TrackStore& tracks);
+    
+    /** TitleSearchIndex::add() indexes the title of one row */
+    void add(const TrackStore& tracks, juce::uint32 row);
+    
+    /** TitleSearchIndex::remove() drops a row from the index */
+    void remove(juce::uint32 row);
+    
+    /** TitleSearchIndex::remove() drops many rows, editing each affected row list once */
+    void remove(const std::vector<juce::uint32>& rows);
+    
+    /** TitleSearchIndex::clear() empties the index */
+    void clear();
+    
+    /**
+     TitleSearchIndex::search()
+     Input                  std::string, TrackStore, std::vector<juce::uint32>, std::function<bool()>
+     Output                 bool
+     @param query           text typed by the user, matched without regard to case
+     @param results         filled with the matching rows, in library order
+     @param shouldCancel    polled while searching, may be empty
+     Finds the tracks whose title matches the query
+     Returns false if the search was cancelled, leaving results incomplete
+     */
+    bool search(const std::string& query, const TrackStore& tracks, std::vector<juce::uint32>& results,
+                const std::function<bool()>& shouldCancel = nullptr);
+    
+    /**
+     TitleSearchIndex::matches()
+     Input                  std::string, juce::uint32
+     Output                 bool
+     @param normalisedQuery query already passed through normalise()
+     Checks one indexed row's title against a query by the same rule as search(), for callers
+     that have already narrowed the rows some other way
+     */
+    bool matches(const std::string& normalisedQuery, juce::uint32 row) const;
+    
+    /** TitleSearchIndex::normalise() lower cases UTF-8 text the same way for titles and queries */
+    static std::string normalise(const char* data, int numBytes);
+    
+    /** TitleSearchIndex::getNormalisedTitle() returns the lower cased title of an indexed row */
+    const std::string& getNormalisedTitle(juce::uint32 row) const;
+    
+    /** TitleSearchIndex::getNormalisedFileName() returns the lower cased, unescaped file name of an indexed row */
+    const std::string& getNormalisedFileName(juce::uint32 row) const;
+
+private:
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    /** queries shorter than this match word starts rather than substrings */
+    static constexpr size_t minSubstringQuery = 3;
+    
+    /** normalised title and file name of each row, empty for rows not in the index */
+    std::vector<std::string> titles, fileNames;
+    /** rows containing each trigram, kept sorted */
+    std::unordered_map<juce::uint32, std::vector<juce::uint32>> trigramRows;
+    /** rows with a word starting with each one or two byte prefix, kept sorted */
+    std::unordered_map<juce::uint32, std::vector<juce::uint32>> prefixRows;
+    
+    /** previous query and its results, refined if the next query extends it */
+    std::string lastQuery;
+    std::vector<juce::uint32> lastResults;
+    juce::uint32 lastGeneration = 0;
+    bool hasLastResults = false;
+    /** scratch flag per row, used to put matches into library order */
+    std::vector<juce::uint8> matched;
+    
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /** TitleSearchIndex::index() normalises a row's title and file name and lists the row under the trigrams and word prefixes of its title */
+    void index(const TrackStore& tracks, juce::uint32 row);
+    /** TitleSearchIndex::forEachKey() calls back with the trigram and word prefix keys of a title */
+    static void forEachKey(const std::string& text, std::function<void(juce::uint32 key, bool isTrigram)> callback);
+    /** TitleSearchIndex::trigramAt() packs three bytes of text into a key */
+    static juce::uint32 trigramAt(const std::string& text, size_t position);
+    /** TitleSearchIndex::prefixAt() packs one or two bytes of text into a key */
+    static juce::uint32 prefixAt(const std::string& text, size_t position, size_t length);
+    /** TitleSearchIndex::isWordStart() returns whether a word begins at a byte of a title */
+    static bool isWordStart(const std::string& text, size_t position);
+    /** TitleSearchIndex::hasWordStartingWith() checks one title for a word starting with a prefix */
+    static bool hasWordStartingWith(const std::string& text, const std::string& prefix);
+    /** rows checked between polls of a cancel function */
+    static constexpr int rowsPerCancelCheck = 4096;
+    bool searchSubstring(const std::string& query, const TrackStore& tracks, std::vector<juce::uint32>& results,
+                         const std::function<bool()>& shouldCancel);
+    bool searchWordPrefix(const std::string& query, const TrackStore& tracks, std::vector<juce::uint32>& results);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TitleSearchIndex)
+};
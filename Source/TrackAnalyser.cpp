@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+    TrackAnalyser.cpp
+    Created: 3 Nov 2026 10:21:09am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "TrackAnalyser.h"
+
+constexpr int TrackAnalyser::startDelayMs;
+constexpr int TrackAnalyser::blockSize;
+constexpr int TrackAnalyser::idleCheckMs;
+constexpr int TrackAnalyser::maxWorkers;
+
+TrackAnalyser::TrackAnalyser(juce::AudioFormatManager& _formatManager) :
+                                    formatManager(_formatManager),
+                                    startMs(juce::Time::getMillisecondCounter())
+{
+    const int numWorkers = juce::jlimit(1, maxWorkers, juce::SystemStats::getNumCpus() - 1);
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(*this, i));
+        workers.back()->startThread(1);
+    }
+}
+
+TrackAnalyser::~TrackAnalyser()
+{
+    cancelPendingUpdate();
+    ++generation;
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+    for (auto& worker : workers)
+        worker->stopThread(4000);
+}
+
+/* ================================= */
+/* ====== message thread side ====== */
+/* ================================= */
+
+void TrackAnalyser::addStage(std::function<std::unique_ptr<Stage>()> createStage)
+{
+    const juce::ScopedLock sl(lock);
+    stageFactories.push_back(std::move(createStage));
+}
+
+void TrackAnalyser::analyse(const std::vector<Track>& tracks, Priority priority)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        std::vector<long int> newBulkIds;
+        for (const Track& track : tracks)
+        {
+            // already queued, it keeps its place with the newer signature unless it is now wanted sooner,
+            // when it joins the more urgent queue and the entry it leaves behind is skipped when reached
+            auto queued = queuedTracks.find(track.libraryId);
+            if (queued != queuedTracks.end())
+            {
+                queued->second.track = track;
+                if (priority > queued->second.priority)
+                {
+                    queued->second.priority = priority;
+                    urgentIds[priority].push_back(track.libraryId);
+                }
+                continue;
+            }
+            // a track being analysed is only promoted, so it is no longer throttled or set aside, unless its file has changed
+            bool running = false;
+            for (auto& worker : workers)
+                for (Job& job : worker->jobs)
+                    if (job.active && job.track.libraryId == track.libraryId && job.track.signature == track.signature)
+                    {
+                        running = true;
+                        if (priority > job.priority.load())
+                            job.priority = priority;
+                    }
+            if (running)
+                continue;
+            queuedTracks[track.libraryId] = { track, priority };
+            if (priority == bulk)
+                newBulkIds.push_back(track.libraryId);
+            else
+                urgentIds[priority].push_back(track.libraryId);
+        }
+        int waiting = 0;
+        for (int p = bulk + 1; p < numPriorities; ++p)
+            waiting += (int)urgentIds[p].size();
+        numUrgent = waiting;
+        // dealt out in runs, so each worker reads through neighbouring files
+        const size_t runLength = (newBulkIds.size() + workers.size() - 1) / workers.size();
+        for (size_t i = 0; i < newBulkIds.size(); ++i)
+            workers[i / runLength]->bulkIds.push_back(newBulkIds[i]);
+    }
+    for (auto& worker : workers)
+        worker->notify();
+}
+
+void TrackAnalyser::cancel()
+{
+    const juce::ScopedLock sl(lock);
+    for (auto& worker : workers)
+        worker->bulkIds.clear();
+    for (auto& ids : urgentIds)
+        ids.clear();
+    queuedTracks.clear();
+    numUrgent = 0;
+    ++generation;
+}
+
+void TrackAnalyser::handleAsyncUpdate()
+{
+    std::vector<Analysis> analyses;
+    bool queueFinished;
+    {
+        const juce::ScopedLock sl(lock);
+        analyses.swap(readyAnalyses);
+        queueFinished = finished;
+        finished = false;
+    }
+    if (!analyses.empty() && onAnalysed)
+        onAnalysed(analyses);
+    if (queueFinished && onFinished)
+        onFinished();
+}
+
+/* ================================ */
+/* ====== worker thread side ====== */
+/* ================================ */
+
+int TrackAnalyser::takeTrack(Worker& worker, bool allowBulk)
+{
+    const juce::ScopedLock sl(lock);
+    Track track;
+    Priority priority = bulk;
+    int slot = -1;
+    for (int p = numPriorities - 1; p > bulk && slot < 0; --p)
+    {
+        while (!urgentIds[p].empty() && slot < 0)
+        {
+            const long int libraryId = urgentIds[p].front();
+            urgentIds[p].pop_front();
+            --numUrgent;
+            if (takeQueuedTrack(libraryId, (Priority)p, track))
+            {
+                priority = (Priority)p;
+                slot = 1;
+            }
+        }
+    }
+    // a worker with an urgent track set aside its bulk one to take it, so has no room for another
+    while (slot < 0 && allowBulk && !worker.jobs[0].active)
+    {
+        Worker* victim = &worker;
+        if (worker.bulkIds.empty())
+            for (auto& other : workers)
+                if (other->bulkIds.size() > victim->bulkIds.size())
+                    victim = other.get();
+        if (victim->bulkIds.empty())
+            break;
+        long int libraryId;
+        if (victim == &worker)
+        {
+            libraryId = worker.bulkIds.front();
+            worker.bulkIds.pop_front();
+        }
+        else
+        {
+            libraryId = victim->bulkIds.back();
+            victim->bulkIds.pop_back();
+        }
+        if (takeQueuedTrack(libraryId, bulk, track))
+            slot = 0;
+    }
+    if (slot < 0)
+        return -1;
+    Job& job = worker.jobs[slot];
+    job.priority = priority;
+    job.track = std::move(track);
+    job.generation = generation.load();
+    job.active = true;
+    ++numActive;
+    return slot;
+}
+
+bool TrackAnalyser::takeQueuedTrack(long int libraryId, Priority priority, Track& track)
+{
+    auto queued = queuedTracks.find(libraryId);
+    if (queued == queuedTracks.end() || queued->second.priority != priority)
+        return false;
+    track = std::move(queued->second.track);
+    queuedTracks.erase(queued);
+    return true;
+}
+
+void TrackAnalyser::finishTrack(Worker& worker, int slot, Analysis analysis)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        Job& job = worker.jobs[slot];
+        job.active = false;
+        --numActive;
+        if (job.generation != generation.load())
+            return;
+        readyAnalyses.push_back(std::move(analysis));
+        finished = queuedTracks.empty() && numActive == 0;
+    }
+    triggerAsyncUpdate();
+}
+
+bool TrackAnalyser::hasUrgentTracks() const
+{
+    return numUrgent.load() > 0;
+}
+
+bool TrackAnalyser::audioIsPlaying() const
+{
+    return isAudioPlaying && isAudioPlaying();
+}
+
+/* ==================== */
+/* ====== Worker ====== */
+/* ==================== */
+
+TrackAnalyser::Worker::Worker(TrackAnalyser& _owner, int _index) :
+                                    juce::Thread("track analyser " + juce::String(_index + 1)),
+                                    owner(_owner),
+                                    index(_index)
+{
+}
+
+TrackAnalyser::Worker::~Worker()
+{
+}
+
+void TrackAnalyser::Worker::run()
+{
+    while (!threadShouldExit())
+    {
+        // let the app finish starting before touching the disk for bulk tracks, and while a deck plays leave them to the first worker
+        const int startDelayLeft = juce::jmax(0, startDelayMs - (int)(juce::Time::getMillisecondCounter() - owner.startMs));
+        const bool allowBulk = startDelayLeft == 0 && (index == 0 || !owner.audioIsPlaying());
+        const int slot = owner.takeTrack(*this, allowBulk);
+        if (slot < 0)
+        {
+            wait(startDelayLeft > 0 ? startDelayLeft : allowBulk ? -1 : idleCheckMs);
+            continue;
+        }
+        runJob(slot);
+    }
+}
+
+void TrackAnalyser::Worker::runJob(int slot)
+{
+    if (pipelines[slot].stages.empty())
+    {
+        const juce::ScopedLock sl(owner.lock);
+        for (auto& createStage : owner.stageFactories)
+            pipelines[slot].stages.push_back(createStage());
+    }
+    owner.finishTrack(*this, slot, analyseTrack(slot));
+}
+
+TrackAnalyser::Analysis TrackAnalyser::Worker::analyseTrack(int slot)
+{
+    const Job& job = jobs[slot];
+    Pipeline& pipeline = pipelines[slot];
+    Analysis analysis;
+    analysis.libraryId = job.track.libraryId;
+    analysis.signature = job.track.signature;
+    juce::URL url(juce::String(job.track.url));
+    if (!url.isLocalFile())
+        return analysis;
+    std::unique_ptr<juce::AudioFormatReader> reader(owner.formatManager.createReaderFor(url.getLocalFile()));
+    if (reader == nullptr || reader->sampleRate <= 0 || reader->numChannels == 0 || reader->lengthInSamples <= 0)
+        return analysis;
+    const int numChannels = (int)juce::jmin(2u, reader->numChannels);
+    for (auto& stage : pipeline.stages)
+        stage->prepare(job.track, reader->sampleRate, numChannels, reader->lengthInSamples);
+    pipeline.block.setSize(numChannels, blockSize, false, false, true);
+    for (juce::int64 position = 0; position < reader->lengthInSamples; position += blockSize)
+    {
+        if (job.generation != owner.generation.load() || threadShouldExit())
+            return analysis;
+        const bool isBulk = job.priority.load() == bulk;
+        // preempted, the urgent tracks use the other pipeline so this one picks up where it left off
+        if (isBulk && owner.hasUrgentTracks())
+        {
+            int urgentSlot;
+            while (!threadShouldExit() && (urgentSlot = owner.takeTrack(*this, false)) >= 0)
+                runJob(urgentSlot);
+        }
+        const double blockStartMs = juce::Time::getMillisecondCounterHiRes();
+        const int numSamples = (int)juce::jmin((juce::int64)blockSize, reader->lengthInSamples - position);
+        reader->read(&pipeline.block, 0, numSamples, position, true, numChannels > 1);
+        bool wantsMore = false;
+        for (auto& stage : pipeline.stages)
+        {
+            if (stage->isDone())
+                continue;
+            stage->process(pipeline.block, position, numSamples);
+            wantsMore = wantsMore || !stage->isDone();
+        }
+        if (!wantsMore)
+            break;
+        // at most half a core while a deck plays
+        if (isBulk && owner.audioIsPlaying())
+            juce::Thread::sleep(juce::jmax(1, juce::roundToInt(juce::Time::getMillisecondCounterHiRes() - blockStartMs)));
+    }
+    analysis.decoded = true;
+    for (auto& stage : pipeline.stages)
+        stage->finish(analysis);
+    return analysis;
+}
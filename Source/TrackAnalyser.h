@@ -0,0 +1,312 @@
+/*
+  ==============================================================================
+
+    TrackAnalyser.h
+    Created: 3 Nov 2026 10:21:09am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <limits>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "TrackStore.h"
+
+//==============================================================================
+/*
+ Background analysis pipeline for library tracks
+ Each track is decoded exactly once, a block at a time, and every block is handed
+ to each of the stages in turn, so the waveform thumbnail, tempo, beat grid,
+ fingerprint and whatever stages are added later all share one decode and each
+ only costs its own kernel. Decoding stops early once every stage has had enough
+ What the stages find is gathered into one Analysis per track and handed to the
+ message thread in batches
+
+ Tracks are analysed on a worker per spare core, most urgent first. Bulk tracks,
+ such as a library import, are dealt out to the workers in runs, so each works
+ through neighbouring files, and a worker that runs out steals from the far end
+ of the longest run left. A track loaded to a deck or queued to play jumps all of
+ them, and a worker part way through a bulk track sets it aside between blocks to
+ take it. While a deck is playing bulk work shrinks to one worker that rests
+ between blocks, so it never competes with the audio thread
+*/
+class TrackAnalyser  : private juce::AsyncUpdater
+{
+public:
+    TrackAnalyser(juce::AudioFormatManager& _formatManager);
+    ~TrackAnalyser() override;
+
+    /** a library track to analyse */
+    struct Track
+    {
+        long int                    libraryId;
+        std::string                 url;
+        TrackStore::FileSignature   signature;
+    };
+
+    /** everything learnt about a track from one decode, values a stage couldn't find are NaN or -1 */
+    struct Analysis
+    {
+        long int                    libraryId = -1;
+        /** the signature the track was queued with, so a result for a file that has since changed can be told apart */
+        TrackStore::FileSignature   signature;
+        /** false if the file couldn't be opened or decoded, when nothing else is set */
+        bool                        decoded = false;
+        float                       bpm = std::numeric_limits<float>::quiet_NaN();
+        /** seconds from the start of the file to the first beat, the rest follow every 60 / bpm seconds */
+        float                       firstBeat = std::numeric_limits<float>::quiet_NaN();
+        /** as TrackStore keeps it, 0 - 11 major from C and 12 - 23 minor from C */
+        int                         key = -1;
+        /** EBU R128 integrated loudness in LUFS */
+        float                       loudness = std::numeric_limits<float>::quiet_NaN();
+        /** highest true peak in dBTP, NaN if the track has no sound */
+        float                       truePeak = std::numeric_limits<float>::quiet_NaN();
+        /** where the sound, intro and outro lie, all NaN if the track has no sound */
+        TrackStore::MixPoints       mixPoints;
+        /** see Fingerprinter, empty if the track has no sound */
+        std::vector<juce::uint32>   fingerprint;
+    };
+
+    //==============================================================================
+    /*
+     One kernel of the pipeline, fed every decoded block of a track
+     Each worker makes its own, so a stage is only ever used on one thread
+    */
+    class Stage
+    {
+    public:
+        virtual ~Stage() {}
+
+        /**
+         Stage::prepare()
+         Input                  Track, double, int, juce::int64
+         Output                 none
+         Called before the first block of each track, resets the stage for it
+         */
+        virtual void prepare(const Track& track, double sampleRate, int numChannels, juce::int64 lengthInSamples) = 0;
+
+        /**
+         Stage::process()
+         Input                  juce::AudioBuffer, juce::int64, int
+         Output                 none
+         @param position        sample in the file of the block's first sample
+         Called with each block in order from the start of the file, mono files have one channel, the rest two
+         */
+        virtual void process(const juce::AudioBuffer<float>& block, juce::int64 position, int numSamples) = 0;
+
+        /** Stage::isDone() returns true once the stage needs no more of the track, it is then sent no more blocks */
+        virtual bool isDone() const { return false; }
+
+        /**
+         Stage::finish()
+         Input                  Analysis
+         Output                 none
+         Writes what the stage found. Stages finish in the order they were added, so one can build on an earlier one's result
+         */
+        virtual void finish(Analysis& analysis) = 0;
+    };
+
+    /** how soon a track is wanted, tracks are analysed most urgent first */
+    enum Priority
+    {
+        /** imports and rescans, throttled while a deck plays and set aside for anything more urgent */
+        bulk = 0,
+        /** queued to play */
+        queued,
+        /** loaded to a deck */
+        loaded,
+        numPriorities
+    };
+
+    /** called on the message thread with each batch of tracks analysed */
+    std::function<void(std::vector<Analysis>&)> onAnalysed;
+    /** called on the message thread whenever every queued track has been analysed */
+    std::function<void()> onFinished;
+    /** returns true while a deck is playing, set before the first analyse(). Called on the workers, so must be safe to call from any thread */
+    std::function<bool()> isAudioPlaying;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     TrackAnalyser::addStage()
+     Input                  std::function
+     Output                 none
+     @param createStage     makes a new instance of the stage, each worker runs its own
+     Adds a stage to the end of the pipeline, call before the first analyse()
+     */
+    void addStage(std::function<std::unique_ptr<Stage>()> createStage);
+
+    /**
+     TrackAnalyser::analyse()
+     Input                  std::vector<Track>, Priority
+     Output                 none
+     Queues the tracks behind any already waiting at the same priority. A track that
+     is already queued or being analysed keeps its place, with the newer signature,
+     unless it is now wanted sooner, when it is promoted. Bulk tracks wait a little
+     so the app can finish starting, more urgent ones don't
+     */
+    void analyse(const std::vector<Track>& tracks, Priority priority = bulk);
+
+    /** TrackAnalyser::cancel() forgets every queued track and drops the ones being analysed */
+    void cancel();
+
+private:
+    /** a track being analysed, and what it was taken with */
+    struct Job
+    {
+        Track                       track;
+        std::atomic<int>            priority {bulk};
+        /** TrackAnalyser::generation when the track was taken, the job is dropped once that moves on */
+        juce::uint32                generation = 0;
+        bool                        active = false;
+    };
+
+    //==============================================================================
+    /*
+     One analysis thread, with a pipeline of its own for bulk tracks and one for
+     the urgent tracks it takes while a bulk track is set aside
+    */
+    class Worker  : public juce::Thread
+    {
+    public:
+        Worker(TrackAnalyser& _owner, int _index);
+        ~Worker() override;
+
+        /** ids of the bulk tracks dealt to this worker, it takes from the front and others steal from the back */
+        std::deque<long int> bulkIds;
+        /** the bulk job, and the urgent job that may have preempted it */
+        Job jobs[2];
+
+    private:
+        // implement Thread
+        void run() override;
+
+        /**
+         Worker::runJob()
+         Input                  int
+         Output                 none
+         @param slot            0 for the bulk job, 1 for the urgent one
+         Analyses a job taken by TrackAnalyser::takeTrack() and hands its result back
+         */
+        void runJob(int slot);
+
+        /**
+         Worker::analyseTrack()
+         Input                  int
+         Output                 Analysis
+         Decodes the slot's track through its pipeline, stopping early if cancelled
+         A bulk track runs any urgent tracks waiting between its blocks, and rests
+         after each block for as long as it took while a deck is playing
+         */
+        Analysis analyseTrack(int slot);
+
+        struct Pipeline
+        {
+            std::vector<std::unique_ptr<Stage>> stages;
+            /** the block each piece of a track is decoded into */
+            juce::AudioBuffer<float>            block;
+        };
+
+        TrackAnalyser& owner;
+        const int index;
+        /** made on the first job, one per slot */
+        Pipeline pipelines[2];
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+    };
+
+    // implement AsyncUpdater
+    void handleAsyncUpdate() override;
+
+    /**
+     TrackAnalyser::takeTrack()
+     Input                  Worker, bool
+     Output                 int
+     @param allowBulk       false to only take urgent tracks
+     Moves the next track for a worker into one of its job slots and returns the
+     slot, or -1 if there is nothing for it. Urgent tracks come first, most urgent
+     first, then the worker's own bulk tracks, then the far end of the longest other worker's
+     */
+    int takeTrack(Worker& worker, bool allowBulk);
+
+    /**
+     TrackAnalyser::takeQueuedTrack()
+     Input                  long int, Priority, Track
+     Output                 bool
+     Moves a track out of queuedTracks as it is taken from the queue for a priority, called under lock
+     Returns false for an entry left behind when its track was promoted, or already taken, which is skipped
+     */
+    bool takeQueuedTrack(long int libraryId, Priority priority, Track& track);
+
+    /**
+     TrackAnalyser::finishTrack()
+     Input                  Worker, int, Analysis
+     Output                 none
+     Frees the job slot and passes the analysis to the message thread, unless cancelled meanwhile
+     */
+    void finishTrack(Worker& worker, int slot, Analysis analysis);
+
+    /** TrackAnalyser::hasUrgentTracks() returns true if tracks more urgent than bulk are waiting, without locking */
+    bool hasUrgentTracks() const;
+    /** TrackAnalyser::audioIsPlaying() returns isAudioPlaying(), or false if it isn't set */
+    bool audioIsPlaying() const;
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    /** shared with the rest of the app, only used to create readers */
+    juce::AudioFormatManager& formatManager;
+    /** millisecond counter when the analyser was made, bulk tracks wait startDelayMs from it */
+    const juce::uint32 startMs;
+
+    /** guards everything below that the threads share */
+    juce::CriticalSection lock;
+    /** the pipeline, each worker makes its stages from these */
+    std::vector<std::function<std::unique_ptr<Stage>()>> stageFactories;
+    /** a queued track, with the signature it was last queued with, and the priority it waits at */
+    struct QueuedTrack
+    {
+        Track                       track;
+        Priority                    priority;
+    };
+    /** every queued track by library id, so queueing a track again costs nothing however long the queues are */
+    std::unordered_map<long int, QueuedTrack> queuedTracks;
+    /** ids of the tracks waiting at each priority above bulk, bulk tracks wait with the workers */
+    std::deque<long int> urgentIds[numPriorities];
+    /** jobs taken but not yet finished */
+    int numActive = 0;
+    /** analyses waiting for the message thread */
+    std::vector<Analysis> readyAnalyses;
+    /** set when the queue runs dry */
+    bool finished = false;
+
+    /** the size of urgentIds, read between blocks, counting entries that will be skipped */
+    std::atomic<int> numUrgent {0};
+    /** moved on by cancel() */
+    std::atomic<juce::uint32> generation {0};
+
+    /** one per core but one, the rest are left to the audio and message threads */
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    /** how long after the analyser starts the first bulk track is decoded */
+    static constexpr int startDelayMs = 15000;
+    /** samples decoded at a time */
+    static constexpr int blockSize = 8192;
+    /** how often a worker kept off bulk tracks while a deck plays looks again */
+    static constexpr int idleCheckMs = 1000;
+    static constexpr int maxWorkers = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackAnalyser)
+};
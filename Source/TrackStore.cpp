@@ -0,0 +1,711 @@
+/*
+  ==============================================================================
+
+    TrackStore.cpp
+    Created: 22 Oct 2026 10:12:04am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "TrackStore.h"
+#include <algorithm>
+#include <cmath>
+
+constexpr juce::uint32 TrackStore::noRow;
+constexpr juce::uint32 TrackStore::mappedString;
+
+TrackStore::TrackStore()
+{
+}
+
+TrackStore::~TrackStore()
+{
+}
+
+/* ============================ */
+/* ====== rows and order ====== */
+/* ============================ */
+
+juce::uint32 TrackStore::add(const TrackInfo& info)
+{
+    // NaN fails every comparison, so unanalysed tracks drop out of range filters
+    const float unknownValue = std::numeric_limits<float>::quiet_NaN();
+    // split the url after the last '/' so tracks in one folder share the folder string
+    size_t split = info.url.find_last_of('/');
+    split = split == std::string::npos ? 0 : split + 1;
+    juce::uint32 folder = strings.intern(info.url.data(), split);
+    juce::uint32 name = strings.intern(info.url.data() + split, info.url.size() - split);
+    juce::uint32 title = strings.intern(info.title.data(), info.title.size());
+    juce::uint32 artist = strings.intern(info.artist.data(), info.artist.size());
+    juce::uint32 album = strings.intern(info.album.data(), info.album.size());
+    juce::uint32 row;
+    if (!freeRows.empty())
+    {
+        row = freeRows.back();
+        freeRows.pop_back();
+        libraryIds[row] = info.libraryId;
+        lengths[row] = info.length;
+        datesAdded[row] = info.dateAdded;
+        playCounts[row] = info.playCount;
+        bpms[row] = unknownValue;
+        loudnesses[row] = unknownValue;
+        truePeaks[row] = unknownValue;
+        firstBeats[row] = unknownValue;
+        titles[row] = title;
+        artists[row] = artist;
+        albums[row] = album;
+        urlFolders[row] = folder;
+        urlNames[row] = name;
+        keys[row] = 0;
+        flags[row] = 0;
+        signatures[row] = info.signature;
+        mixPoints[row] = MixPoints();
+    }
+    else
+    {
+        row = (juce::uint32)libraryIds.size();
+        libraryIds.push_back(info.libraryId);
+        lengths.push_back(info.length);
+        datesAdded.push_back(info.dateAdded);
+        playCounts.push_back(info.playCount);
+        bpms.push_back(unknownValue);
+        loudnesses.push_back(unknownValue);
+        truePeaks.push_back(unknownValue);
+        firstBeats.push_back(unknownValue);
+        titles.push_back(title);
+        artists.push_back(artist);
+        albums.push_back(album);
+        urlFolders.push_back(folder);
+        urlNames.push_back(name);
+        keys.push_back(0);
+        flags.push_back(0);
+        signatures.push_back(info.signature);
+        mixPoints.emplace_back();
+    }
+    order.push_back(row);
+    rowsById[info.libraryId] = row;
+    ++generation;
+    return row;
+}
+
+juce::uint32 TrackStore::addFromIndex(const std::shared_ptr<LibraryIndex>& libraryIndex, int record)
+{
+    jassert(index == nullptr || index == libraryIndex);
+    index = libraryIndex;
+    const LibraryIndex::Record& fields = index->getRecord(record);
+    TrackInfo info;
+    info.libraryId = fields.libraryId;
+    info.length = fields.length;
+    info.dateAdded = fields.dateAdded;
+    info.playCount = fields.playCount;
+    info.signature.modified = fields.fileModified;
+    info.signature.size = fields.fileSize;
+    info.signature.fileId = fields.fileId;
+    // the empty strings add() interns are swapped for the record's strings in the mapping
+    juce::uint32 row = add(info);
+    const juce::uint32 handle = mappedString | (juce::uint32)record;
+    titles[row] = handle;
+    artists[row] = handle;
+    albums[row] = handle;
+    urlFolders[row] = handle;
+    urlNames[row] = handle;
+    if (!std::isnan(fields.bpm))
+        setBpm(row, fields.bpm);
+    if (fields.key != LibraryIndex::noKey)
+        setKey(row, fields.key);
+    if (!std::isnan(fields.loudness))
+        setLoudness(row, fields.loudness);
+    if (!std::isnan(fields.truePeak))
+        setTruePeak(row, fields.truePeak);
+    if (!std::isnan(fields.firstBeat))
+        setFirstBeat(row, fields.firstBeat);
+    if (!std::isnan(fields.soundStart))
+        setMixPoints(row, { fields.soundStart, fields.introEnd, fields.outroStart, fields.soundEnd });
+    if (fields.analysed != 0)
+        setAnalysed(row);
+    return row;
+}
+
+void TrackStore::remove(juce::uint32 row)
+{
+    auto position = std::find(order.begin(), order.end(), row);
+    if (position == order.end())
+        return;
+    order.erase(position);
+    // the row's strings stay in the pool until the strings are compacted
+    auto entry = rowsById.find(libraryIds[row]);
+    if (entry != rowsById.end() && entry->second == row)
+        rowsById.erase(entry);
+    libraryIds[row] = -1;
+    freeRows.push_back(row);
+    ++generation;
+}
+
+void TrackStore::remove(const std::vector<juce::uint32>& rows)
+{
+    // 1 for a row in the library that is to go, 2 once it has gone
+    std::vector<juce::uint8> removing(libraryIds.size(), 0);
+    for (juce::uint32 row : rows)
+        if (row < libraryIds.size() && libraryIds[row] >= 0)
+            removing[row] = 1;
+    order.erase(std::remove_if(order.begin(), order.end(), [&removing] (juce::uint32 row) { return removing[row] != 0; }),
+                order.end());
+    for (juce::uint32 row : rows)
+    {
+        if (row >= libraryIds.size() || removing[row] != 1)
+            continue;
+        removing[row] = 2;
+        auto entry = rowsById.find(libraryIds[row]);
+        if (entry != rowsById.end() && entry->second == row)
+            rowsById.erase(entry);
+        libraryIds[row] = -1;
+        freeRows.push_back(row);
+    }
+    ++generation;
+}
+
+void TrackStore::move(juce::uint32 row, int index)
+{
+    auto position = std::find(order.begin(), order.end(), row);
+    if (position == order.end())
+        return;
+    order.erase(position);
+    index = juce::jlimit(0, (int)order.size(), index);
+    order.insert(order.begin() + index, row);
+    ++generation;
+}
+
+void TrackStore::move(const std::vector<juce::uint32>& rows, int index)
+{
+    std::vector<juce::uint8> moving(libraryIds.size(), 0);
+    for (juce::uint32 row : rows)
+        if (row < libraryIds.size())
+            moving[row] = 1;
+    std::vector<juce::uint32> block, staying;
+    staying.reserve(order.size());
+    for (juce::uint32 row : order)
+        (moving[row] != 0 ? block : staying).push_back(row);
+    if (block.empty())
+        return;
+    index = juce::jlimit(0, (int)staying.size(), index);
+    staying.insert(staying.begin() + index, block.begin(), block.end());
+    order.swap(staying);
+    ++generation;
+}
+
+void TrackStore::update(juce::uint32 row, const TrackInfo& info)
+{
+    size_t split = info.url.find_last_of('/');
+    split = split == std::string::npos ? 0 : split + 1;
+    urlFolders[row] = strings.intern(info.url.data(), split);
+    urlNames[row] = strings.intern(info.url.data() + split, info.url.size() - split);
+    titles[row] = strings.intern(info.title.data(), info.title.size());
+    artists[row] = strings.intern(info.artist.data(), info.artist.size());
+    albums[row] = strings.intern(info.album.data(), info.album.size());
+    lengths[row] = info.length;
+    datesAdded[row] = info.dateAdded;
+    playCounts[row] = info.playCount;
+    signatures[row] = info.signature;
+    flags[row] &= (juce::uint8)~unplayable;
+    // the row's place is unchanged, but views sorted or filtered by its fields are stale
+    ++generation;
+}
+
+void TrackStore::clear()
+{
+    libraryIds.clear();
+    lengths.clear();
+    datesAdded.clear();
+    playCounts.clear();
+    bpms.clear();
+    loudnesses.clear();
+    truePeaks.clear();
+    firstBeats.clear();
+    titles.clear();
+    artists.clear();
+    albums.clear();
+    urlFolders.clear();
+    urlNames.clear();
+    keys.clear();
+    flags.clear();
+    signatures.clear();
+    mixPoints.clear();
+    order.clear();
+    rowsById.clear();
+    freeRows.clear();
+    strings.clear();
+    index.reset();
+    ++generation;
+}
+
+bool TrackStore::hasUnusedStrings() const
+{
+    // a string shared by many tracks is counted once, strings in the index's mapping aren't in the pool
+    std::vector<juce::uint8> used(strings.getNumStrings(), 0);
+    size_t usedBytes = 0;
+    for (const std::vector<juce::uint32>* column : { &titles, &artists, &albums, &urlFolders, &urlNames })
+    {
+        for (juce::uint32 row : order)
+        {
+            juce::uint32 handle = (*column)[row];
+            if ((handle & mappedString) == 0 && used[handle] == 0)
+            {
+                used[handle] = 1;
+                usedBytes += (size_t)strings.getLength(handle);
+            }
+        }
+    }
+    return usedBytes * 2 < strings.getNumBytes();
+}
+
+void TrackStore::compactStrings()
+{
+    // each column's strings are added in library order, so a scan of one column reads the pool in order
+    StringPool compacted;
+    std::vector<juce::uint32> newHandles(strings.getNumStrings(), noRow);
+    const juce::uint32 empty = compacted.intern("", 0);
+    for (std::vector<juce::uint32>* column : { &titles, &artists, &albums, &urlFolders, &urlNames })
+    {
+        for (juce::uint32 row : order)
+        {
+            juce::uint32& handle = (*column)[row];
+            if ((handle & mappedString) != 0)
+                continue;
+            if (newHandles[handle] == noRow)
+                newHandles[handle] = compacted.intern(strings.getData(handle), (size_t)strings.getLength(handle));
+            handle = newHandles[handle];
+        }
+        for (juce::uint32 row : freeRows)
+            (*column)[row] = empty;
+    }
+    strings = std::move(compacted);
+}
+
+void TrackStore::releaseIndex()
+{
+    if (index == nullptr)
+        return;
+    const Field fields[] = { Field::title, Field::artist, Field::album, Field::urlFolder, Field::urlName };
+    std::vector<juce::uint32>* columns[] = { &titles, &artists, &albums, &urlFolders, &urlNames };
+    for (int i = 0; i < 5; ++i)
+    {
+        std::vector<juce::uint32>& column = *columns[i];
+        for (juce::uint32 row = 0; row < (juce::uint32)column.size(); ++row)
+        {
+            if ((column[row] & mappedString) == 0)
+                continue;
+            // removed rows don't need their strings
+            int numBytes = 0;
+            const char* data = libraryIds[row] >= 0 ? getString(fields[i], column[row], numBytes) : "";
+            column[row] = strings.intern(data, (size_t)numBytes);
+        }
+    }
+    index.reset();
+}
+
+int TrackStore::size() const
+{
+    return (int)order.size();
+}
+
+const std::vector<juce::uint32>& TrackStore::getOrder() const
+{
+    return order;
+}
+
+juce::uint32 TrackStore::rowAt(int index) const
+{
+    jassert(index >= 0 && index < (int)order.size());
+    return order[index];
+}
+
+juce::uint32 TrackStore::findRow(juce::int64 libraryId) const
+{
+    auto entry = rowsById.find(libraryId);
+    return entry != rowsById.end() ? entry->second : noRow;
+}
+
+juce::uint32 TrackStore::getNumRows() const
+{
+    return (juce::uint32)libraryIds.size();
+}
+
+juce::uint32 TrackStore::getGeneration() const
+{
+    return generation;
+}
+
+/* ============================== */
+/* ====== column accessors ====== */
+/* ============================== */
+
+juce::int64 TrackStore::getLibraryId(juce::uint32 row) const
+{
+    return libraryIds[row];
+}
+
+float TrackStore::getLength(juce::uint32 row) const
+{
+    return lengths[row];
+}
+
+juce::String TrackStore::getTitle(juce::uint32 row) const
+{
+    int numBytes;
+    const char* data = getTitleData(row, numBytes);
+    return juce::String::fromUTF8(data, numBytes);
+}
+
+const char* TrackStore::getTitleData(juce::uint32 row, int& numBytes) const
+{
+    return getString(Field::title, titles[row], numBytes);
+}
+
+const char* TrackStore::getFileNameData(juce::uint32 row, int& numBytes) const
+{
+    return getString(Field::urlName, urlNames[row], numBytes);
+}
+
+juce::String TrackStore::getArtist(juce::uint32 row) const
+{
+    int numBytes;
+    const char* data = getArtistData(row, numBytes);
+    return juce::String::fromUTF8(data, numBytes);
+}
+
+const char* TrackStore::getArtistData(juce::uint32 row, int& numBytes) const
+{
+    return getString(Field::artist, artists[row], numBytes);
+}
+
+juce::String TrackStore::getAlbum(juce::uint32 row) const
+{
+    int numBytes;
+    const char* data = getAlbumData(row, numBytes);
+    return juce::String::fromUTF8(data, numBytes);
+}
+
+const char* TrackStore::getAlbumData(juce::uint32 row, int& numBytes) const
+{
+    return getString(Field::album, albums[row], numBytes);
+}
+
+std::string TrackStore::getURLString(juce::uint32 row) const
+{
+    int numBytes;
+    const char* data = getString(Field::urlFolder, urlFolders[row], numBytes);
+    std::string url(data, (size_t)numBytes);
+    data = getString(Field::urlName, urlNames[row], numBytes);
+    url.append(data, (size_t)numBytes);
+    return url;
+}
+
+juce::URL TrackStore::getURL(juce::uint32 row) const
+{
+    return juce::URL(juce::String(getURLString(row)));
+}
+
+TrackStore::TrackInfo TrackStore::getInfo(juce::uint32 row) const
+{
+    TrackInfo info;
+    int numBytes;
+    const char* data = getTitleData(row, numBytes);
+    info.libraryId = libraryIds[row];
+    info.title.assign(data, (size_t)numBytes);
+    info.url = getURLString(row);
+    data = getArtistData(row, numBytes);
+    info.artist.assign(data, (size_t)numBytes);
+    data = getAlbumData(row, numBytes);
+    info.album.assign(data, (size_t)numBytes);
+    info.length = lengths[row];
+    info.dateAdded = datesAdded[row];
+    info.playCount = playCounts[row];
+    info.signature = signatures[row];
+    return info;
+}
+
+juce::int64 TrackStore::getDateAdded(juce::uint32 row) const
+{
+    return datesAdded[row];
+}
+
+juce::uint32 TrackStore::getPlayCount(juce::uint32 row) const
+{
+    return playCounts[row];
+}
+
+void TrackStore::setPlayCount(juce::uint32 row, juce::uint32 playCount)
+{
+    playCounts[row] = playCount;
+}
+
+const TrackStore::FileSignature& TrackStore::getSignature(juce::uint32 row) const
+{
+    return signatures[row];
+}
+
+bool TrackStore::hasBpm(juce::uint32 row) const
+{
+    return (flags[row] & bpmKnown) != 0;
+}
+
+float TrackStore::getBpm(juce::uint32 row) const
+{
+    return bpms[row];
+}
+
+void TrackStore::setBpm(juce::uint32 row, float bpm)
+{
+    bpms[row] = bpm;
+    flags[row] |= bpmKnown;
+}
+
+bool TrackStore::hasKey(juce::uint32 row) const
+{
+    return (flags[row] & keyKnown) != 0;
+}
+
+int TrackStore::getKey(juce::uint32 row) const
+{
+    return keys[row];
+}
+
+void TrackStore::setKey(juce::uint32 row, int key)
+{
+    keys[row] = (juce::uint8)juce::jlimit(0, 23, key);
+    flags[row] |= keyKnown;
+}
+
+bool TrackStore::hasLoudness(juce::uint32 row) const
+{
+    return (flags[row] & loudnessKnown) != 0;
+}
+
+float TrackStore::getLoudness(juce::uint32 row) const
+{
+    return loudnesses[row];
+}
+
+void TrackStore::setLoudness(juce::uint32 row, float lufs)
+{
+    loudnesses[row] = lufs;
+    flags[row] |= loudnessKnown;
+}
+
+bool TrackStore::hasTruePeak(juce::uint32 row) const
+{
+    return (flags[row] & truePeakKnown) != 0;
+}
+
+float TrackStore::getTruePeak(juce::uint32 row) const
+{
+    return truePeaks[row];
+}
+
+void TrackStore::setTruePeak(juce::uint32 row, float dbtp)
+{
+    truePeaks[row] = dbtp;
+    flags[row] |= truePeakKnown;
+}
+
+bool TrackStore::hasBeatGrid(juce::uint32 row) const
+{
+    return (flags[row] & beatGridKnown) != 0;
+}
+
+float TrackStore::getFirstBeat(juce::uint32 row) const
+{
+    return firstBeats[row];
+}
+
+void TrackStore::setFirstBeat(juce::uint32 row, float seconds)
+{
+    firstBeats[row] = seconds;
+    flags[row] |= beatGridKnown;
+}
+
+bool TrackStore::hasMixPoints(juce::uint32 row) const
+{
+    return (flags[row] & mixPointsKnown) != 0;
+}
+
+const TrackStore::MixPoints& TrackStore::getMixPoints(juce::uint32 row) const
+{
+    return mixPoints[row];
+}
+
+void TrackStore::setMixPoints(juce::uint32 row, const MixPoints& points)
+{
+    mixPoints[row] = points;
+    flags[row] |= mixPointsKnown;
+}
+
+bool TrackStore::isAnalysed(juce::uint32 row) const
+{
+    return (flags[row] & analysed) != 0;
+}
+
+void TrackStore::setAnalysed(juce::uint32 row)
+{
+    flags[row] |= analysed;
+}
+
+void TrackStore::clearAnalysis(juce::uint32 row)
+{
+    bpms[row] = std::numeric_limits<float>::quiet_NaN();
+    loudnesses[row] = std::numeric_limits<float>::quiet_NaN();
+    truePeaks[row] = std::numeric_limits<float>::quiet_NaN();
+    firstBeats[row] = std::numeric_limits<float>::quiet_NaN();
+    mixPoints[row] = MixPoints();
+    keys[row] = 0;
+    flags[row] &= unplayable;
+}
+
+bool TrackStore::isPlayable(juce::uint32 row) const
+{
+    return (flags[row] & unplayable) == 0;
+}
+
+void TrackStore::setPlayable(juce::uint32 row, bool playable)
+{
+    if (playable)
+        flags[row] &= (juce::uint8)~unplayable;
+    else
+        flags[row] |= unplayable;
+}
+
+const float* TrackStore::getLengthColumn() const
+{
+    return lengths.data();
+}
+
+const float* TrackStore::getBpmColumn() const
+{
+    return bpms.data();
+}
+
+const float* TrackStore::getLoudnessColumn() const
+{
+    return loudnesses.data();
+}
+
+const juce::uint8* TrackStore::getKeyColumn() const
+{
+    return keys.data();
+}
+
+/* ========================= */
+/* ====== string pool ====== */
+/* ========================= */
+
+const char* TrackStore::getString(Field field, juce::uint32 handle, int& numBytes) const
+{
+    if ((handle & mappedString) == 0)
+    {
+        numBytes = strings.getLength(handle);
+        return strings.getData(handle);
+    }
+    const LibraryIndex::Record& record = index->getRecord((int)(handle & ~mappedString));
+    switch (field)
+    {
+        case Field::title:
+            numBytes = (int)record.titleLength;
+            return index->getString(record.titleOffset);
+        case Field::artist:
+            numBytes = (int)record.artistLength;
+            return index->getString(record.artistOffset);
+        case Field::album:
+            numBytes = (int)record.albumLength;
+            return index->getString(record.albumOffset);
+        case Field::urlFolder:
+        case Field::urlName:
+            break;
+    }
+    // split the url after the last '/', as add() does
+    const char* url = index->getString(record.urlOffset);
+    int split = (int)record.urlLength;
+    while (split > 0 && url[split - 1] != '/')
+        --split;
+    if (field == Field::urlFolder)
+    {
+        numBytes = split;
+        return url;
+    }
+    numBytes = (int)record.urlLength - split;
+    return url + split;
+}
+
+juce::uint32 TrackStore::StringPool::intern(const char* data, size_t numBytes)
+{
+    // keep the table at most half full
+    if ((offsets.size() + 1) * 2 > slots.size())
+        growSlots();
+    juce::uint32 mask = (juce::uint32)slots.size() - 1;
+    for (juce::uint32 slot = hash(data, numBytes) & mask; ; slot = (slot + 1) & mask)
+    {
+        juce::uint32 handle = slots[slot];
+        if (handle == 0)
+        {
+            chars.insert(chars.end(), data, data + numBytes);
+            offsets.push_back((juce::uint32)chars.size());
+            slots[slot] = (juce::uint32)offsets.size();
+            return (juce::uint32)offsets.size() - 1;
+        }
+        --handle;
+        if ((size_t)getLength(handle) == numBytes && std::equal(data, data + numBytes, getData(handle)))
+            return handle;
+    }
+}
+
+const char* TrackStore::StringPool::getData(juce::uint32 handle) const
+{
+    juce::uint32 start = handle == 0 ? 0 : offsets[handle - 1];
+    return chars.data() + start;
+}
+
+int TrackStore::StringPool::getLength(juce::uint32 handle) const
+{
+    juce::uint32 start = handle == 0 ? 0 : offsets[handle - 1];
+    return (int)(offsets[handle] - start);
+}
+
+juce::uint32 TrackStore::StringPool::getNumStrings() const
+{
+    return (juce::uint32)offsets.size();
+}
+
+size_t TrackStore::StringPool::getNumBytes() const
+{
+    return chars.size();
+}
+
+void TrackStore::StringPool::clear()
+{
+    std::vector<char>().swap(chars);
+    std::vector<juce::uint32>().swap(offsets);
+    std::vector<juce::uint32>().swap(slots);
+}
+
+juce::uint32 TrackStore::StringPool::hash(const char* data, size_t numBytes)
+{
+    // FNV-1a
+    juce::uint32 h = 2166136261u;
+    for (size_t i = 0; i < numBytes; ++i)
+        h = (h ^ (juce::uint8)data[i]) * 16777619u;
+    return h;
+}
+
+void TrackStore::StringPool::growSlots()
+{
+    std::vector<juce::uint32> grown(std::max((size_t)64, slots.size() * 2), 0);
+    juce::uint32 mask = (juce::uint32)grown.size() - 1;
+    for (juce::uint32 handle = 0; handle < (juce::uint32)offsets.size(); ++handle)
+    {
+        juce::uint32 slot = hash(getData(handle), (size_t)getLength(handle)) & mask;
+        while (grown[slot] != 0)
+            slot = (slot + 1) & mask;
+        grown[slot] = handle + 1;
+    }
+    slots.swap(grown);
+}
@@ -0,0 +1,285 @@
+/*
+  ==============================================================================
+
+    TrackStore.h
+    Created: 22 Oct 2026 10:12:04am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include "LibraryIndex.h"
+
+//==============================================================================
+/*
+ Column store for the tracks in the music library
+ Each track is a row, each field a column held in its own contiguous vector, so
+ scanning one field touches nothing else. Titles, artists, albums and urls are
+ interned in a string pool, urls split into folder and file name so tracks in one folder share
+ the folder. Tracks loaded from a LibraryIndex read their strings from its mapping
+ instead, until they are changed or the index is released. Rows keep their number until
+ removed, so views of the library can hold 32 bit row numbers instead of copies of tracks.
+ A hash table maps library ids to rows, and many rows can be removed or moved in one pass over the order
+*/
+class TrackStore
+{
+public:
+    /** what a track's file looked like when it was last probed, so a change can be noticed without reading it */
+    struct FileSignature
+    {
+        juce::int64     modified = 0;   // in ms since 1970
+        juce::int64     size = -1;      // in bytes, -1 if unknown or the file is missing
+        juce::uint64    fileId = 0;     // inode number, which survives a rename, 0 if unknown
+        bool operator== (const FileSignature& other) const { return modified == other.modified && size == other.size && fileId == other.fileId; }
+        bool operator!= (const FileSignature& other) const { return !(*this == other); }
+    };
+    /** a track as it is added, imported or journalled */
+    struct TrackInfo
+    {
+        juce::int64     libraryId = -1;
+        std::string     title;
+        std::string     url;
+        std::string     artist;         // empty if unknown
+        std::string     album;
+        float           length = 0;     // in seconds
+        juce::int64     dateAdded = 0;  // in ms since 1970, 0 if unknown
+        juce::uint32    playCount = 0;
+        FileSignature   signature;
+    };
+    /** where a track's sound and its intro and outro lie, in seconds from the start of the file, NaN if unknown */
+    struct MixPoints
+    {
+        float           soundStart = std::numeric_limits<float>::quiet_NaN();   // where the leading silence ends
+        float           introEnd = std::numeric_limits<float>::quiet_NaN();     // the phrase the body of the track starts on, the intro runs up to it
+        float           outroStart = std::numeric_limits<float>::quiet_NaN();   // the phrase after the body's last, the outro runs from it
+        float           soundEnd = std::numeric_limits<float>::quiet_NaN();     // where the trailing silence starts
+    };
+    /** returned when there is no row for a library id */
+    static constexpr juce::uint32 noRow = 0xffffffff;
+    
+    TrackStore();
+    ~TrackStore();
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+    
+    /**
+     TrackStore::add()
+     Input                  TrackInfo
+     Output                 juce::uint32 row of the new track
+     Adds a track to the end of the library order, reusing the row of a removed track if there is one
+     */
+    juce::uint32 add(const TrackInfo& info);
+    
+    /**
+     TrackStore::addFromIndex()
+     Input                  std::shared_ptr<LibraryIndex>, int
+     Output                 juce::uint32 row of the new track
+     @param record          index of the record in the open LibraryIndex
+     Adds the track in a record to the end of the library order, as add() but copying only the fixed width
+     fields and analysis. Its strings stay in the index's mapping, which the store keeps open until
+     releaseIndex() or clear(). Every track must come from the same index
+     */
+    juce::uint32 addFromIndex(const std::shared_ptr<LibraryIndex>& libraryIndex, int record);
+    
+    /** TrackStore::remove() removes the track in a row from the library order and frees the row */
+    void remove(juce::uint32 row);
+    
+    /** TrackStore::remove() removes the tracks in many rows with one pass over the library order */
+    void remove(const std::vector<juce::uint32>& rows);
+    
+    /**
+     TrackStore::move()
+     Input                  juce::uint32, int
+     Output                 none
+     @param index           position in the library order, clamped to the end
+     Moves the track in a row to a new position in the library order
+     */
+    void move(juce::uint32 row, int index);
+    
+    /**
+     TrackStore::move()
+     Input                  std::vector<juce::uint32>, int
+     Output                 none
+     @param index           position of the first moved track among the tracks that stay put, clamped to the end
+     Moves the tracks in many rows together as one block, keeping their library order,
+     with one pass over the library order
+     */
+    void move(const std::vector<juce::uint32>& rows, int index);
+    
+    /**
+     TrackStore::update()
+     Input                  juce::uint32, TrackInfo
+     Output                 none
+     Replaces every field of the track in a row but its library id, keeping its place in the library order
+     The track counts as playable again, as it has a new or changed file
+     */
+    void update(juce::uint32 row, const TrackInfo& info);
+    
+    /** TrackStore::clear() removes every track and releases the string pool and the index */
+    void clear();
+    
+    /** TrackStore::hasUnusedStrings() returns true once removed and changed tracks have left most of the string pool unused */
+    bool hasUnusedStrings() const;
+    
+    /**
+     TrackStore::compactStrings()
+     Input                  none
+     Output                 none
+     Rebuilds the string pool from the strings of the tracks in the library, releasing the rest
+     Rows and the library order are unchanged, but every string in the pool moves
+     Strings still read from the index's mapping are left there
+     */
+    void compactStrings();
+    
+    /**
+     TrackStore::releaseIndex()
+     Input                  none
+     Output                 none
+     Copies the strings still read from the LibraryIndex into the string pool and lets go of the index,
+     so its file is no longer mapped by this store. Copies of the store keep their own hold on it
+     */
+    void releaseIndex();
+    
+    /** TrackStore::size() returns the number of tracks in the library */
+    int size() const;
+    
+    /** TrackStore::getOrder() returns the rows of every track in library order */
+    const std::vector<juce::uint32>& getOrder() const;
+    
+    /** TrackStore::rowAt() returns the row of the track at a position in the library order */
+    juce::uint32 rowAt(int index) const;
+    
+    /** TrackStore::findRow() returns the row holding a library id, or noRow */
+    juce::uint32 findRow(juce::int64 libraryId) const;
+    
+    /** TrackStore::getNumRows() returns one past the highest row in use, for tables indexed by row */
+    juce::uint32 getNumRows() const;
+    
+    /** TrackStore::getGeneration() returns a count that changes whenever tracks are added, removed or moved */
+    juce::uint32 getGeneration() const;
+    
+    // column accessors, rows must be in the library order */
+    juce::int64 getLibraryId(juce::uint32 row) const;
+    float getLength(juce::uint32 row) const;
+    juce::String getTitle(juce::uint32 row) const;
+    /** TrackStore::getTitleData() returns the UTF-8 title in the pool, not null terminated, and its length in bytes */
+    const char* getTitleData(juce::uint32 row, int& numBytes) const;
+    /** TrackStore::getFileNameData() returns the url escaped file name at the end of the url, as getTitleData() */
+    const char* getFileNameData(juce::uint32 row, int& numBytes) const;
+    juce::String getArtist(juce::uint32 row) const;
+    const char* getArtistData(juce::uint32 row, int& numBytes) const;
+    juce::String getAlbum(juce::uint32 row) const;
+    const char* getAlbumData(juce::uint32 row, int& numBytes) const;
+    std::string getURLString(juce::uint32 row) const;
+    juce::URL getURL(juce::uint32 row) const;
+    TrackInfo getInfo(juce::uint32 row) const;
+    juce::int64 getDateAdded(juce::uint32 row) const;
+    juce::uint32 getPlayCount(juce::uint32 row) const;
+    void setPlayCount(juce::uint32 row, juce::uint32 playCount);
+    const FileSignature& getSignature(juce::uint32 row) const;
+    
+    // analysis columns, each reads as unknown until it is set, bpm, loudness and the true peak read as NaN */
+    bool hasBpm(juce::uint32 row) const;
+    float getBpm(juce::uint32 row) const;
+    void setBpm(juce::uint32 row, float bpm);
+    bool hasKey(juce::uint32 row) const;
+    /** key as 0 - 23, major keys first */
+    int getKey(juce::uint32 row) const;
+    void setKey(juce::uint32 row, int key);
+    bool hasLoudness(juce::uint32 row) const;
+    /** integrated loudness in LUFS */
+    float getLoudness(juce::uint32 row) const;
+    void setLoudness(juce::uint32 row, float lufs);
+    bool hasTruePeak(juce::uint32 row) const;
+    /** highest true peak in dBTP */
+    float getTruePeak(juce::uint32 row) const;
+    void setTruePeak(juce::uint32 row, float dbtp);
+    bool hasBeatGrid(juce::uint32 row) const;
+    /** seconds from the start of the file to the first beat, the rest follow every 60 / bpm seconds */
+    float getFirstBeat(juce::uint32 row) const;
+    void setFirstBeat(juce::uint32 row, float seconds);
+    bool hasMixPoints(juce::uint32 row) const;
+    const MixPoints& getMixPoints(juce::uint32 row) const;
+    void setMixPoints(juce::uint32 row, const MixPoints& points);
+    /** TrackStore::isAnalysed() returns true once the track's file has been through the analysis pipeline, whatever it found */
+    bool isAnalysed(juce::uint32 row) const;
+    void setAnalysed(juce::uint32 row);
+    /** TrackStore::clearAnalysis() makes bpm, key, loudness, the true peak, the beat grid and the mix points unknown again, for a file that has changed */
+    void clearAnalysis(juce::uint32 row);
+    
+    /** TrackStore::isPlayable() returns false once a track's file has been found missing or undecodable, every track starts playable */
+    bool isPlayable(juce::uint32 row) const;
+    void setPlayable(juce::uint32 row, bool playable);
+    
+    // whole columns, indexed by row, getNumRows() long, for scans that vectorise */
+    const float* getLengthColumn() const;
+    const float* getBpmColumn() const;
+    const float* getLoudnessColumn() const;
+    const juce::uint8* getKeyColumn() const;
+
+private:
+    /** string handles with this bit set are the index of a record in the LibraryIndex, whose strings are read from the mapping */
+    static constexpr juce::uint32 mappedString = 0x80000000;
+    enum class Field { title, artist, album, urlFolder, urlName };
+    
+    /** TrackStore::getString() returns a string column's data and its length in bytes, from the pool or the index */
+    const char* getString(Field field, juce::uint32 handle, int& numBytes) const;
+    
+    //==============================================================================
+    /* Append-only pool of unique strings, looked up through an open addressed hash table of handles */
+    class StringPool
+    {
+    public:
+        /** StringPool::intern() returns the handle of a string, adding it if it isn't already in the pool */
+        juce::uint32 intern(const char* data, size_t numBytes);
+        const char* getData(juce::uint32 handle) const;
+        int getLength(juce::uint32 handle) const;
+        juce::uint32 getNumStrings() const;
+        size_t getNumBytes() const;
+        void clear();
+
+    private:
+        std::vector<char> chars;
+        std::vector<juce::uint32> offsets;          // one past the last string's end, per handle
+        std::vector<juce::uint32> slots;            // handle + 1, 0 for an empty slot
+        static juce::uint32 hash(const char* data, size_t numBytes);
+        void growSlots();
+    };
+    
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+    
+    enum Flags : juce::uint8 { bpmKnown = 1, keyKnown = 2, loudnessKnown = 4, unplayable = 8, beatGridKnown = 16, analysed = 32, mixPointsKnown = 64, truePeakKnown = 128 };
+    
+    /** columns, indexed by row */
+    std::vector<juce::int64> libraryIds, datesAdded;
+    std::vector<float> lengths, bpms, loudnesses, truePeaks, firstBeats;
+    std::vector<juce::uint32> titles, artists, albums, urlFolders, urlNames, playCounts;
+    std::vector<juce::uint8> keys, flags;
+    std::vector<FileSignature> signatures;
+    std::vector<MixPoints> mixPoints;
+    /** rows in library order */
+    std::vector<juce::uint32> order;
+    /** row of each library id */
+    std::unordered_map<juce::int64, juce::uint32> rowsById;
+    /** rows of removed tracks, reused by add() */
+    std::vector<juce::uint32> freeRows;
+    /** bumped by every change to the rows or their order */
+    juce::uint32 generation = 0;
+    StringPool strings;
+    /** the index the mapped strings are read from, nullptr once none are */
+    std::shared_ptr<LibraryIndex> index;
+
+    JUCE_LEAK_DETECTOR (TrackStore)
+};
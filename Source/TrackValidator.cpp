@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    TrackValidator.cpp
+    Created: 1 Nov 2026 9:14:37am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#include "TrackValidator.h"
+#include <memory>
+
+constexpr int TrackValidator::numCheckers;
+constexpr int TrackValidator::startDelayMs;
+constexpr int TrackValidator::samplesToDecode;
+
+TrackValidator::TrackValidator(juce::AudioFormatManager& _formatManager) :
+                                    juce::Thread("track validator"),
+                                    formatManager(_formatManager)
+{
+    pool.setThreadPriorities(1);
+    startThread(1);
+}
+
+TrackValidator::~TrackValidator()
+{
+    cancelPendingUpdate();
+    cancelled = true;
+    wakeUp.signal();
+    stopThread(4000);
+    pool.removeAllJobs(true, 2000);
+}
+
+/* ================================= */
+/* ====== message thread side ====== */
+/* ================================= */
+
+void TrackValidator::validate(const std::vector<Track>& tracks)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        pendingTracks = tracks;
+        hasPendingTracks = true;
+        // a check already running stops at its next track
+        cancelled = true;
+    }
+    wakeUp.signal();
+    notify();
+}
+
+void TrackValidator::cancel()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        pendingTracks.clear();
+        hasPendingTracks = false;
+        cancelled = true;
+    }
+    wakeUp.signal();
+}
+
+void TrackValidator::handleAsyncUpdate()
+{
+    std::vector<long int> ids;
+    bool validationFinished;
+    int checked, unplayable;
+    {
+        const juce::ScopedLock sl(lock);
+        ids.swap(unplayableIds);
+        validationFinished = finished;
+        finished = false;
+        checked = numChecked;
+        unplayable = numUnplayable;
+    }
+    if (!ids.empty() && onUnplayable)
+        onUnplayable(ids);
+    if (validationFinished && onFinished)
+        onFinished(checked, unplayable);
+}
+
+/* =================================== */
+/* ====== validator thread side ====== */
+/* =================================== */
+
+void TrackValidator::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+        std::vector<Track> tracks;
+        {
+            const juce::ScopedLock sl(lock);
+            if (!hasPendingTracks)
+                continue;
+            tracks.swap(pendingTracks);
+            hasPendingTracks = false;
+            numChecked = 0;
+            numUnplayable = 0;
+            cancelled = false;
+            wakeUp.reset();
+        }
+        // let the app finish starting before touching the disk
+        wakeUp.wait(startDelayMs);
+        if (threadShouldExit())
+            return;
+        if (cancelled.load())
+            continue;
+        checkTracks(tracks);
+        if (threadShouldExit())
+            return;
+        if (!cancelled.load())
+        {
+            {
+                const juce::ScopedLock sl(lock);
+                finished = true;
+            }
+            triggerAsyncUpdate();
+        }
+    }
+}
+
+void TrackValidator::checkTracks(const std::vector<Track>& tracks)
+{
+    // each checker takes the next unchecked track, so slow files don't hold up a fixed share
+    std::atomic<size_t> nextTrack {0};
+    std::atomic<int> checkersLeft {numCheckers};
+    juce::WaitableEvent allDone;
+    auto checkNext = [this, &tracks, &nextTrack, &checkersLeft, &allDone] ()
+    {
+        for (size_t i = nextTrack++; i < tracks.size() && !cancelled.load() && !threadShouldExit(); i = nextTrack++)
+        {
+            const juce::uint32 startMs = juce::Time::getMillisecondCounter();
+            bool playable = isPlayable(juce::URL(juce::String(tracks[i].url)), formatManager);
+            {
+                const juce::ScopedLock sl(lock);
+                ++numChecked;
+                if (!playable)
+                {
+                    ++numUnplayable;
+                    unplayableIds.push_back(tracks[i].libraryId);
+                }
+            }
+            if (!playable)
+                triggerAsyncUpdate();
+            // resting as long as the check took keeps the validator to half the disk at most
+            wakeUp.wait((int)(juce::Time::getMillisecondCounter() - startMs));
+        }
+        if (--checkersLeft == 0)
+            allDone.signal();
+    };
+    for (int checker = 1; checker < numCheckers; ++checker)
+        pool.addJob(checkNext);
+    checkNext();
+    allDone.wait();
+}
+
+bool TrackValidator::isPlayable(const juce::URL& url, juce::AudioFormatManager& formatManager)
+{
+    if (!url.isLocalFile())
+        return true;
+    juce::File file = url.getLocalFile();
+    if (!file.existsAsFile())
+        return false;
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->sampleRate <= 0 || reader->lengthInSamples <= 0)
+        return false;
+    // decoding both ends catches damaged headers and files cut short by a failed copy
+    const int numSamples = (int)juce::jmin((juce::int64)samplesToDecode, reader->lengthInSamples);
+    std::vector<int> left((size_t)numSamples), right((size_t)numSamples);
+    int* channels[] = { left.data(), right.data() };
+    return reader->read(channels, 2, 0, numSamples, false)
+        && reader->read(channels, 2, reader->lengthInSamples - numSamples, numSamples, false);
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    TrackValidator.h
+    Created: 1 Nov 2026 9:14:37am
+    Author:  Nigel Powell
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <functional>
+
+//==============================================================================
+/*
+ Background check that every library track can still be played
+ Each track's file has to exist, open with an AudioFormatReader and decode a
+ block from its start and its end, which catches missing, damaged and truncated
+ files before autoplay or a deck reaches them
+ Runs at low priority on two threads, and after each check rests for as long as
+ the check took, so a large library doesn't starve the decks of disk bandwidth
+ Unplayable tracks are handed to the message thread in batches
+*/
+class TrackValidator  : private juce::Thread,
+                        private juce::AsyncUpdater
+{
+public:
+    TrackValidator(juce::AudioFormatManager& _formatManager);
+    ~TrackValidator() override;
+
+    /** a library track to check */
+    struct Track
+    {
+        long int        libraryId;
+        std::string     url;
+    };
+
+    /** called on the message thread with the library ids of each batch of tracks found unplayable */
+    std::function<void(std::vector<long int>&)> onUnplayable;
+    /** called on the message thread once every track has been checked */
+    std::function<void(int numChecked, int numUnplayable)> onFinished;
+
+    /* ===================== */
+    /* ====== methods ====== */
+    /* ===================== */
+
+    /**
+     TrackValidator::validate()
+     Input                  std::vector<Track>
+     Output                 none
+     Checks the tracks in the background, after a short delay so the app can finish starting
+     Replaces any check still running
+     */
+    void validate(const std::vector<Track>& tracks);
+
+    /** TrackValidator::cancel() stops checking, tracks already reported stay reported */
+    void cancel();
+
+    /**
+     TrackValidator::isPlayable()
+     Input                  juce::URL, juce::AudioFormatManager
+     Output                 bool
+     Returns false if a local file is missing, isn't audio in a known format or can't be decoded
+     at its start or end. Urls that aren't local files are assumed playable. Safe to call from any thread
+     */
+    static bool isPlayable(const juce::URL& url, juce::AudioFormatManager& formatManager);
+
+private:
+    // implement Thread
+    void run() override;
+    // implement AsyncUpdater
+    void handleAsyncUpdate() override;
+
+    /** TrackValidator::checkTracks() checks tracks across the pool and the validator thread until all are done */
+    void checkTracks(const std::vector<Track>& tracks);
+
+    /* ======================== */
+    /* ====== properties ====== */
+    /* ======================== */
+
+    /** shared with the rest of the app, only used to create readers */
+    juce::AudioFormatManager& formatManager;
+    /** the second checker, the validator thread is the first */
+    juce::ThreadPool pool{1};
+
+    /** guards everything below that both threads use */
+    juce::CriticalSection lock;
+    /** tracks waiting to be checked */
+    std::vector<Track> pendingTracks;
+    bool hasPendingTracks = false;
+    /** unplayable tracks waiting for the message thread */
+    std::vector<long int> unplayableIds;
+    /** set by the validator thread when it has checked every track */
+    bool finished = false;
+    int numChecked = 0, numUnplayable = 0;
+
+    /** signalled to cut short the rests between checks */
+    juce::WaitableEvent wakeUp{true};
+    std::atomic<bool> cancelled {false};
+
+    static constexpr int numCheckers = 2;
+    /** how long after validate() the first check starts */
+    static constexpr int startDelayMs = 5000;
+    /** samples decoded at each end of a file */
+    static constexpr int samplesToDecode = 4096;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackValidator)
+};
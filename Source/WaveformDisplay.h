@@ -56,7 +56,8 @@ public:
      WaveformDisplay::loadURL()
      input                  juce::URL
      output                 none
-     loads in a new audio thumbnail for the passed URL
+     loads in a new audio thumbnail for the passed URL, straight from the thumbnail cache
+     if PlaylistComponent's analysis has already drawn it
      */
     void loadURL(URL audioURL);
     